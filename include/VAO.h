@@ -11,6 +11,8 @@ class VAO
         VAO();
 
         void LinkAttrib(VBO VBO, GLuint layout, GLuint numComp, GLenum type, GLsizeiptr stride, void* offset);
+        // Integer attributes (bone indices) are read as ints by the shader instead of being converted to floats
+        void LinkAttribI(VBO VBO, GLuint layout, GLuint numComp, GLenum type, GLsizeiptr stride, void* offset);
         void Bind();
         void Unbind();
         void Delete();
@@ -3,15 +3,17 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 #include <vector>
 
-// Structure to standardize the vertices used in the meshes
-struct Vertex
+#include "vertex.h"
+
+// Second vertex stream of skinned meshes: the 4 strongest bones of the vertex and their weights,
+// summing to 1
+struct SkinVertex
 {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec3 color;
-	glm::vec2 texUV;
+	glm::u8vec4 joints = glm::u8vec4(0);
+	glm::vec4 weights = glm::vec4(0.0f);
 };
 
 
@@ -23,6 +25,8 @@ public:
 	GLuint ID;
 	// Constructor that generates a Vertex Buffer Object and links it to vertices
 	VBO(std::vector<Vertex>& vertices);
+	// Same for the skin stream of a skinned mesh
+	VBO(std::vector<SkinVertex>& skin);
 
 	// Binds the VBO
 	void Bind();
@@ -0,0 +1,94 @@
+#ifndef ANIMATION_BAKER_CLASS_H
+#define ANIMATION_BAKER_CLASS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "animationLibrary.h"
+#include "bakedAnimation.h"
+
+// Offline side of BakedAnimation and AnimationLibrary: imports a skinned model with the same flags
+// as Model (so the vertices come out in the same order), samples every clip at a fixed frame rate
+// and stores the skinning matrices, or the local joint poses, of each frame
+class AnimationBaker
+{
+public:
+    // One joint motion of a procedural clip, expressed in the mesh space of the bind pose around the
+    // joint: value(t) = offset + amplitude * sin(2 pi cycles t / duration + phase), an angle in
+    // degrees around axis, or a distance along it when translate is set
+    struct Curve
+    {
+        std::string joint;
+        glm::vec3 axis;
+        float offset = 0.0f;
+        float amplitude = 0.0f;
+        int cycles = 1;
+        float phase = 0.0f;
+        bool translate = false;
+    };
+
+    // Clips authored as curves on top of the bind pose, for models shipped without animations.
+    // Curves on the same joint are applied in order.
+    struct ProceduralClip
+    {
+        std::string name;
+        float duration = 1.0f;
+        std::vector<Curve> curves;
+    };
+
+    float frameRate = 30.0f;
+
+    bool load(const std::string& path);
+    int jointCount() const { return (int)joints_.size(); }
+    int clipCount() const { return scene_ ? (int)scene_->mNumAnimations : 0; }
+
+    // Bakes the clips stored in the model, then the procedural ones, and the skin of every mesh
+    bool bake(const std::vector<ProceduralClip>& procedural, BakedAnimation& animation) const;
+    // Same clips as local joint poses, with the skeleton, for the animation runtime
+    bool exportLibrary(const std::vector<ProceduralClip>& procedural, AnimationLibrary& library) const;
+
+private:
+    using ClipVisitor = std::function<void(const std::string& name, int frameCount)>;
+    using FrameVisitor = std::function<void(const std::vector<glm::mat4>& locals)>;
+
+    struct SceneNode
+    {
+        const aiNode* node;
+        // Parents always come first
+        int parent;
+        glm::mat4 local;
+    };
+
+    struct Joint
+    {
+        std::string name;
+        int node;
+        // Mesh space to joint space in the bind pose
+        glm::mat4 offset;
+    };
+
+    int findNode(const std::string& name) const;
+    void globals(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& out) const;
+    // Appends the skinning matrices of one frame
+    void appendFrame(const std::vector<glm::mat4>& locals, BakedAnimation& animation) const;
+    void sampleClip(const aiAnimation& clip, double seconds, std::vector<glm::mat4>& locals) const;
+    // Local transform of every node at every frame of the model's clips, then of the procedural ones
+    void sampleFrames(const std::vector<ProceduralClip>& procedural, const ClipVisitor& beginClip,
+                      const FrameVisitor& frame) const;
+
+    Assimp::Importer importer_;
+    const aiScene* scene_ = nullptr;
+    std::vector<SceneNode> nodes_;
+    std::vector<Joint> joints_;
+    // Meshes in the order Model visits them
+    std::vector<const aiMesh*> meshes_;
+    // Scene space to the space Model draws the vertices in
+    glm::mat4 meshInverse_ = glm::mat4(1.0f);
+};
+
+#endif
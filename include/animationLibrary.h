@@ -0,0 +1,75 @@
+#ifndef ANIMATION_LIBRARY_CLASS_H
+#define ANIMATION_LIBRARY_CLASS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Joint hierarchy of a skinned model, flattened so parents always come before their children
+struct Skeleton
+{
+    std::vector<std::string> names;
+    // -1 for the roots
+    std::vector<int> parents;
+    // Local bind pose of every joint
+    std::vector<glm::vec3> bindTranslations;
+    std::vector<glm::quat> bindRotations;
+    std::vector<glm::vec3> bindScales;
+    // Scene space to the space Model draws the vertices in, applied above the roots
+    glm::mat4 meshInverse = glm::mat4(1.0f);
+    // For each joint of the model's palette (Model::joints): its skeleton joint and its mesh space
+    // to joint space matrix in the bind pose
+    std::vector<int> skinJoints;
+    std::vector<glm::mat4> skinOffsets;
+
+    int jointCount() const { return (int)parents.size(); }
+    // Joints are stored and sampled 4 at a time
+    int groupCount() const { return (jointCount() + 3) / 4; }
+};
+
+// Local pose of 4 joints, one joint per lane
+struct JointGroup
+{
+    // Quaternion x, y, z, w as normalized 16 bit integers
+    int16_t rotation[4][4];
+    float translation[3][4];
+    float scale[3][4];
+};
+
+// A clip resampled at a fixed frame rate: every frame stores the local pose of every joint, so a
+// sample is two frames and a blend, without searching keys
+struct AnimationClip
+{
+    std::string name;
+    float frameRate = 30.0f;
+    int frameCount = 0;
+    // Looping clips don't store their last frame, it is the first one again
+    bool looping = true;
+    // frameCount * Skeleton::groupCount() groups, frame after frame
+    std::vector<JointGroup> frames;
+
+    float duration() const { return frameCount / frameRate; }
+};
+
+// Skeleton and clips of a model for the animation runtime (see AnimationSystem). Written by the
+// Animator target next to the baked crowd frames, GL free.
+class AnimationLibrary
+{
+public:
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+
+    // -1 when there is no clip of that name
+    int findClip(const std::string& name) const;
+
+    // Stores the local poses of one frame, one entry per joint
+    static void packFrame(const std::vector<glm::vec3>& translations, const std::vector<glm::quat>& rotations,
+                          const std::vector<glm::vec3>& scales, std::vector<JointGroup>& out);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+#endif
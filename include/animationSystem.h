@@ -0,0 +1,95 @@
+#ifndef ANIMATION_SYSTEM_CLASS_H
+#define ANIMATION_SYSTEM_CLASS_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "animationLibrary.h"
+#include "camera.h"
+#include "model.h"
+
+// Skeletal animation runtime for the characters sharing one AnimationLibrary. Every character
+// blends the clips of a 1D blend tree driven by its movement speed: clips are sampled and blended
+// 4 joints at a time with the Float4 helpers, the local poses flattened down the parent index
+// array, and the skinning matrices handed to its Model. Distant and off-screen characters are
+// evaluated less often, and the characters due in a frame are spread over threads.
+class AnimationSystem
+{
+public:
+    // One clip of a blend tree and the speed (units per second) it is authored for
+    struct BlendPoint
+    {
+        int clip;
+        float speed;
+    };
+
+    struct Character
+    {
+        // Sorted by speed, clips are synchronized on a shared normalized phase
+        std::vector<BlendPoint> blendTree;
+        float speed = 0.0f;
+        // World space sphere around the character, for the visibility and distance tests
+        glm::vec3 position = glm::vec3(0.0f);
+        float radius = 1.0f;
+    };
+
+    // The update is only split over the JobSystem past parallelThreshold due characters
+    int parallelThreshold = 4;
+    // Visible characters past these distances update every 2nd and every 4th frame, off-screen
+    // ones every offscreenInterval frames
+    float midDistance = 10.0f;
+    float farDistance = 25.0f;
+    int offscreenInterval = 8;
+
+    // Characters evaluated by the last update(), for tuning
+    int evaluated = 0;
+
+    AnimationSystem(const AnimationLibrary& library);
+
+    // The model must have been loaded from the file the library was exported from
+    int add(Model& model, const std::vector<BlendPoint>& blendTree);
+    Character& character(int index) { return characters_[index].settings; }
+    int characterCount() const { return (int)characters_.size(); }
+
+    // Advances every character, evaluates the ones due this frame and poses their models
+    void update(float dt, const Camera& camera);
+
+private:
+    // Local pose of 4 joints, dequantized
+    struct PoseGroup
+    {
+        float rotation[4][4];
+        float translation[3][4];
+        float scale[3][4];
+    };
+
+    struct CharacterState
+    {
+        Character settings;
+        Model* model;
+        float phase = 0.0f;
+        // Time gathered since the last evaluation, and frames between evaluations
+        float elapsed = 0.0f;
+        int interval = 1;
+        bool posed = false;
+        // Scratch of the evaluation, owned by the character so workers never share it
+        std::vector<PoseGroup> pose;
+        std::vector<PoseGroup> blendPose;
+        std::vector<glm::mat4> globals;
+        std::vector<glm::mat4> skin;
+    };
+
+    void evaluate(CharacterState& state) const;
+    void sample(const AnimationClip& clip, float time, PoseGroup* out) const;
+    void toSkin(CharacterState& state) const;
+    // Runs task(begin, end) over [0, count), split into jobs when count is large enough
+    template <typename Task>
+    void parallel(int count, Task task);
+
+    const AnimationLibrary& library_;
+    std::vector<CharacterState> characters_;
+    std::vector<int> due_;
+    unsigned int frame_ = 0;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef BAKED_ANIMATION_CLASS_H
+#define BAKED_ANIMATION_CLASS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+// Skeletal animation clips baked at a fixed frame rate: every frame stores the skinning matrix of
+// each joint (mesh space bind pose to posed mesh space) as three rows, plus the joints and weights
+// of every vertex, so a vertex shader can skin a character without evaluating its skeleton.
+// Written by the Animator target and read back by Crowd, so this file stays free of GL calls.
+class BakedAnimation
+{
+public:
+    struct Clip
+    {
+        std::string name;
+        int firstFrame = 0;
+        int frameCount = 0;
+        // Looping clips don't store their last frame, it is the first one again
+        bool looping = true;
+    };
+
+    float frameRate = 30.0f;
+    int jointCount = 0;
+    std::vector<Clip> clips;
+    // frameCount() * jointCount * 3 rows, frame after frame
+    std::vector<glm::vec4> rows;
+
+    // Skin of every mesh, vertices in the order Model loads them: 4 joints and weights each,
+    // weights summing to 1
+    std::vector<uint32_t> meshVertexCounts;
+    std::vector<glm::u8vec4> joints;
+    std::vector<glm::vec4> weights;
+
+    int frameCount() const { return jointCount > 0 ? (int)(rows.size() / (jointCount * 3)) : 0; }
+    // -1 when there is no clip of that name
+    int findClip(const std::string& name) const;
+    // Index of the first vertex of a mesh in joints and weights
+    size_t meshOffset(size_t mesh) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+#endif
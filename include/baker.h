@@ -0,0 +1,59 @@
+#ifndef BAKER_CLASS_H
+#define BAKER_CLASS_H
+
+#include <algorithm>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "staticLevel.h"
+#include "jobSystem.h"
+#include "lightmap.h"
+#include "probeGrid.h"
+#include "raytracer.h"
+
+// Offline CPU path tracer for the static level. Uses the same lighting convention as
+// default.frag: a surface shows albedo * E, and a light contributes color * cos * attenuation to E.
+class Baker
+{
+public:
+    // Indirect samples per texel, rounded up to a multiple of the packet width
+    int samples = 256;
+    int bounces = 3;
+
+    Baker(const StaticSurface* surfaces, size_t surfaceCount, const StaticLight* lights, size_t lightCount);
+
+    // Fills the texels of an unwrapped lightmap with direct plus indirect irradiance,
+    // then dilates the charts by `padding` texels so bilinear filtering doesn't bleed black
+    void bakeLightmap(Lightmap& lightmap, int padding) const;
+    // Projects the light arriving at every probe of a laid out grid onto L1 spherical harmonics,
+    // `samples` rays per probe plus the static lights as point sources
+    void bakeProbes(ProbeGrid& grid) const;
+
+    // Direct irradiance for the points of the active lanes, with shadow rays
+    void direct(const glm::vec3* positions, const glm::vec3* normals, int lanes, glm::vec3* result) const;
+    // Radiance arriving at the origins along the directions, following diffuse bounces
+    void trace(const glm::vec3* origins, const glm::vec3* directions, int lanes, unsigned int& rng, glm::vec3* result) const;
+
+    // Runs body(begin, end) over [0, count) in chunks spread over the JobSystem
+    template <typename F>
+    void parallelFor(size_t count, size_t chunk, F body) const;
+
+    static float random(unsigned int& state);
+    static glm::vec3 cosineSample(const glm::vec3& normal, unsigned int& rng);
+
+private:
+    RayTracer tracer_;
+    std::vector<glm::vec3> albedos_;
+    const StaticSurface* surfaces_;
+    size_t surfaceCount_;
+    const StaticLight* lights_;
+    size_t lightCount_;
+};
+
+template <typename F>
+void Baker::parallelFor(size_t count, size_t chunk, F body) const
+{
+    JobSystem::shared().parallelFor((int)count, (int)chunk, [&body](int begin, int end) { body((size_t)begin, (size_t)end); });
+}
+
+#endif
@@ -19,6 +19,9 @@ public:
     //glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
     //glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
     glm::mat4 cameraMatrix = glm::mat4(1.0f);
+    // View and projection kept separately for passes that need one without the other
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
 
     bool firstClick = true;
 
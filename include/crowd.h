@@ -0,0 +1,67 @@
+#ifndef CROWD_CLASS_H
+#define CROWD_CLASS_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "bakedAnimation.h"
+#include "camera.h"
+#include "mesh.h"
+#include "portal.h"
+#include "shaderClass.h"
+
+// Many instances of a skinned mesh playing baked clips (lobbies, spectators, replays). The bone
+// matrices of every frame live in one float texture and default.vert skins each vertex from the
+// clip, start time and rate of its instance, so the CPU never touches a skeleton: drawing is a
+// frustum test per instance and a single glDrawElementsInstanced.
+class Crowd
+{
+public:
+    // Portal cell the crowd stands in, -1 to ignore the portals
+    int cell = -1;
+    // Instances drawn by the last draw(), for tuning
+    int visible = 0;
+
+    // meshIndex is the index of the mesh in the model the animation was baked from. Without a mesh
+    // (the model didn't load) the crowd is invalid.
+    Crowd(const BakedAnimation& animation, Mesh* mesh, size_t meshIndex = 0, int maxInstances = 1024);
+
+    // False when the animation doesn't match the mesh, nothing is drawn then
+    bool valid() const { return valid_; }
+
+    // Starts the clip at startTime (seconds, in draw()'s clock), rate 2 plays it twice as fast
+    int add(const glm::mat4& transform, int clip, float rate = 1.0f, float startTime = 0.0f);
+    void setTransform(int instance, const glm::mat4& transform);
+    void play(int instance, int clip, float rate, float startTime);
+
+    // Draws the instances inside the camera frustum with the scene shader, the bone frames bound
+    // to the given texture unit
+    void draw(Shader& shader, Camera& camera, float time, GLuint unit, const PortalSystem* portals = nullptr);
+    void Delete();
+
+private:
+    struct Instance
+    {
+        glm::mat4 transform;
+        // First frame, frame count (negative when the clip doesn't loop), start time, rate
+        glm::vec4 clip;
+    };
+
+    std::vector<BakedAnimation::Clip> clips_;
+    float frameRate_;
+    Mesh* mesh_;
+    bool valid_ = false;
+    int maxInstances_;
+    std::vector<Instance> instances_;
+    std::vector<Instance> drawn_;
+
+    GLuint vao_ = 0;
+    GLuint vertexBuffer_ = 0;
+    GLuint skinBuffer_ = 0;
+    GLuint indexBuffer_ = 0;
+    GLuint instanceBuffer_ = 0;
+    GLuint frames_ = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef DECALS_CLASS_H
+#define DECALS_CLASS_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "shaderClass.h"
+
+// Must match MAX_DECALS_PER_CLUSTER in default.frag
+#define MAX_DECALS_PER_CLUSTER 32
+
+// Projected decals (blood, scorch marks, footprints, posters) on the static room surfaces. Each
+// decal is an oriented box that projects an image of the decal atlas along its z axis. Every frame
+// the boxes in the frustum are binned into a grid of screen tiles times exponential depth slices,
+// and default.frag blends in the decals listed by the fragment's cluster, in a single loop with no
+// extra draw. A cluster keeps at most MAX_DECALS_PER_CLUSTER decals, which bounds the cost per
+// pixel however many decals exist.
+class DecalSystem
+{
+public:
+    enum class Shape
+    {
+        Splat,
+        Scorch,
+        Footprint
+    };
+
+    // Decals binned and the most crowded cluster after the last update(), for tuning
+    int visibleDecals = 0;
+    int busiestCluster = 0;
+
+    // Past maxDecals the oldest decal is replaced by the new one
+    DecalSystem(int maxDecals = 4096, int atlasSize = 1024, glm::ivec3 clusters = glm::ivec3(16, 9, 24),
+                float farDistance = 30.0f);
+
+    // Images must all be added before the first update(), which builds the atlas
+    int addImage(const char* path);
+    int addImage(const std::vector<unsigned char>& rgba, int width, int height);
+    // Generated image with the alpha shape of the given kind, tinted with color
+    int addShape(Shape shape, int size, const glm::vec4& color, uint32_t seed);
+
+    // position is on the surface, normal points out of it, size is the width and height of the
+    // image on the surface and depth how far the projection reaches on each side
+    int add(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& size, float rotation, int image,
+            const glm::vec4& tint = glm::vec4(1.0f), float depth = 0.1f);
+    void clear() { decals_.clear(); next_ = 0; }
+
+    // Bins the visible decals for this camera and uploads the decal and cluster buffers
+    void update(const Camera& camera, float nearPlane);
+    // Binds the atlas and buffers to four consecutive texture units starting at firstUnit
+    void apply(Shader& shader, GLuint firstUnit);
+    // For passes rendered from another camera, whose clusters would not match
+    void disable(Shader& shader);
+    void Delete();
+
+private:
+    struct Image
+    {
+        std::vector<unsigned char> rgba;
+        int width;
+        int height;
+        // Atlas rectangle in UV units, offset and size
+        glm::vec4 rect;
+    };
+
+    struct Decal
+    {
+        // World space to box space ([-0.5, 0.5] on every axis)
+        glm::mat4 worldToBox;
+        glm::vec3 corners[8];
+        int image;
+        glm::vec4 tint;
+    };
+
+    void buildAtlas();
+
+    int maxDecals_;
+    uint32_t maxIndices_;
+    int atlasSize_;
+    glm::ivec3 clusters_;
+    glm::vec2 depthRange_;
+    glm::mat4 view_ = glm::mat4(1.0f);
+    glm::vec2 screenSize_ = glm::vec2(1.0f);
+
+    std::vector<Image> images_;
+    std::vector<Decal> decals_;
+    int next_ = 0;
+
+    // Per frame binning, kept between frames to avoid reallocating
+    std::vector<glm::vec4> decalTexels_;
+    std::vector<uint32_t> clusterRanges_;
+    std::vector<uint32_t> clusterIndices_;
+    std::vector<glm::ivec3> binMin_;
+    std::vector<glm::ivec3> binMax_;
+
+    GLuint atlas_ = 0;
+    // Texture buffers: decal data (5 texels per decal), cluster offset/count, decal indices
+    GLuint decalBuffer_, decalTexture_;
+    GLuint clusterBuffer_, clusterTexture_;
+    GLuint indexBuffer_, indexTexture_;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef DRAW_LIST_CLASS_H
+#define DRAW_LIST_CLASS_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "frustum.h"
+#include "mesh.h"
+#include "occlusion.h"
+
+class Node;
+
+// The meshes of a scene seen by a camera, built in stages spread over the JobSystem: the world
+// matrices are brought up to date, the top of the node tree is opened until there are a few
+// subtrees per thread, each thread culls its subtrees into its own list, and the lists are merged
+// and sorted by shader and mesh. Only submit() calls GL, so it must run on the GL thread.
+class DrawList
+{
+public:
+    struct Item
+    {
+        // Shader program in the high bits and vertex array in the low ones, so the submission
+        // switches program and binds textures as rarely as possible
+        uint64_t key;
+        Mesh* mesh;
+        glm::mat4 model;
+    };
+
+    // The scene is only split over the JobSystem past parallelThreshold nodes
+    size_t parallelThreshold = 256;
+
+    static uint64_t key(const Mesh& mesh) { return (uint64_t)mesh.shader.ID << 32 | mesh.vao.ID; }
+
+    // Replaces the list with the visible meshes of the root's subtree
+    void build(Node& root, const glm::mat4& viewProjection, OcclusionCuller* occlusion = nullptr);
+    // Draws the list with the camera's view, binding each program and mesh once
+    void submit(Camera& camera) const;
+
+    const std::vector<Item>& items() const { return items_; }
+
+private:
+    // Subtree waiting to be culled by a job, inside when its ancestors are all in the frustum
+    struct Range
+    {
+        const Node* node;
+        bool inside;
+    };
+
+    // One per thread, aligned so the threads don't share cache lines while appending
+    struct alignas(64) ThreadItems
+    {
+        std::vector<Item> items;
+    };
+
+    std::vector<Item> items_;
+    std::vector<Range> ranges_;
+    std::vector<ThreadItems> threadItems_;
+};
+
+#endif
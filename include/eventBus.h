@@ -0,0 +1,131 @@
+#ifndef EVENT_BUS_CLASS_H
+#define EVENT_BUS_CLASS_H
+
+#include <atomic>
+#include <climits>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "mpscQueue.h"
+
+// Typed events between subsystems living on different threads. Every consumer owns a bounded
+// queue per event type it listens to: publish() copies the event into the queue of each listener,
+// from any thread, without locks or allocation, and the consumer's thread hands its queued events
+// to its handlers in batches when it calls dispatch(). A full queue drops the event for that
+// consumer only and counts it. Consumers and their listeners are set up before anything is
+// published.
+class EventBus
+{
+    struct QueueBase;
+
+public:
+    static const int MAX_EVENT_TYPES = 64;
+    // Most events handed to a handler at once
+    static const int BATCH_SIZE = 64;
+
+    class Consumer
+    {
+    public:
+        // handler(const E* events, int count) is called from dispatch(), with the events of each
+        // publishing thread in the order they were published
+        template <typename E, typename F>
+        void listen(F handler, size_t capacity = 1024)
+        {
+            auto queue = std::make_unique<Queue<E>>(this, capacity, std::function<void(const E*, int)>(handler));
+            bus_.routes_[eventType<E>()].push_back(queue.get());
+            queues_.push_back(std::move(queue));
+        }
+        // Runs the handlers on the events queued so far, returns how many were handled
+        int dispatch(int maxEvents = INT_MAX);
+        // Events lost to full queues
+        int dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class EventBus;
+        explicit Consumer(EventBus& bus) : bus_(bus) {}
+
+        EventBus& bus_;
+        std::vector<std::unique_ptr<QueueBase>> queues_;
+        std::atomic<int> dropped_{0};
+    };
+
+    EventBus() = default;
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    Consumer& consumer();
+
+    template <typename E>
+    void publish(const E& event)
+    {
+        for (QueueBase* queue : routes_[eventType<E>()])
+        {
+            if (!static_cast<Queue<E>*>(queue)->events.push(event))
+            {
+                queue->owner->dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Registers E on first use, from one thread at a time
+    template <typename E>
+    static int eventType()
+    {
+        static_assert(std::is_trivially_copyable_v<E>, "events are plain data");
+        static const int id = registerEventType();
+        return id;
+    }
+
+private:
+    struct QueueBase
+    {
+        explicit QueueBase(Consumer* owner) : owner(owner) {}
+        virtual ~QueueBase() = default;
+        virtual int drain(int maxEvents) = 0;
+
+        Consumer* owner;
+    };
+
+    template <typename E>
+    struct Queue : QueueBase
+    {
+        Queue(Consumer* owner, size_t capacity, std::function<void(const E*, int)> handler)
+            : QueueBase(owner), events(capacity), handler(std::move(handler))
+        {
+        }
+
+        int drain(int maxEvents) override
+        {
+            E batch[BATCH_SIZE];
+            int total = 0;
+            while (total < maxEvents)
+            {
+                int count = 0;
+                while (count < BATCH_SIZE && total + count < maxEvents && events.pop(batch[count]))
+                {
+                    count++;
+                }
+                if (count == 0)
+                {
+                    break;
+                }
+                handler(batch, count);
+                total += count;
+            }
+            return total;
+        }
+
+        MpscQueue<E> events;
+        std::function<void(const E*, int)> handler;
+    };
+
+    static int registerEventType();
+
+    // Queues listening to each event type
+    std::vector<QueueBase*> routes_[MAX_EVENT_TYPES];
+    std::vector<std::unique_ptr<Consumer>> consumers_;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef FOG_VOLUME_CLASS_H
+#define FOG_VOLUME_CLASS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "shadow.h"
+#include "shaderClass.h"
+
+// Froxel volumetric fog. The view frustum is cut into a low resolution grid (slices spread
+// exponentially in depth) that is lit one slice at a time, blended with the reprojected previous
+// frame so the jittered samples accumulate, then integrated front to back. default.frag applies
+// the result with a single 3D texture fetch, so the cost depends on the grid, not the screen.
+// Everything runs as fullscreen passes into 3D texture layers, no compute shaders needed.
+class FogVolume
+{
+public:
+    // Fog medium: a box (the dark room) with a soft edge, extinction per unit length inside it
+    glm::vec3 boxMin = glm::vec3(0.0f);
+    glm::vec3 boxMax = glm::vec3(0.0f);
+    float density = 0.0f;
+    float edge = 0.5f;
+    glm::vec3 albedo = glm::vec3(0.9f);
+    glm::vec3 ambient = glm::vec3(0.02f);
+    // Henyey-Greenstein g, positive scatters forward around the light
+    float anisotropy = 0.3f;
+    // Share of last frame kept in every froxel, higher is smoother but ghosts more
+    float historyWeight = 0.9f;
+
+    FogVolume(int width = 160, int height = 90, int depth = 64, float nearDistance = 0.3f, float farDistance = 20.0f);
+
+    // Lights and integrates the grid for this frame, after the shadow atlas has been rendered
+    void render(const Camera& camera, const glm::vec3& lightPos, const glm::vec4& lightColor, ShadowSystem& shadows,
+                GLuint shadowUnit);
+    // Binds the integrated grid to the given texture unit for default.frag
+    void apply(Shader& shader, GLuint unit);
+    // Turns the fog off in the shader, for views other than the camera it was rendered for
+    void disable(Shader& shader);
+    void Delete();
+
+private:
+    glm::ivec3 size_;
+    glm::vec2 depthRange_;
+
+    // Injected grids, this frame's and the history, swapped every frame
+    GLuint scattering_[2];
+    GLuint integrated_;
+    // Running totals of the front to back integration, one slice behind the other
+    GLuint carry_[2];
+    GLuint fbo_;
+    GLuint vao_;
+
+    Shader injectShader_;
+    Shader integrateShader_;
+
+    int frame_ = 0;
+    bool hasHistory_ = false;
+    glm::mat4 prevViewProjection_ = glm::mat4(1.0f);
+    glm::mat4 view_ = glm::mat4(1.0f);
+    glm::vec2 screenSize_ = glm::vec2(1.0f);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef FRAME_LATENCY_CLASS_H
+#define FRAME_LATENCY_CLASS_H
+
+#include <atomic>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Keeps the time from input to picture short. The main thread adds the mouse movement as soon as
+// GLFW delivers it, and the render thread latches the total right before drawing, so the camera
+// can be turned by what the simulation hasn't seen yet. Fences keep the driver from queuing more
+// than maxQueuedFrames frames ahead of the GPU, each of them adding a frame of latency.
+//
+// Latency is measured from the moment the newest input a frame latched arrived to the moment its
+// fence is seen signaled, so the display's own scanout comes on top.
+class FrameLatency
+{
+public:
+    static const int MAX_QUEUED_FRAMES = 3;
+
+    // Frames the GPU may lag behind, 0 waits for every frame to finish before the next one
+    int maxQueuedFrames = 1;
+    // Input to GPU completion of the frames drawn with new input, smoothed, in milliseconds
+    float latencyMs = 0.0f;
+
+    // Main thread: the mouse moved by delta pixels at time (glfwGetTime)
+    void addLook(const glm::vec2& delta, double time);
+    // Every movement added so far
+    glm::vec2 look() const;
+
+    // Render thread, before the frame draws anything: waits until few enough frames are queued
+    // and returns the movement to draw the frame with
+    glm::vec2 beginFrame();
+    // Render thread, after the frame is swapped
+    void endFrame();
+    void Delete();
+
+private:
+    struct Pending
+    {
+        GLsync fence = 0;
+        // When the frame's newest input arrived, negative when it had none
+        double inputTime = -1.0;
+    };
+
+    // Records the frame's latency once its fence is signaled, waiting for it if asked
+    bool retire(Pending& frame, bool wait);
+
+    // Both floats of the total movement in one word, so the render thread reads them together
+    std::atomic<uint64_t> look_{0};
+    std::atomic<double> lookTime_{-1.0};
+
+    Pending pending_[MAX_QUEUED_FRAMES + 1];
+    // Oldest frame not retired, and frames in flight
+    int first_ = 0;
+    int count_ = 0;
+    double latchedTime_ = -1.0;
+    double measuredTime_ = -1.0;
+};
+
+#endif
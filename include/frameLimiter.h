@@ -0,0 +1,57 @@
+#ifndef FRAME_LIMITER_CLASS_H
+#define FRAME_LIMITER_CLASS_H
+
+#include <chrono>
+
+// Presents frames at an even pace. VSync lets the driver hold the swap, Uncapped draws as fast as
+// it can, and Capped starts a frame every 1 / targetFps seconds. The cap sleeps while the
+// deadline is far and spins the rest: the OS wakes sleeping threads up late by a varying amount,
+// so sleeping stops once less is left than a sleep has lately taken on average plus one standard
+// deviation.
+class FrameLimiter
+{
+public:
+    enum class Mode
+    {
+        VSync,
+        Uncapped,
+        Capped
+    };
+
+    Mode mode = Mode::VSync;
+    float targetFps = 120.0f;
+    // Of the display, the rate VSync presents at (glfwGetVideoMode, from the main thread)
+    float refreshRate = 60.0f;
+
+    // How far the time between two swaps was from the mode's period (the refresh period, the cap's,
+    // or the average one when uncapped), smoothed and the worst of about the last second, in
+    // microseconds
+    float pacingErrorUs = 0.0f;
+    float worstErrorUs = 0.0f;
+
+    // Sets the swap interval of the mode, on the thread the GL context is current on
+    void apply();
+    // Before the frame starts, returns once its deadline is reached in Capped mode
+    void wait();
+    // Right after the swap, measures the pacing
+    void presented();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void sleepUntil(Clock::time_point deadline);
+
+    Clock::time_point deadline_;
+    bool started_ = false;
+    Clock::time_point lastPresent_;
+    bool presented_ = false;
+    double averageInterval_ = 0.0;
+    Clock::time_point windowStart_;
+    float windowWorst_ = 0.0f;
+    // Duration of 1 ms sleeps: running mean and variance, in seconds
+    double sleepMean_ = 0.001;
+    double sleepVariance_ = 0.25e-6;
+    long long sleepCount_ = 1;
+};
+
+#endif
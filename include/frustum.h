@@ -0,0 +1,27 @@
+#ifndef FRUSTUM_CLASS_H
+#define FRUSTUM_CLASS_H
+
+#include <glm/glm.hpp>
+
+#include "simd.h"
+
+// The six planes of a view-projection matrix, stored plane-wise in two groups of four (the last
+// two slots never reject) so a bound is tested against all of them in two SIMD passes.
+class Frustum
+{
+public:
+    Frustum(const glm::mat4& viewProjection);
+
+    // False when the world space box is entirely outside one of the planes. inside is set when
+    // the box is inside all of them, so the subtree below needs no further test.
+    bool visible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool* inside = nullptr) const;
+    bool visible(const glm::vec3& center, float radius) const;
+
+private:
+    // Plane normals, their absolute values and distances, normals pointing inside
+    Float4 nx_[2], ny_[2], nz_[2];
+    Float4 ax_[2], ay_[2], az_[2];
+    Float4 d_[2];
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef GAME_SYSTEMS_CLASS_H
+#define GAME_SYSTEMS_CLASS_H
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "animationSystem.h"
+#include "camera.h"
+#include "node.h"
+#include "systemScheduler.h"
+#include "world.h"
+
+// Components of the game objects
+
+// Placement on the ground plane: turned around the vertical axis and scaled uniformly
+struct Transform
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = 0.0f;
+    float scale = 1.0f;
+};
+
+// Moved by the keyboard, relative to the camera's heading. Steps are distances per tick.
+struct PlayerControl
+{
+    Entity camera;
+    float walkStep = 0.05f;
+    float runStep = 0.09f;
+};
+
+// Walks back and forth along x, up to extent from center
+struct Patrol
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float extent = 1.0f;
+    float speed = 1.0f;
+    float direction = 1.0f;
+};
+
+// Speed (units per second) driving the character's blend tree in the AnimationSystem
+struct Locomotion
+{
+    int character = -1;
+    float speed = 0.0f;
+};
+
+// Third person camera orbiting its target, angles in degrees. eye and lookAt are the output.
+struct OrbitCamera
+{
+    Entity target;
+    float distance = 4.0f;
+    float pitch = 25.0f;
+    float yaw = 0.0f;
+    float sensitivity = 0.2f;
+    float minPitch = 5.0f;
+    float maxPitch = 85.0f;
+    glm::vec3 eye = glm::vec3(0.0f);
+    glm::vec3 lookAt = glm::vec3(0.0f);
+};
+
+struct PointLight
+{
+    glm::vec3 position = glm::vec3(0.0f);
+};
+
+// Moves a light along center + amplitude * cos(time * frequency)
+struct LightPath
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::vec3 amplitude = glm::vec3(0.0f);
+    float frequency = 1.0f;
+    float time = 0.0f;
+};
+
+// Scene node showing the entity
+struct Renderable
+{
+    NodeHandle node;
+};
+
+// Input gathered by the window for this update: move is (left, forward) in [-1, 1], look the
+// mouse movement in pixels while orbiting
+struct GameInput
+{
+    glm::vec2 move = glm::vec2(0.0f);
+    bool run = false;
+    glm::vec2 look = glm::vec2(0.0f);
+};
+
+// What the renderer needs of the World for one tick, handed to the render thread so it never
+// reads the World while the systems write it: where the scene nodes go, the characters' animation
+// inputs, the lights and the view. Placements are kept apart so they can be interpolated.
+struct RenderSnapshot
+{
+    struct NodeTransform
+    {
+        NodeHandle node;
+        glm::vec3 position;
+        float yaw;
+        float scale;
+    };
+    struct CharacterInput
+    {
+        int character;
+        float speed;
+        glm::vec3 position;
+    };
+
+    std::vector<NodeTransform> nodes;
+    std::vector<CharacterInput> characters;
+    std::vector<glm::vec3> lights;
+    glm::vec3 eye = glm::vec3(0.0f);
+    glm::vec3 lookAt = glm::vec3(0.0f, 0.0f, -1.0f);
+    // Mouse movement the view has taken in so far (FrameLatency::look() as of the tick), and the
+    // degrees per pixel it turns by
+    glm::vec2 look = glm::vec2(0.0f);
+    float sensitivity = 0.0f;
+    // The orbit's pitch and its limits, in degrees, so turns the ticks haven't taken in yet stop
+    // where the camera will
+    float pitch = 0.0f;
+    float minPitch = -85.0f;
+    float maxPitch = 85.0f;
+    // Clock time (glfwGetTime) the simulation had reached with this tick
+    double time = 0.0;
+
+    // Blends from toward to by alpha into result. Entries are matched by index and taken from to
+    // when they don't match, when something was spawned or destroyed in between.
+    static void interpolate(const RenderSnapshot& from, const RenderSnapshot& to, float alpha, RenderSnapshot& result);
+};
+
+// The last two ticks, the render thread draws the state between them at its own rate
+struct RenderTicks
+{
+    RenderSnapshot previous;
+    RenderSnapshot current;
+};
+
+// Events published on the EventBus
+
+// A key pressed, repeated or released, as GLFW reports it
+struct KeyEvent
+{
+    int key;
+    int action;
+    int mods;
+};
+
+// Whether a point is inside the level
+using Walkable = std::function<bool(const glm::vec3&)>;
+
+// Systems of the game, meant to be added to the scheduler in this order
+SystemScheduler::System lightAnimationSystem(World& world);
+SystemScheduler::System patrolSystem(World& world);
+SystemScheduler::System cameraLookSystem(World& world, const GameInput& input);
+SystemScheduler::System playerMovementSystem(World& world, const GameInput& input, Walkable walkable);
+// Pulls the camera in front of walls between it and its target
+SystemScheduler::System cameraFollowSystem(World& world, Walkable walkable);
+// Fills the snapshot with the state of the World: node placements, the characters' animation
+// inputs, the lights and the view of the given camera entity. The caller stamps and hands it over
+// after the tick.
+SystemScheduler::System renderExtractionSystem(World& world, Entity view, RenderSnapshot& snapshot);
+// Moves the scene nodes, the characters and the camera to the snapshot, on the render thread.
+// The camera is turned further around its target by lateLook, the mouse movement the simulation
+// hasn't seen yet.
+void applyRenderSnapshot(const RenderSnapshot& snapshot, Camera& camera, AnimationSystem& animations, float FOVdeg,
+                         float nearPlane, float farPlane, const glm::vec2& lateLook = glm::vec2(0.0f));
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef HUD_CLASS_H
+#define HUD_CLASS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shaderClass.h"
+
+// Embedded bitmap font (hudFont.cpp), printable ASCII only
+#define HUD_GLYPH_FIRST 32
+#define HUD_GLYPH_COUNT 95
+#define HUD_GLYPH_WIDTH 8
+#define HUD_GLYPH_HEIGHT 16
+extern const unsigned char hudGlyphs[HUD_GLYPH_COUNT][HUD_GLYPH_HEIGHT];
+
+// Screen overlay for text and flat UI quads. The font is rasterized once into a small atlas,
+// every quad queued during the frame goes into one streaming vertex buffer and draw() submits
+// them all with a single draw call. Static strings can be laid out once and reused.
+class Hud
+{
+public:
+    // Pixels per font pixel
+    int scale;
+
+    Hud(int screenWidth, int screenHeight, int scale = 1, int maxQuads = 4096);
+
+    // Positions are in pixels from the top left corner of the screen. '\n' starts a new line.
+    void text(float x, float y, const char* text, const glm::vec4& color = glm::vec4(1.0f));
+    void rect(float x, float y, float width, float height, const glm::vec4& color);
+
+    // Lays out a string once, cached() then only copies its quads at the given position
+    int cache(const std::string& text, const glm::vec4& color = glm::vec4(1.0f));
+    void cached(int id, float x, float y);
+
+    // Size of a line of text in pixels
+    glm::vec2 measure(const char* text) const;
+
+    // Uploads and draws everything queued since the last call, then empties the queue
+    void draw();
+    void Delete();
+
+private:
+    struct HudVertex
+    {
+        glm::vec2 position;
+        glm::vec2 uv;
+        uint32_t color;
+    };
+
+    void layout(std::vector<HudVertex>& out, float x, float y, const char* text, const glm::vec4& color) const;
+    void quad(std::vector<HudVertex>& out, glm::vec2 min, glm::vec2 max, glm::vec2 uvMin, glm::vec2 uvMax,
+              uint32_t color) const;
+
+    glm::vec2 screenSize_;
+    int maxQuads_;
+    std::vector<HudVertex> vertices_;
+    std::vector<std::vector<HudVertex>> cache_;
+
+    GLuint atlas_;
+    glm::ivec2 atlasSize_;
+    GLuint vao_;
+    GLuint vbo_;
+    GLuint ebo_;
+    Shader shader_;
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef JOB_SYSTEM_CLASS_H
+#define JOB_SYSTEM_CLASS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed pool of worker threads running small jobs. Every thread (the workers and the main thread,
+// the one that created the system) owns a Chase-Lev deque: it pushes and pops jobs at the bottom
+// while idle threads steal from the top of the others. Jobs are allocated from a per-thread ring
+// and keep their callable inline, so running one takes no lock and no heap allocation. A thread
+// whose ring wraps around skips the jobs still in flight, and helps with other jobs while they
+// all are.
+//
+// Counters track groups of jobs: a job started with a counter increments it and decrements it
+// when done, wait() helps with other jobs until it drops to zero, and a job can be held back
+// until a dependency counter drops to zero. GL jobs queue separately and run on the thread the GL
+// context is current on, when it waits or calls runGLJobs().
+//
+// Other threads (a render thread) can attach to one of the slots reserved at construction, after
+// which they queue and help with jobs like the main thread does. The GL thread is the main thread
+// until an attached thread takes the context over with setGLThread().
+class JobSystem
+{
+    struct Job;
+
+public:
+    // Jobs per thread deque, and most jobs a thread can have in flight
+    static const int QUEUE_SIZE = 4096;
+    // Largest callable a job holds, capture by reference past that
+    static const int JOB_DATA_BYTES = 64;
+
+    class Counter
+    {
+    public:
+        Counter() = default;
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        bool done() const { return pending_.load() == 0 && finishing_.load() == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending_{0};
+        // Threads inside finish(), the counter must outlive them
+        std::atomic<int> finishing_{0};
+        std::mutex mutex_;
+        // Jobs waiting for the counter to drop to zero
+        std::vector<Job*> dependents_;
+    };
+
+    // Started on first use, from the main thread, with threads threads in all (0 for one per core)
+    // and a slot for the render thread. threads is ignored once it is running.
+    static JobSystem& shared(unsigned int threads = 0);
+
+    explicit JobSystem(unsigned int workers, unsigned int attachable = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads running jobs, the main thread and the attachable slots included
+    unsigned int threadCount() const { return threadCount_; }
+    // Whether size items of work are worth spreading over the threads, past the caller's threshold
+    bool worthSplitting(size_t size, size_t threshold) const { return threadCount_ > 1 && size >= threshold; }
+    // Range size giving every thread a few ranges of count, so stealing evens them out
+    int balancedGrain(int count) const { return std::max(1, (count + (int)threadCount_ * 4 - 1) / ((int)threadCount_ * 4)); }
+    // 0 on the main thread, 1... on the workers and attached threads, -1 on threads outside the system
+    static int threadIndex();
+
+    // Takes a free attachable slot for the calling thread, false when there is none left. The
+    // thread must wait for its jobs and detach before it ends.
+    bool attachThread();
+    // Runs the GL jobs left when the calling thread is the GL thread, which goes back to the main
+    // thread
+    void detachThread();
+    // Makes the calling thread, attached and with the GL context current, the one GL jobs run on
+    void setGLThread();
+
+    // Runs f() on any thread, once dependency (if any) is done. Called from a thread outside the
+    // system, f() runs right away.
+    template <typename F>
+    void run(F&& f, Counter* counter = nullptr, Counter* dependency = nullptr)
+    {
+        int thread = threadIndex();
+        if (thread < 0)
+        {
+            f();
+            return;
+        }
+        Job* job = allocate(thread, std::forward<F>(f), counter);
+        if (dependency)
+        {
+            std::lock_guard<std::mutex> lock(dependency->mutex_);
+            if (dependency->pending_.load() > 0)
+            {
+                dependency->dependents_.push_back(job);
+                return;
+            }
+        }
+        enqueue(thread, job);
+    }
+
+    // Runs f() on the GL thread, from any thread of the system
+    template <typename F>
+    void runOnGLThread(F&& f, Counter* counter = nullptr)
+    {
+        int thread = threadIndex();
+        if (thread < 0)
+        {
+            std::cerr << "Error: GL job queued from a thread outside the job system" << std::endl;
+            return;
+        }
+        Job* job = allocate(thread, std::forward<F>(f), counter);
+        std::lock_guard<std::mutex> lock(glMutex_);
+        glJobs_.push_back(job);
+    }
+
+    // Runs other jobs until the counter is done
+    void wait(Counter& counter);
+    // Runs the GL jobs queued so far, on the GL thread only
+    void runGLJobs();
+
+    // Calls f(begin, end) over [0, count) in ranges of grain items spread over the threads, and
+    // returns once they are all done. The calling thread takes the first range.
+    template <typename F>
+    void parallelFor(int count, int grain, F&& f)
+    {
+        if (count <= 0)
+        {
+            return;
+        }
+        // Ranges are queued by this thread, they must fit its deque
+        grain = std::max(grain, std::max(1, (count + QUEUE_SIZE / 2 - 1) / (QUEUE_SIZE / 2)));
+        if (threadCount_ < 2 || count <= grain || threadIndex() < 0)
+        {
+            f(0, count);
+            return;
+        }
+
+        Counter counter;
+        for (int begin = grain; begin < count; begin += grain)
+        {
+            int end = std::min(count, begin + grain);
+            run([&f, begin, end]() { f(begin, end); }, &counter);
+        }
+        f(0, grain);
+        wait(counter);
+    }
+
+private:
+    struct Job
+    {
+        void (*function)(Job& job);
+        Counter* counter;
+        // From allocation until the job has run, the slot can't be reused meanwhile
+        std::atomic<bool> busy{false};
+        alignas(std::max_align_t) unsigned char data[JOB_DATA_BYTES];
+    };
+
+    // Lock-free work stealing deque of fixed capacity (Chase and Lev, with the memory orders of
+    // Le et al. 2013). Only the owner pushes and pops, any thread steals.
+    struct Deque
+    {
+        std::atomic<int64_t> top{0};
+        std::atomic<int64_t> bottom{0};
+        std::atomic<Job*> buffer[QUEUE_SIZE];
+
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+    };
+
+    struct alignas(64) ThreadState
+    {
+        Deque deque;
+        Job jobs[QUEUE_SIZE];
+        uint32_t nextJob = 0;
+        uint32_t random = 0;
+    };
+
+    template <typename F>
+    Job* allocate(int thread, F&& f, Counter* counter)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(sizeof(Callable) <= JOB_DATA_BYTES, "job too large, capture by reference");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "over-aligned job");
+
+        Job* job = claim(thread);
+        new (job->data) Callable(std::forward<F>(f));
+        job->function = [](Job& self) {
+            Callable* callable = std::launder(reinterpret_cast<Callable*>(self.data));
+            (*callable)();
+            callable->~Callable();
+        };
+        job->counter = counter;
+        if (counter)
+        {
+            counter->pending_.fetch_add(1);
+        }
+        return job;
+    }
+
+    // Next free slot of the thread's ring
+    Job* claim(int thread);
+    // Runs one job the thread can take, false when there was none
+    bool help(int thread);
+    // Queues the job on the thread's deque, runs it right away if the deque is full
+    void enqueue(int thread, Job* job);
+    void execute(Job* job);
+    // Decrements the job's counter and releases the jobs waiting for it
+    void finish(Counter* counter);
+    // A job from the thread's deque, or stolen from another
+    Job* take(int thread);
+    void workerLoop(int thread);
+
+    unsigned int threadCount_;
+    unsigned int firstAttachable_;
+    std::unique_ptr<ThreadState[]> threads_;
+    std::vector<std::thread> workers_;
+    std::mutex attachMutex_;
+    std::vector<bool> attached_;
+
+    // Deque jobs not taken yet, the workers sleep while there are none
+    std::atomic<int> queued_{0};
+    std::atomic<int> sleeping_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+
+    // Index of the thread GL jobs run on
+    std::atomic<int> glThread_{0};
+    std::mutex glMutex_;
+    std::vector<Job*> glJobs_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef LIGHTMAP_CLASS_H
+#define LIGHTMAP_CLASS_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "staticLevel.h"
+
+// Baked lighting for the static surfaces: an RGB irradiance atlas plus the lightmap UVs of every
+// vertex, keyed by surface name. Written by the Baker target and read back by the game, so this
+// file stays free of GL calls.
+class Lightmap
+{
+public:
+    struct Surface
+    {
+        std::string name;
+        std::vector<glm::vec2> uvs;
+    };
+
+    int width = 0;
+    int height = 0;
+    // Linear RGB, row 0 at the bottom (GL convention)
+    std::vector<glm::vec3> texels;
+    std::vector<Surface> surfaces;
+
+    // Gives every planar group of triangles its own chart and shelf-packs the charts in an atlas
+    // of the given width, growing the height as needed. Fills the surfaces' UVs.
+    void unwrap(const StaticSurface* staticSurfaces, size_t count, float texelsPerUnit, int atlasWidth, int padding);
+
+    const Surface* find(const std::string& name) const;
+    // Copies the UVs into the vertex arrays of the matching static surfaces
+    void applyUVs(StaticSurface* staticSurfaces, size_t count) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef MATERIAL_CLASS_H
+#define MATERIAL_CLASS_H
+
+#include <string>
+#include <vector>
+
+#include "texture.h"
+
+// Packed texture set of a room surface (see CookedMaterial): "diffuse" albedo with the occlusion in
+// alpha and a "surface" texture with normal xy, roughness and height
+class Material
+{
+public:
+    Texture albedo;
+    Texture surface;
+
+    // Loads ./materials/<name>.mat written by the Cooker target, or cooks ./textures/<name>_*.png in
+    // memory when the cooker hasn't been run
+    Material(const std::string& name, GLuint albedoSlot = 0, GLuint surfaceSlot = 1);
+
+    // Textures for a Mesh, albedo first
+    std::vector<Texture> textures() const;
+    void Delete();
+};
+
+#endif
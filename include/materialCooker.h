@@ -0,0 +1,52 @@
+#ifndef MATERIAL_COOKER_CLASS_H
+#define MATERIAL_COOKER_CLASS_H
+
+#include <string>
+#include <vector>
+
+// One cooked texture: 8 bit channels, tightly packed, row 0 at the bottom (GL convention), with
+// its whole mip chain so the game doesn't have to generate mipmaps at load time
+struct CookedImage
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<std::vector<unsigned char>> mips;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+// The packed texture set of a room surface, described by <name>.mat:
+//     albedo   rgb = albedo, a = ambient occlusion (rgb only when there is no height map to derive it from)
+//     surface  rg = tangent space normal xy (z is rebuilt in the shader), b = roughness, a = height
+// Two samplers instead of the four source maps, written by the Cooker target and read back by
+// Material, so this file stays free of GL calls.
+struct CookedMaterial
+{
+    std::string name;
+    CookedImage albedo;
+    CookedImage surface;
+
+    // Writes dir/<name>.mat and the two images next to it
+    bool save(const std::string& dir) const;
+    bool load(const std::string& dir, const std::string& name);
+};
+
+class MaterialCooker
+{
+public:
+    // Used when a surface ships no roughness map
+    float defaultRoughness = 0.6f;
+    // Cavity occlusion from the height map: how dark a texel gets below its neighbourhood
+    float occlusionStrength = 4.0f;
+    // Neighbourhood radius as a fraction of the height map width
+    float occlusionRadius = 1.0f / 64.0f;
+
+    // Cooks sourceDir/<name>_albedo.png with the matching _normal, _roughness and _height maps,
+    // only the albedo is required. Maps of different sizes are resampled to the albedo (albedo
+    // texture) and to the normal map (surface texture).
+    bool cook(const std::string& sourceDir, const std::string& name, CookedMaterial& material) const;
+};
+
+#endif
@@ -8,24 +8,75 @@
 #include"camera.h"
 #include"texture.h"
 #include"shaderClass.h"
+#include"pool.h"
+
+class Mesh;
+using MeshHandle = Handle<Mesh>;
 
 class Mesh
 {
 public:
+	// One bone of a skinned mesh: the joint of the model it follows, and the mesh space to bone
+	// space matrix of the bind pose (aiBone::mOffsetMatrix)
+	struct Bone
+	{
+		std::string name;
+		int joint;
+		glm::mat4 offset;
+	};
+	// Most bones a mesh can have, the size of the Joints uniform block of the shaders
+	static const int MAX_BONES = 128;
+	// Size of the pool scene meshes are created in
+	static const int MAX_MESHES = 1024;
+
 	// Stores the vertex data
 	std::vector <Vertex> vertices;
 	std::vector <GLuint> indices;
 	std::vector <Texture> textures;
+	// Skin of the vertices (bone indices into bones) and the bones, empty for rigid meshes
+	std::vector <SkinVertex> skin;
+	std::vector <Bone> bones;
+	// Skinning matrix of every bone as of the last setPose(), identity in the bind pose
+	std::vector <glm::mat4> pose;
+	// Uniform buffer the pose is uploaded to, 0 for rigid meshes
+	GLuint palette = 0;
 	// Store VAO in public so it can be used in the Draw function
 	VAO vao;
+	// Local space bounding box of the vertices
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	// Local space bounding sphere, centered on the box
+	glm::vec3 boundsCenter;
+	float boundsRadius;
 
 	//Store shader to draw nodes more easily
 	Shader shader;
 
 	// Initializes the mesh
-	Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures,Shader& shader);
+	Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures,Shader& shader,
+		const std::vector <SkinVertex>& skin = {}, const std::vector <Bone>& bones = {});
+
+	// Meshes of the scene, the nodes refer to them by handle
+	static Pool<Mesh>& pool();
+
+	bool skinned() const { return palette != 0; }
+	// Uploads a pose given as the skinning matrices of the model's joints (bind pose mesh space to
+	// posed mesh space), each bone picking the matrix of its joint
+	void setPose(const std::vector <glm::mat4>& jointMatrices);
 
 	// Draws the mesh
 	void Draw(Camera& camera);
+	// Binds the geometry, textures and pose to the active shader, for drawing the mesh several
+	// times in a row with DrawBound()
+	void Bind();
+	void DrawBound();
+	// Binds the textures to the shader's samplers (diffuse0, specular0, surface0...)
+	void BindTextures();
+	// Draws the geometry only with the given depth shader, already active (shadow and depth passes)
+	void DrawDepth(Shader& depthShader);
+
+private:
+	// Binds the pose to the shader's Joints block and flags the shader as skinning, or not
+	void BindPalette(Shader& target);
 };
 #endif
\ No newline at end of file
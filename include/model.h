@@ -14,11 +14,17 @@
 class Model 
 {
 public:
-    // The meshes are now public to be added to the scene graph
-    std::vector<Mesh> meshes;
+    // The meshes are now public to be added to the scene graph, they live in Mesh::pool()
+    std::vector<MeshHandle> meshes;
+    // Joints the bones of the skinned meshes follow, merged by name in the order the meshes are
+    // loaded (the joint order of the palettes the Animator bakes)
+    std::vector<std::string> joints;
 
     Model(std::string const &path, Shader &shader);
 
+    // Poses every skinned mesh, see Mesh::setPose
+    void setPose(const std::vector<glm::mat4>& jointMatrices);
+
 private:
     std::string directory;
     std::vector<Texture> textures_loaded;
@@ -26,7 +32,8 @@ private:
 
     void loadModel(std::string const &path);
     void processNode(aiNode *node, const aiScene *scene);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+    MeshHandle processMesh(aiMesh *mesh, const aiScene *scene);
+    void processSkin(aiMesh *mesh, std::vector<SkinVertex>& skin, std::vector<Mesh::Bone>& bones);
     std::vector<Texture> loadMaterialTextures(aiMaterial *mat, const aiScene *scene, aiTextureType type, std::string typeName);
 };
 
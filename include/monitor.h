@@ -0,0 +1,55 @@
+#ifndef MONITOR_CLASS_H
+#define MONITOR_CLASS_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "node.h"
+#include "portal.h"
+#include "occlusion.h"
+#include "texture.h"
+
+// In-world monitor screens showing the scene from fixed security cameras. Each monitor renders
+// into its own small texture, and only while its screen is seen: it has to be inside the viewer's
+// frustum, in a cell the portals reached and not hidden by the occluders. Seen monitors are then
+// refreshed at their own rate, the most overdue first, at most maxRefreshesPerFrame per frame.
+// The scene is drawn through the same Node culling, portals and occlusion as the main view.
+class MonitorSystem
+{
+public:
+    int maxRefreshesPerFrame = 1;
+    // Monitors seen and re-rendered during the last render(), for tuning
+    int visibleMonitors = 0;
+    int refreshes = 0;
+
+    int addMonitor(const glm::vec3& position, const glm::vec3& target, int width = 256, int height = 144,
+                   float refreshRate = 10.0f, float FOVdeg = 70.0f);
+    // Node drawing the monitor's picture, used to know whether the monitor is seen
+    void setScreen(int monitor, NodeHandle screen) { monitors_[monitor].screen = screen; }
+    // Picture of the monitor, to put on the screen mesh as its diffuse texture
+    Texture texture(int monitor) const;
+
+    // Refreshes the monitors that are seen and due. Uses the portal and occlusion state left by
+    // the viewer's last frame, so it must run before they are updated for the viewer.
+    void render(Node& root, const Camera& viewer, double time, PortalSystem* portals = nullptr,
+                OcclusionCuller* occlusion = nullptr);
+    void Delete();
+
+private:
+    struct Monitor
+    {
+        Camera camera;
+        float refreshInterval;
+        double lastRefresh = -1e9;
+        NodeHandle screen = {};
+        GLuint texture = 0;
+        GLuint depth = 0;
+        GLuint fbo = 0;
+    };
+
+    std::vector<Monitor> monitors_;
+};
+
+#endif
@@ -6,22 +6,107 @@
 #include "mesh.h"
 #include "shaderClass.h"
 #include "camera.h"
+#include "occlusion.h"
+#include "frustum.h"
+#include "drawList.h"
+#include "transformSystem.h"
+#include "pool.h"
 
 class Shape;
+class Node;
+using NodeHandle = Handle<Node>;
 
+// A node is a handle to its transform in the shared TransformSystem, plus the meshes it draws and
+// the cached bounds of its subtree. Nodes live in a fixed pool and refer to each other and to
+// their meshes by handle, so spawning and despawning them doesn't allocate and a destroyed node
+// or mesh is skipped rather than dangling.
 class Node
 {
 public:
-    Node(const glm::mat4 &transform = glm::mat4(1.0f));
-    void add(Node *node);
-    void add(Mesh *mesh);
-    void draw(Camera& camera, const glm::mat4& parentTransform);
-    void key_handler(int key) const;
-    void transform(const glm::mat4 &transform) { transform_ = transform_ * transform; }
-    void setTransform(const glm::mat4& transform) { transform_ = transform; }
+    static const int MAX_NODES = 16384;
+    static const int MAX_MESHES_PER_NODE = 8;
+
+    static Pool<Node>& pool();
+    // Transforms of every node, their world matrices are brought up to date by the traversals below
+    static TransformSystem& transforms();
+
+    // A null handle when the pool is full
+    static NodeHandle create(const glm::mat4 &transform = glm::mat4(1.0f));
+    // Destroys the node and its subtree, the meshes are left alone
+    static void destroy(NodeHandle node);
+    NodeHandle handle() const { return self_; }
+
+    // Moves the node, and its subtree, under this one
+    void add(NodeHandle node);
+    void add(MeshHandle mesh);
+    // Skips subtrees whose bounds are outside the camera frustum, and the node's meshes when they
+    // are hidden behind the occluders. Goes through a DrawList, shared by every call.
+    void draw(Camera& camera, OcclusionCuller* occlusion = nullptr);
+    // Appends the node's own visible meshes to items, false when its whole subtree is culled.
+    // inside is updated like Frustum::visible's. Reads the bounds of the last updateBounds() only,
+    // so threads can cull disjoint subtrees at the same time.
+    bool cull(const Frustum& frustum, OcclusionCuller* occlusion, bool& inside, std::vector<DrawList::Item>& items) const;
+    // The same over the whole subtree
+    void collectVisible(const Frustum& frustum, OcclusionCuller* occlusion, bool inside, std::vector<DrawList::Item>& items) const;
+    const Node* firstChild() const { return firstChild_.get(); }
+    const Node* nextSibling() const { return nextSibling_.get(); }
+    // Draws the shadow casters of the subtree whose dynamic flag matches, using the given depth shader
+    void drawDepth(Shader& shader, bool dynamicCasters);
+    void transform(const glm::mat4 &transform) { setTransform(transforms().local(transform_) * transform); }
+    void setTransform(const glm::mat4& transform) { transforms().setLocal(transform_, transform); invalidate(); }
+    const glm::mat4& world() const { return transforms().world(transform_); }
+    // Dynamic nodes are re-rendered into the shadow maps every frame, static ones are cached
+    void setDynamic(bool dynamic) { dynamic_ = dynamic; }
+    void setCastShadows(bool castShadows) { castShadows_ = castShadows; }
+    // Occluder meshes are rasterized by the OcclusionCuller, meant for large static walls
+    void setOccluder(bool occluder) { occluder_ = occluder; }
+    // Hands the world space triangles of the subtree's occluders to the culler
+    void addOccluders(OcclusionCuller& occlusion) const;
+    // Refits the world space bounds of the subtrees whose transforms changed since the last call
+    void updateBounds();
+    // World space box around the subtree's meshes as of the last updateBounds(), false when empty
+    bool bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+    // Culled nodes and their subtree are skipped by draw() but still cast shadows
+    void setCulled(bool culled) { culled_ = culled; }
+    bool culled() const { return culled_; }
 
 private:
-    glm::mat4 transform_;
-    std::vector<Node *> children_;
-    std::vector<Mesh *> children_mesh_;
+    friend class Pool<Node>;
+    Node(const glm::mat4 &transform);
+
+    // Unlinks the node from its parent's children
+    void detach();
+    // Marks the node's bounds for recomputation and its ancestors' for refitting
+    void invalidate();
+    // Marks the subtree bounds of the node and its ancestors for refitting
+    static void invalidateBounds(NodeHandle node);
+    void refit(bool force);
+    void drawCasters(Shader& shader, bool dynamicCasters);
+    void collectOccluders(OcclusionCuller& occlusion) const;
+
+    // Id in transforms()
+    int transform_;
+    NodeHandle self_;
+    NodeHandle parent_;
+    NodeHandle firstChild_;
+    NodeHandle lastChild_;
+    NodeHandle nextSibling_;
+    NodeHandle previousSibling_;
+    MeshHandle meshes_[MAX_MESHES_PER_NODE];
+    int meshCount_ = 0;
+    bool dynamic_ = false;
+    bool castShadows_ = true;
+    bool occluder_ = false;
+    bool culled_ = false;
+
+    // Cached by refit(): world scale, bounds of the own meshes and of the whole subtree
+    bool transformDirty_ = true;
+    bool boundsDirty_ = true;
+    float scale_ = 1.0f;
+    bool hasOwnBounds_ = false;
+    glm::vec3 ownMin_ = glm::vec3(0.0f);
+    glm::vec3 ownMax_ = glm::vec3(0.0f);
+    bool hasSubtreeBounds_ = false;
+    glm::vec3 subtreeMin_ = glm::vec3(0.0f);
+    glm::vec3 subtreeMax_ = glm::vec3(0.0f);
 };
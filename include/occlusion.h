@@ -0,0 +1,79 @@
+#ifndef OCCLUSION_CLASS_H
+#define OCCLUSION_CLASS_H
+
+#include <atomic>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Software occlusion culling. The static occluders (walls) are rasterized every frame into a small
+// CPU depth buffer, 4 pixels at a time with SSE, in screen tiles that are spread over threads once
+// there is enough work. Bounding boxes are then tested against it before their meshes are drawn.
+//
+// Everything is conservative so nothing visible is ever rejected: occluders only write pixels they
+// fully cover, with the farthest depth they reach inside the pixel, and boxes are tested with their
+// nearest depth over every pixel their projection touches. Depth is stored as 1/w (larger is
+// closer), which interpolates linearly in screen space and keeps its precision with the far plane
+// at 10000.
+class OcclusionCuller
+{
+public:
+    // Boxes tested and rejected since the last render(), for tuning. visible() is called from the
+    // draw list's jobs.
+    std::atomic<int> tested{0};
+    std::atomic<int> culled{0};
+    // Tiles are only farmed out to the JobSystem past parallelThreshold binned polygons
+    size_t parallelThreshold = 2048;
+
+    // width must be a multiple of the 16 pixel tile width
+    OcclusionCuller(int width = 256, int height = 144);
+
+    // Occluders are static and given in world space. Coplanar triangle pairs of the mesh are merged
+    // back into convex quads, otherwise every wall would leak along its diagonal.
+    void addOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    void clearOccluders() { occluders_.clear(); }
+
+    // Rasterizes the occluders for this frame's camera
+    void render(const glm::mat4& viewProjection);
+    // False when the world space box is hidden behind the occluders or entirely off screen. Safe to
+    // call from several threads between two render() calls.
+    bool visible(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    const std::vector<float>& depth() const { return depth_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    // Convex triangle or quad
+    struct Occluder
+    {
+        glm::vec3 corners[4];
+        int count;
+    };
+
+    // Screen space convex polygon ready for the tiles (a quad clipped by the near plane has up to
+    // 5 edges, unused ones always pass): edge functions and depth plane evaluated at pixel centers
+    // and already pulled in by half a pixel for conservativeness
+    struct Polygon
+    {
+        glm::vec3 edges[5];
+        glm::vec3 depth;
+        glm::ivec4 bounds;
+    };
+
+    void setup(const glm::vec4* clip, int count);
+    void rasterizeTile(int tile);
+
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    glm::mat4 viewProjection_ = glm::mat4(1.0f);
+    std::vector<Occluder> occluders_;
+    std::vector<Polygon> polygons_;
+    std::vector<std::vector<unsigned int>> bins_;
+    std::vector<float> depth_;
+    // Farthest depth of each tile, lets fully occluded tiles skip the per pixel test
+    std::vector<float> tileFarthest_;
+};
+
+#endif
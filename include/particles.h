@@ -0,0 +1,106 @@
+#ifndef PARTICLES_CLASS_H
+#define PARTICLES_CLASS_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "portal.h"
+#include "shaderClass.h"
+
+// Particle emitters (dust, sparks, steam...). Particles are stored as structure of arrays and
+// updated 4 at a time with the Float4 helpers, large emitters being split over threads. Every
+// visible particle becomes one compact instance (position, size, packed color) and all emitters
+// are drawn together as camera facing quads with a single glDrawArraysInstanced. Quads fade out
+// where they get close to the scene depth instead of clipping through it.
+class ParticleSystem
+{
+public:
+    struct Emitter
+    {
+        // Particles spawn in a box around the position
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 spawnExtent = glm::vec3(0.0f);
+        glm::vec3 velocity = glm::vec3(0.0f);
+        // Random velocity added in [-jitter, jitter] on each axis
+        glm::vec3 velocityJitter = glm::vec3(0.0f);
+        glm::vec3 gravity = glm::vec3(0.0f);
+        // Fraction of the velocity lost per second
+        float drag = 0.0f;
+        float lifetime = 1.0f;
+        float lifetimeJitter = 0.0f;
+        // Particles spawned per second, never more than budget alive at once
+        float rate = 100.0f;
+        int budget = 1000;
+        float sizeStart = 0.05f;
+        float sizeEnd = 0.05f;
+        glm::vec4 colorStart = glm::vec4(1.0f);
+        glm::vec4 colorEnd = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+        // Additive particles add their light instead of covering what is behind them
+        bool additive = false;
+        // Portal cell the emitter lives in, -1 to ignore the portals
+        int cell = -1;
+    };
+
+    // An emitter is only split over the JobSystem past parallelThreshold particles
+    int parallelThreshold = 16384;
+    // Distance over which particles fade out in front of the scene
+    float softDistance = 0.1f;
+
+    // Particles alive, drawn and emitters drawn after the last update(), for tuning
+    int alive = 0;
+    int drawn = 0;
+    int visibleEmitters = 0;
+
+    ParticleSystem(int maxInstances = 131072);
+
+    int addEmitter(const Emitter& emitter);
+    Emitter& emitter(int index) { return emitters_[index].settings; }
+
+    // Spawns, moves and ages every particle, then fills the instances of the emitters that are
+    // in a visible cell and inside the camera frustum
+    void update(float dt, const Camera& camera, const PortalSystem* portals = nullptr);
+    // Draws every instance after the opaque scene, whose depth it samples for the soft fade
+    void draw(const Camera& camera, float nearPlane, float farPlane);
+    void Delete();
+
+private:
+    struct Instance
+    {
+        glm::vec4 positionSize;
+        uint32_t color;
+    };
+
+    struct EmitterState
+    {
+        Emitter settings;
+        // Structure of arrays, capacity rounded up to whole SIMD groups
+        std::vector<float> px, py, pz, vx, vy, vz, age, life;
+        int count = 0;
+        float spawnDebt = 0.0f;
+        uint32_t random = 1;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+
+    void spawn(EmitterState& state, float dt);
+    void simulate(EmitterState& state, int begin, int end, float dt, glm::vec3& boundsMin, glm::vec3& boundsMax);
+    void fill(const EmitterState& state, int begin, int end, Instance* out) const;
+    // Runs task(begin, end, worker) over [0, count), split into jobs when count is large enough
+    template <typename Task>
+    void parallel(int count, Task task);
+
+    std::vector<EmitterState> emitters_;
+    std::vector<Instance> instances_;
+    int maxInstances_;
+
+    GLuint vao_;
+    GLuint instanceBuffer_;
+    GLuint depthTexture_ = 0;
+    glm::ivec2 depthSize_ = glm::ivec2(0);
+    Shader shader_;
+};
+
+#endif
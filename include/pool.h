@@ -0,0 +1,141 @@
+#ifndef POOL_CLASS_H
+#define POOL_CLASS_H
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+// 32 bit reference to an object of a Pool: the slot index in the low bits and the slot's
+// generation in the high ones. Destroying the object bumps the generation, so handles to it
+// resolve to nullptr afterwards instead of to whatever reuses the slot. The zero handle is null.
+// Resolving goes through T::pool(), the pool every T lives in.
+template <typename T>
+struct Handle
+{
+    static const int INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    uint32_t value = 0;
+
+    Handle() = default;
+    Handle(uint32_t index, uint32_t generation) : value(generation << INDEX_BITS | index) {}
+
+    uint32_t index() const { return value & INDEX_MASK; }
+    uint32_t generation() const { return value >> INDEX_BITS; }
+
+    // nullptr once the object was destroyed
+    T* get() const { return T::pool().get(*this); }
+    T* operator->() const { return get(); }
+    T& operator*() const { return *get(); }
+    explicit operator bool() const { return get() != nullptr; }
+    bool operator==(const Handle& other) const { return value == other.value; }
+    bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+// Fixed capacity storage of T. The slots are allocated once, up front, so creating and
+// destroying objects never touches the heap and objects never move: they sit side by side in
+// one array, in the order of their slots. Freed slots are reused last in, first out.
+template <typename T>
+class Pool
+{
+public:
+    explicit Pool(uint32_t capacity)
+        : capacity_(capacity < Handle<T>::INDEX_MASK ? capacity : Handle<T>::INDEX_MASK),
+          storage_(new Storage[capacity_]), generations_(new uint32_t[capacity_]), free_(new uint32_t[capacity_])
+    {
+        for (uint32_t i = 0; i < capacity_; i++)
+        {
+            // Odd generations are live objects, so 0 never names one
+            generations_[i] = 0;
+            free_[i] = capacity_ - 1 - i;
+        }
+        freeCount_ = capacity_;
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool()
+    {
+        for (uint32_t i = 0; i < capacity_; i++)
+        {
+            if (generations_[i] & 1)
+            {
+                at(i)->~T();
+            }
+        }
+    }
+
+    // A null handle when the pool is full
+    template <typename... Args>
+    Handle<T> create(Args&&... args)
+    {
+        if (freeCount_ == 0)
+        {
+            return Handle<T>();
+        }
+        uint32_t index = free_[--freeCount_];
+        new (&storage_[index]) T(std::forward<Args>(args)...);
+        generations_[index] = (generations_[index] + 1) & generationMask;
+        return Handle<T>(index, generations_[index]);
+    }
+
+    // Stale and null handles are ignored
+    void destroy(Handle<T> handle)
+    {
+        T* object = get(handle);
+        if (!object)
+        {
+            return;
+        }
+        object->~T();
+        generations_[handle.index()] = (generations_[handle.index()] + 1) & generationMask;
+        free_[freeCount_++] = handle.index();
+    }
+
+    T* get(Handle<T> handle) const
+    {
+        uint32_t index = handle.index();
+        if (index >= capacity_ || !(handle.generation() & 1) || generations_[index] != handle.generation())
+        {
+            return nullptr;
+        }
+        return at(index);
+    }
+
+    uint32_t size() const { return capacity_ - freeCount_; }
+    uint32_t capacity() const { return capacity_; }
+
+    // Calls visit(T&) on every live object, in slot order
+    template <typename Visit>
+    void forEach(Visit visit)
+    {
+        for (uint32_t i = 0; i < capacity_; i++)
+        {
+            if (generations_[i] & 1)
+            {
+                visit(*at(i));
+            }
+        }
+    }
+
+private:
+    static const uint32_t generationMask = ~0u >> Handle<T>::INDEX_BITS;
+
+    struct Storage
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    T* at(uint32_t index) const { return std::launder(reinterpret_cast<T*>(storage_[index].bytes)); }
+
+    uint32_t capacity_;
+    std::unique_ptr<Storage[]> storage_;
+    std::unique_ptr<uint32_t[]> generations_;
+    // Stack of the free slot indices
+    std::unique_ptr<uint32_t[]> free_;
+    uint32_t freeCount_ = 0;
+};
+
+#endif
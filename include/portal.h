@@ -0,0 +1,75 @@
+#ifndef PORTAL_CLASS_H
+#define PORTAL_CLASS_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "node.h"
+
+// Cell-and-portal visibility. Rooms are cells (boxes), doorways are portal polygons between two
+// cells. Every frame the screen rectangle is narrowed through each portal seen from the camera's
+// cell, recursively, and only the nodes of the cells reached are drawn. The walk never leaves
+// the visible portals, so its cost follows what is on screen rather than the size of the level.
+class PortalSystem
+{
+public:
+    // Cells reached and portals projected by the last update(), for tuning
+    int visibleCells = 0;
+    int portalsTested = 0;
+
+    int addCell(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    void addPortal(int cellA, int cellB, const glm::vec3* corners, int count);
+    // The node (and its subtree) is drawn only while its cell is seen. Nodes on a cell boundary,
+    // like the caps around a doorway, can be added to both cells. Destroyed nodes are dropped by update().
+    void addNode(int cell, NodeHandle node);
+
+    // Cell containing the position, -1 when outside every cell. Starts from the last cell found.
+    int findCell(const glm::vec3& position);
+    // Culls the nodes of every cell not seen from the camera. Everything is drawn while the
+    // camera is outside the cells.
+    void update(const glm::mat4& viewProjection, const glm::vec3& eye);
+    bool cellVisible(int cell) const { return cells_[cell].visible; }
+
+private:
+    // Normalized device coordinates
+    struct Rect
+    {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    struct Portal
+    {
+        int cells[2];
+        std::vector<glm::vec3> corners;
+        glm::vec3 normal;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    struct Cell
+    {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::vector<int> portals;
+        std::vector<NodeHandle> nodes;
+        bool visible = false;
+        bool onPath = false;
+        // Union of the rectangles the cell was seen through this frame
+        Rect rect;
+    };
+
+    void visit(int cell, const Rect& rect);
+    // Screen rectangle of the portal, false when it is behind the camera
+    bool project(const Portal& portal, Rect& rect) const;
+    void show(int cell);
+
+    std::vector<Cell> cells_;
+    std::vector<Portal> portals_;
+    std::vector<int> shown_;
+    int lastCell_ = -1;
+    glm::mat4 viewProjection_ = glm::mat4(1.0f);
+    glm::vec3 eye_ = glm::vec3(0.0f);
+};
+
+#endif
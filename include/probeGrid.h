@@ -0,0 +1,44 @@
+#ifndef PROBE_GRID_CLASS_H
+#define PROBE_GRID_CLASS_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "staticLevel.h"
+
+// Baked irradiance probes, one regular grid per room. Every probe stores L1 spherical harmonics
+// already convolved with the cosine lobe, so the irradiance for a normal n is, per color channel,
+//     E(n) = c.x + dot(c.yzw, n)
+// The room grids sit side by side along x in a single atlas. Written by the Baker target and read
+// back by ProbeVolume, so this file stays free of GL calls.
+class ProbeGrid
+{
+public:
+    struct Room
+    {
+        std::string name;
+        // Positions of the first and last probe
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::ivec3 size;
+        // Position of the room's grid in the atlas, in probes
+        glm::ivec3 offset;
+    };
+
+    std::vector<Room> rooms;
+    glm::ivec3 atlasSize = glm::ivec3(0);
+    // One array per color channel, atlasSize.x * atlasSize.y * atlasSize.z probes each
+    std::vector<glm::vec4> coefficients[3];
+
+    // Places probes every `spacing` units inside each room, kept `margin` away from the walls
+    void layout(const StaticRoom* staticRooms, size_t count, float spacing, float margin);
+
+    size_t index(const glm::ivec3& atlasCoord) const;
+    glm::vec3 position(const Room& room, const glm::ivec3& probe) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+#endif
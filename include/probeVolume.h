@@ -0,0 +1,32 @@
+#ifndef PROBE_VOLUME_CLASS_H
+#define PROBE_VOLUME_CLASS_H
+
+#include <GL/glew.h>
+
+#include "probeGrid.h"
+#include "shaderClass.h"
+
+// Must match MAX_PROBE_ROOMS in default.vert
+#define MAX_PROBE_ROOMS 8
+
+// GPU side of a baked ProbeGrid: the coefficient atlas lives in one RGBA16F 3D texture with the
+// red, green and blue channels stacked along z, sampled with hardware trilinear filtering in
+// default.vert for every vertex that isn't lightmapped
+class ProbeVolume
+{
+public:
+    GLuint ID = 0;
+
+    // Uploads the grid, leaves ID at 0 if the grid is empty
+    ProbeVolume(const ProbeGrid& grid);
+
+    // Binds the volume to the given texture unit and uploads the room layout
+    void apply(Shader& shader, GLuint unit);
+    void Delete();
+
+private:
+    std::vector<ProbeGrid::Room> rooms_;
+    glm::ivec3 atlasSize_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RAYTRACER_CLASS_H
+#define RAYTRACER_CLASS_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "simd.h"
+
+// CPU ray tracer used by the offline bakers. Triangles are stored in a binned-SAH BVH and
+// traced four rays at a time; the rays of a packet don't need to be coherent.
+
+struct RayTriangle
+{
+    glm::vec3 v0;
+    glm::vec3 edge1;
+    glm::vec3 edge2;
+    // Unit geometric normal (edge1 x edge2)
+    glm::vec3 normal;
+    // Caller supplied id, typically the index of the surface the triangle came from
+    int surface;
+};
+
+// Four rays in structure-of-arrays form. Lanes outside the active mask are ignored.
+struct RayPacket
+{
+    float ox[4] = {}, oy[4] = {}, oz[4] = {};
+    float dx[4] = {}, dy[4] = {}, dz[4] = {};
+    float tMax[4] = {};
+    int active = 0;
+
+    // Fills a lane and marks it active
+    void set(int lane, const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+};
+
+struct PacketHit
+{
+    // Hit distance and triangle per lane, triangle is -1 on a miss
+    float t[4];
+    int triangle[4];
+    float u[4];
+    float v[4];
+};
+
+class RayTracer
+{
+public:
+    std::vector<RayTriangle> triangles;
+
+    // Adds the non-degenerate triangles of an indexed mesh
+    void addMesh(const std::vector<glm::vec3>& positions, const unsigned int* indices, size_t indexCount, int surface);
+    // Builds the BVH, must be called after the last addMesh and before tracing
+    void build();
+
+    // Closest hit for every active lane
+    void intersect(const RayPacket& packet, PacketHit& hit) const;
+    // Returns the mask of active lanes that hit anything before their tMax
+    int occluded(const RayPacket& packet) const;
+
+private:
+    struct BVHNode
+    {
+        glm::vec3 boundsMin;
+        // Index of the left child (right is left + 1) or of the first triangle for leaves
+        int first;
+        glm::vec3 boundsMax;
+        // Number of triangles, 0 for inner nodes
+        int count;
+        int axis;
+    };
+
+    std::vector<BVHNode> nodes_;
+
+    void subdivide(int node, std::vector<glm::vec3>& centroids);
+    template <bool AnyHit>
+    int traverse(const RayPacket& packet, PacketHit* hit) const;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SHADOW_CLASS_H
+#define SHADOW_CLASS_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "node.h"
+#include "shaderClass.h"
+
+// Must match MAX_SHADOW_LIGHTS in default.frag
+#define MAX_SHADOW_LIGHTS 4
+
+// Omnidirectional shadow caster. The six cube faces are laid out as a 3x2 block of tiles in the atlas.
+struct ShadowLight
+{
+    glm::vec3 position;
+    float radius;
+
+    // Atlas block assigned this frame (in texels) and the face size it was sized for
+    glm::ivec2 offset = glm::ivec2(0);
+    int resolution = 0;
+    glm::mat4 faceMatrices[6];
+
+    // State of the cached static shadow map, re-rendered only when one of these changes
+    bool cacheValid = false;
+    glm::vec3 cachedPosition = glm::vec3(0.0f);
+    glm::ivec2 cachedOffset = glm::ivec2(-1);
+    int cachedResolution = 0;
+};
+
+class ShadowSystem
+{
+public:
+    // Size of the square atlas and the allowed range for the face resolution of a single light
+    int atlasSize;
+    int minResolution;
+    int maxResolution;
+    // The static cache is kept while the light moves less than this distance
+    float moveTolerance = 0.001f;
+
+    // Number of static cache refreshes done during the last render() call
+    int staticRefreshes = 0;
+
+    ShadowSystem(int atlasSize = 2048, int minResolution = 64, int maxResolution = 512);
+
+    int addLight(const glm::vec3& position, float radius);
+    void setLightPosition(int light, const glm::vec3& position);
+
+    // Assigns atlas space from the screen-space size of every light, refreshes the static caches
+    // that were invalidated and composites the dynamic casters on top of them
+    void render(Node& root, const Camera& camera);
+    // Binds the atlas to the given texture unit and uploads the light data used by the fragment shader
+    void apply(Shader& shader, GLuint unit);
+    void Delete();
+
+private:
+    std::vector<ShadowLight> lights_;
+
+    // The static atlas holds the cached maps, the shadow atlas is what the scene samples
+    GLuint staticTexture_;
+    GLuint staticFBO_;
+    GLuint shadowTexture_;
+    GLuint shadowFBO_;
+
+    Shader depthShader_;
+
+    void allocate(const Camera& camera);
+    void renderFaces(ShadowLight& light, Node& root, bool dynamicCasters);
+};
+
+#endif
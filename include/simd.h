@@ -0,0 +1,130 @@
+#ifndef SIMD_CLASS_H
+#define SIMD_CLASS_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Minimal 4-wide float vector for the CPU-side kernels. Maps to SSE on x86-64 and
+// falls back to plain loops elsewhere. Comparisons return lane masks (all bits set or clear)
+// that are consumed by select(), movemask() and the bitwise operators.
+#if defined(__SSE2__) || defined(_M_X64)
+#define SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+struct Float4
+{
+#ifdef SIMD_SSE
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 v) : v(v) {}
+    explicit Float4(float x) : v(_mm_set1_ps(x)) {}
+    Float4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+    static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+    // Converts 4 signed 16 bit integers
+    static Float4 loadInt16(const int16_t* p)
+    {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+    }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    float operator[](int i) const { alignas(16) float f[4]; _mm_store_ps(f, v); return f[i]; }
+#else
+    float v[4];
+
+    Float4() = default;
+    explicit Float4(float x) : v{x, x, x, x} {}
+    Float4(float x, float y, float z, float w) : v{x, y, z, w} {}
+
+    static Float4 load(const float* p) { return Float4(p[0], p[1], p[2], p[3]); }
+    static Float4 loadInt16(const int16_t* p) { return Float4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+    float operator[](int i) const { return v[i]; }
+#endif
+};
+
+#ifdef SIMD_SSE
+
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+inline Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.v, b.v); }
+inline Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+inline Float4 sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+// a & ~mask
+inline Float4 andnot(Float4 mask, Float4 a) { return _mm_andnot_ps(mask.v, a.v); }
+// Bit i is set when lane i of the mask is set
+inline int movemask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+
+#else
+
+namespace simd_detail
+{
+    template <typename F>
+    inline Float4 lanes(Float4 a, Float4 b, F f)
+    {
+        Float4 r;
+        for (int i = 0; i < 4; i++) r.v[i] = f(a.v[i], b.v[i]);
+        return r;
+    }
+
+    inline float maskLane(bool set)
+    {
+        uint32_t bits = set ? 0xFFFFFFFFu : 0u;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    inline uint32_t bitsOf(float f)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    inline float fromBits(uint32_t bits)
+    {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+}
+
+inline Float4 operator+(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return x + y; }); }
+inline Float4 operator-(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return x - y; }); }
+inline Float4 operator*(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return x * y; }); }
+inline Float4 operator/(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return x / y; }); }
+inline Float4 operator&(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::fromBits(simd_detail::bitsOf(x) & simd_detail::bitsOf(y)); }); }
+inline Float4 operator|(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::fromBits(simd_detail::bitsOf(x) | simd_detail::bitsOf(y)); }); }
+inline Float4 operator<(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::maskLane(x < y); }); }
+inline Float4 operator<=(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::maskLane(x <= y); }); }
+inline Float4 operator>(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::maskLane(x > y); }); }
+inline Float4 operator>=(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return simd_detail::maskLane(x >= y); }); }
+inline Float4 min(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return y < x ? y : x; }); }
+inline Float4 max(Float4 a, Float4 b) { return simd_detail::lanes(a, b, [](float x, float y) { return y > x ? y : x; }); }
+inline Float4 sqrt(Float4 a) { return Float4(std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3])); }
+inline Float4 andnot(Float4 mask, Float4 a) { return simd_detail::lanes(mask, a, [](float m, float x) { return simd_detail::fromBits(~simd_detail::bitsOf(m) & simd_detail::bitsOf(x)); }); }
+inline int movemask(Float4 mask)
+{
+    int bits = 0;
+    for (int i = 0; i < 4; i++) bits |= (int)(simd_detail::bitsOf(mask.v[i]) >> 31) << i;
+    return bits;
+}
+
+#endif
+
+// Picks a where the mask is set, b elsewhere
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return (mask & a) | andnot(mask, b); }
+
+#endif
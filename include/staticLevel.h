@@ -0,0 +1,96 @@
+#ifndef STATIC_LEVEL_CLASS_H
+#define STATIC_LEVEL_CLASS_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "vertex.h"
+
+// Géométrie et description du niveau, sans dépendance à OpenGL pour que les outils hors ligne
+// (baker) puissent l'utiliser sans fenêtre
+
+// Salle principale 
+extern Vertex MainFloorVerticies[4];
+extern unsigned int MainFloorIndicies[6];
+extern Vertex MainWallVertices[16];
+extern unsigned int MainWallIndices[24];
+extern Vertex MainCeilingVertices[4];
+extern unsigned int MainCeilingIndices[6];
+
+// Couloir
+extern Vertex corridorFloorVertices[4];
+extern unsigned int corridorFloorIndices[6];
+extern Vertex corridorWallVertices[16];
+extern unsigned int corridorWallIndices[24];
+extern Vertex corridorCeilingVertices[4];
+extern unsigned int corridorCeilingIndices[6];
+
+// Salle rectangulaire
+extern Vertex room2FloorVertices[4];
+extern unsigned int room2FloorIndices[6];
+extern Vertex room2WallVertices[16];
+extern unsigned int room2WallIndices[24];
+extern Vertex room2CeilingVertices[4];
+extern unsigned int room2CeilingIndices[6];
+
+// Bouchons salle principale (avant) - séparés en 3 parties
+extern Vertex roomFrontCapLeftVertices[4];
+extern unsigned int roomFrontCapLeftIndices[6];
+extern Vertex roomFrontCapDoorVertices[4];
+extern unsigned int roomFrontCapDoorIndices[6];
+extern Vertex roomFrontCapRightVertices[4];
+extern unsigned int roomFrontCapRightIndices[6];
+
+// Bouchons salle rectangulaire (arrière) - séparés en 3 parties
+extern Vertex room2BackCapLeftVertices[4];
+extern unsigned int room2BackCapLeftIndices[6];
+
+
+extern Vertex room2BackCapRightVertices[4];
+extern unsigned int room2BackCapRightIndices[6];
+
+// Description statique du niveau, partagée par le jeu et les outils de pré-calcul (baker)
+struct StaticSurface
+{
+    const char* name;
+    Vertex* vertices;
+    size_t vertexCount;
+    unsigned int* indices;
+    size_t indexCount;
+    // Albedo texture, the bakers use its average color for the light bounces
+    const char* albedo;
+};
+extern StaticSurface staticSurfaces[];
+extern const size_t staticSurfaceCount;
+
+// Lights that never move: baked into the lightmaps instead of being evaluated per pixel
+struct StaticLight
+{
+    glm::vec3 position;
+    glm::vec3 color;
+};
+extern StaticLight staticLights[];
+extern const size_t staticLightCount;
+
+// Volumes des pièces (même boîtes que isPositionValid), utilisés pour les sondes d'éclairage
+struct StaticRoom
+{
+    const char* name;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+extern StaticRoom staticRooms[];
+extern const size_t staticRoomCount;
+
+// Ouvertures entre deux pièces (indices dans staticRooms), découpées par les bouchons
+struct StaticPortal
+{
+    const char* name;
+    int roomA;
+    int roomB;
+    glm::vec3 corners[4];
+};
+extern StaticPortal staticPortals[];
+extern const size_t staticPortalCount;
+
+#endif
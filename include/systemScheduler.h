@@ -0,0 +1,42 @@
+#ifndef SYSTEM_SCHEDULER_CLASS_H
+#define SYSTEM_SCHEDULER_CLASS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "world.h"
+
+// Runs the systems updating a World every frame. Each system declares the components it reads
+// and writes; systems are grouped into stages where no two of them write a component the other
+// touches, and the systems of a stage run in parallel as jobs of the shared JobSystem.
+// Conflicting systems keep the order they were added in. Systems touching anything outside the
+// World that isn't thread safe (the scene nodes) are flagged mainThread and run on the calling
+// thread. GL calls go through JobSystem::runOnGLThread instead, the context lives elsewhere.
+class SystemScheduler
+{
+public:
+    struct System
+    {
+        std::string name;
+        ComponentMask reads;
+        ComponentMask writes;
+        bool mainThread = false;
+        std::function<void(World&, float)> run;
+    };
+
+    void add(const System& system);
+    void run(World& world, float dt);
+    // Stages of the last run(), for tuning
+    int stageCount() const { return (int)stages_.size(); }
+
+private:
+    void buildStages();
+
+    std::vector<System> systems_;
+    // Indices into systems_
+    std::vector<std::vector<int>> stages_;
+    bool stagesDirty_ = false;
+};
+
+#endif
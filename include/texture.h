@@ -5,6 +5,7 @@
 #include "stb_image.h"
 
 #include"shaderClass.h"
+#include"materialCooker.h"
 
 class Texture
 {
@@ -13,8 +14,14 @@ public:
 	const char* type;
 	GLuint unit;
 
+	// format is the layout wanted on the GPU (GL_RED, GL_RG, GL_RGB or GL_RGBA), the image is converted
+	// to it and stored with a matching sized internal format
 	Texture(const char* image, const char* texType, GLenum slot, GLenum format, GLenum pixelType);
 	Texture(const unsigned char* buffer, int len, const char* texType, GLuint slot);
+	// Linear RGB float data (baked lighting), stored as half floats and filtered bilinearly
+	Texture(const float* texels, int width, int height, const char* texType, GLuint slot);
+	// Cooked image (see MaterialCooker), uploaded with its own mip chain
+	Texture(const CookedImage& image, const char* texType, GLuint slot);
 	Texture()
 	{
 		ID = 0;
@@ -0,0 +1,90 @@
+#ifndef TRANSFORM_SYSTEM_CLASS_H
+#define TRANSFORM_SYSTEM_CLASS_H
+
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Local transforms (translation, rotation, scale) and world matrices of a hierarchy, stored as
+// arrays in depth first order: parents come before their children and every subtree is a
+// contiguous range. Changing a transform records the range of its subtree, and update()
+// recomputes only those ranges in one linear pass, reading the parent's world matrix from the
+// same arrays; past parallelThreshold transforms the subtrees are spread over the JobSystem.
+// Transforms are addressed by ids that stay valid when the arrays are reordered.
+// Ids of destroyed transforms are reused, and up to the reserved capacity creating, parenting
+// and destroying transforms doesn't allocate.
+class TransformSystem
+{
+public:
+    // Transforms recomputed by the last update(), for tuning
+    int updated = 0;
+    size_t parallelThreshold = 4096;
+
+    explicit TransformSystem(int capacity = 0);
+
+    // A new root transform, returns its id
+    int create(const glm::mat4& local = glm::mat4(1.0f));
+    // The transform must have no children left, its id is handed out again by create()
+    void destroy(int id);
+    // Moves the transform and its subtree under parent, -1 to make it a root
+    void setParent(int id, int parent);
+    int parent(int id) const { return parents_[id]; }
+
+    void setLocal(int id, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+    // The matrix is split into translation, rotation and scale, it must not be sheared
+    void setLocal(int id, const glm::mat4& local);
+    glm::mat4 local(int id) const;
+
+    // Recomputes the world matrices of the subtrees changed since the last call
+    void update();
+    // As of the last update()
+    const glm::mat4& world(int id) const { return world_[slots_[id]]; }
+    // Live transforms
+    int count() const { return (int)(slots_.size() - freeIds_.size()); }
+
+private:
+    // Rebuilds the depth first order after parents changed, every world matrix is recomputed
+    void reorder();
+    // Splits a run of whole subtrees into pieces_ of about grain transforms, computing the roots of
+    // the larger subtrees on the way
+    void split(int first, int last, int grain);
+    // World matrices of the slots, their parents being done
+    void compute(int first, int last);
+
+    // Cold data by id: the hierarchy and where each transform is stored, slot -1 for destroyed
+    // ids. Children are linked lists so reparenting doesn't allocate.
+    std::vector<int> slots_;
+    std::vector<int> parents_;
+    std::vector<int> firstChildren_;
+    std::vector<int> lastChildren_;
+    std::vector<int> nextSiblings_;
+    std::vector<int> previousSiblings_;
+    std::vector<int> freeIds_;
+
+    // Hot data by slot, in depth first order. Destroyed transforms keep their slot until the
+    // next reorder(), their id is -1 meanwhile.
+    std::vector<int> ids_;
+    std::vector<int> parentSlots_;
+    std::vector<int> subtreeSizes_;
+    std::vector<glm::vec3> translations_;
+    std::vector<glm::quat> rotations_;
+    std::vector<glm::vec3> scales_;
+    std::vector<glm::mat4> world_;
+
+    // Scratch of reorder(), kept to reuse its memory
+    std::vector<int> order_;
+    std::vector<int> stack_;
+    std::vector<glm::vec3> scratchTranslations_;
+    std::vector<glm::quat> scratchRotations_;
+    std::vector<glm::vec3> scratchScales_;
+
+    // Slot ranges [first, last) waiting for update(), the same without the nested ones, and the
+    // jobs' share of them
+    std::vector<std::pair<int, int>> dirty_;
+    std::vector<std::pair<int, int>> merged_;
+    std::vector<std::pair<int, int>> pieces_;
+    bool orderDirty_ = false;
+};
+
+#endif
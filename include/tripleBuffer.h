@@ -0,0 +1,70 @@
+#ifndef TRIPLE_BUFFER_CLASS_H
+#define TRIPLE_BUFFER_CLASS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one producer thread to one consumer thread without locks. The producer
+// fills back() and publishes it, the consumer acquires the latest published value, and neither
+// ever waits for the other to finish with its buffer: the third one sits in between and the two
+// sides swap with it atomically. Values are reused, so vectors inside keep their memory.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side
+    T& back() { return buffers_[back_]; }
+    // Makes back() the latest value, replacing a published one the consumer hasn't taken
+    void publish()
+    {
+        uint32_t old = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = old & INDEX;
+        middle_.notify_all();
+    }
+    // Blocks until the consumer has taken the last published value
+    void waitConsumed() const
+    {
+        uint32_t state = middle_.load(std::memory_order_acquire);
+        while (state & FRESH)
+        {
+            middle_.wait(state, std::memory_order_acquire);
+            state = middle_.load(std::memory_order_acquire);
+        }
+    }
+
+    // Consumer side
+    // Takes the latest published value if there is a new one, and returns the value held
+    const T& acquire()
+    {
+        if (middle_.load(std::memory_order_relaxed) & FRESH)
+        {
+            uint32_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+            front_ = old & INDEX;
+            middle_.notify_all();
+        }
+        return buffers_[front_];
+    }
+    // Blocks until a value was published since the last acquire()
+    void waitPublished() const
+    {
+        uint32_t state = middle_.load(std::memory_order_acquire);
+        while (!(state & FRESH))
+        {
+            middle_.wait(state, std::memory_order_acquire);
+            state = middle_.load(std::memory_order_acquire);
+        }
+    }
+
+private:
+    static const uint32_t INDEX = 3;
+    static const uint32_t FRESH = 4;
+
+    T buffers_[3];
+    // Owned by the producer and the consumer
+    uint32_t back_ = 0;
+    uint32_t front_ = 1;
+    // Index of the buffer in between, flagged FRESH while the consumer hasn't taken it
+    std::atomic<uint32_t> middle_{2};
+};
+
+#endif
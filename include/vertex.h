@@ -0,0 +1,17 @@
+#ifndef VERTEX_CLASS_H
+#define VERTEX_CLASS_H
+
+#include <glm/glm.hpp>
+
+// Structure to standardize the vertices used in the meshes
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 color;
+	glm::vec2 texUV;
+	// Position in the baked lightmap atlas, negative when the vertex isn't lightmapped
+	glm::vec2 lightUV = glm::vec2(-1.0f);
+};
+
+#endif
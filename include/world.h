@@ -0,0 +1,230 @@
+#ifndef WORLD_CLASS_H
+#define WORLD_CLASS_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// 32 bit reference to an entity of a World, laid out like Handle: the index in the low bits and
+// a generation that changes when the entity is destroyed. The zero entity is null.
+struct Entity
+{
+    static const int INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    uint32_t value = 0;
+
+    Entity() = default;
+    Entity(uint32_t index, uint32_t generation) : value(generation << INDEX_BITS | index) {}
+
+    uint32_t index() const { return value & INDEX_MASK; }
+    uint32_t generation() const { return value >> INDEX_BITS; }
+    explicit operator bool() const { return value != 0; }
+    bool operator==(const Entity& other) const { return value == other.value; }
+    bool operator!=(const Entity& other) const { return value != other.value; }
+};
+
+using ComponentMask = std::bitset<64>;
+
+// Entity-component storage grouped by archetype: the entities with exactly the same set of
+// components share an archetype, which stores them in fixed size chunks with one array per
+// component (and one of entities). Queries cache the archetypes they match, so iterating them
+// walks arrays of the requested components only, chunk after chunk. Components are plain data,
+// copied bytewise when an entity changes archetype.
+//
+// Creating, destroying, adding and removing components (structural changes) must not happen
+// while a query is being iterated. Iterating queries and reading or writing components from
+// several threads is fine as long as no two threads write the same component type, which is
+// what SystemScheduler guarantees.
+class World
+{
+public:
+    static const int MAX_COMPONENTS = 64;
+    static const int CHUNK_BYTES = 16384;
+
+    World();
+
+    // Registers T on first use. Components are registered from one thread at a time.
+    template <typename T>
+    static int componentId()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "components are plain data");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned component");
+        static const int id = registerComponent(sizeof(T), alignof(T));
+        return id;
+    }
+    template <typename... T>
+    static ComponentMask mask()
+    {
+        ComponentMask result;
+        (result.set(componentId<T>()), ...);
+        return result;
+    }
+
+    // Goes straight to the archetype of the given components
+    template <typename... T>
+    Entity create(const T&... components)
+    {
+        Entity entity = allocateEntity(findArchetype(mask<T...>()));
+        (write(entity, components), ...);
+        return entity;
+    }
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    int entityCount() const { return liveEntities_; }
+
+    // Adding a component the entity has overwrites it
+    template <typename T>
+    void add(Entity entity, const T& component = T())
+    {
+        if (!alive(entity))
+        {
+            return;
+        }
+        if (!get<T>(entity))
+        {
+            int archetype = records_[entity.index()].archetype;
+            move(entity, edge(archetype, componentId<T>(), true));
+        }
+        write(entity, component);
+    }
+    template <typename T>
+    void remove(Entity entity)
+    {
+        if (get<T>(entity))
+        {
+            move(entity, edge(records_[entity.index()].archetype, componentId<T>(), false));
+        }
+    }
+    // nullptr when the entity is destroyed or doesn't have the component. Stays valid until the
+    // next structural change.
+    template <typename T>
+    T* get(Entity entity)
+    {
+        if (!alive(entity))
+        {
+            return nullptr;
+        }
+        const Record& record = records_[entity.index()];
+        const Archetype& archetype = archetypes_[record.archetype];
+        int offset = archetype.offsets[componentId<T>()];
+        if (offset < 0)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(archetype.chunks[record.chunk].data.get() + offset) + record.row;
+    }
+
+    // Entities having every component of all and none of none, returns the query's id. The
+    // matching archetypes are kept up to date as new ones appear.
+    int query(const ComponentMask& all, const ComponentMask& none = ComponentMask());
+    int count(int query) const;
+
+    // Calls f(Entity, T&...) for every entity of the query, which must require every T
+    template <typename... T, typename F>
+    void each(int query, F f)
+    {
+        if ((queries_[query].all & mask<T...>()) != mask<T...>())
+        {
+            std::cerr << "Error: iterating components a query doesn't require" << std::endl;
+            return;
+        }
+        for (int index : queries_[query].archetypes)
+        {
+            Archetype& archetype = archetypes_[index];
+            for (Chunk& chunk : archetype.chunks)
+            {
+                const Entity* entities = reinterpret_cast<const Entity*>(chunk.data.get());
+                std::tuple<T*...> columns(reinterpret_cast<T*>(chunk.data.get() + archetype.offsets[componentId<T>()])...);
+                for (int row = 0; row < chunk.count; row++)
+                {
+                    f(entities[row], std::get<T*>(columns)[row]...);
+                }
+            }
+        }
+    }
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<unsigned char[]> data;
+        int count = 0;
+    };
+
+    struct Archetype
+    {
+        ComponentMask mask;
+        std::vector<int> components;
+        // Byte offset of each component's array in a chunk, -1 when the archetype lacks it. The
+        // entity array comes first.
+        int offsets[MAX_COMPONENTS];
+        // Archetype reached by adding or removing each component, -1 until first needed
+        int addEdges[MAX_COMPONENTS];
+        int removeEdges[MAX_COMPONENTS];
+        int rowCapacity = 0;
+        // Filled front to back, only the last one has free rows
+        std::vector<Chunk> chunks;
+    };
+
+    struct Record
+    {
+        int archetype = -1;
+        int chunk = 0;
+        int row = 0;
+        // Odd while the entity is alive
+        uint32_t generation = 0;
+    };
+
+    struct Query
+    {
+        ComponentMask all;
+        ComponentMask none;
+        std::vector<int> archetypes;
+    };
+
+    struct ComponentInfo
+    {
+        size_t size;
+        size_t alignment;
+    };
+
+    static int registerComponent(size_t size, size_t alignment);
+    static std::vector<ComponentInfo>& components();
+
+    int findArchetype(const ComponentMask& mask);
+    int edge(int archetype, int component, bool add);
+    Entity allocateEntity(int archetype);
+    // Appends a row for the entity and points its record at it
+    void allocateRow(Entity entity, int archetype);
+    // Fills the row with the archetype's last one
+    void removeRow(int archetype, int chunk, int row);
+    void move(Entity entity, int archetype);
+
+    template <typename T>
+    void write(Entity entity, const T& component)
+    {
+        if (T* target = get<T>(entity))
+        {
+            new (target) T(component);
+        }
+    }
+
+    std::vector<Archetype> archetypes_;
+    std::unordered_map<unsigned long long, int> archetypeIndex_;
+    std::vector<Query> queries_;
+    std::vector<Record> records_;
+    std::vector<uint32_t> freeEntities_;
+    // Emptied chunks, reused before allocating
+    std::vector<std::unique_ptr<unsigned char[]>> spareChunks_;
+    int liveEntities_ = 0;
+};
+
+#endif
@@ -11,12 +11,24 @@ in vec3 Normal;
 in vec3 color;
 // Imports the texture coordinates from the Vertex Shader
 in vec2 texCoord;
+// Imports the lightmap coordinates from the Vertex Shader
+in vec2 lightUV;
+// Imports the probe irradiance from the Vertex Shader
+in vec3 probeLight;
 
 
 
 // Gets the Texture Unit from the main function
 uniform sampler2D diffuse0;
 uniform sampler2D specular0;
+// Packed material (see MaterialCooker): rg = normal xy, b = roughness, a = height, occlusion in diffuse0.a
+uniform sampler2D surface0;
+// 1 when the mesh uses a packed material instead of a specular map
+uniform int surfaceMapped;
+// Baked irradiance of the static lights (direct and bounced), see Baker
+uniform sampler2D lightmap;
+// Number of probe rooms, 0 when no probes were baked
+uniform int probeRoomCount;
 // Gets the color of the light from the main function
 uniform vec4 lightColor;
 // Gets the position of the light from the main function
@@ -24,6 +36,140 @@ uniform vec3 lightPos;
 // Gets the position of the camera from the main function
 uniform vec3 camPos;
 
+// Integrated froxel grid of the FogVolume: rgb = light scattered in front of the point, a = transmittance
+uniform sampler3D fogVolume;
+uniform int fogEnabled;
+uniform vec2 fogDepthRange;
+uniform vec2 fogScreenSize;
+uniform mat4 fogView;
+
+// Clustered decals of the DecalSystem: 5 texels per decal in decalData (world to box rows, atlas
+// rect, tint), rg = offset and count of each cluster's list in decalIndices
+#define MAX_DECALS_PER_CLUSTER 32
+uniform sampler2D decalAtlas;
+uniform samplerBuffer decalData;
+uniform usamplerBuffer decalClusters;
+uniform usamplerBuffer decalIndices;
+uniform int decalsEnabled;
+uniform ivec3 decalGrid;
+uniform vec2 decalDepthRange;
+uniform vec2 decalScreenSize;
+uniform mat4 decalView;
+
+// Shadow atlas filled by the ShadowSystem, each light owns a 3x2 block of cube faces
+#define MAX_SHADOW_LIGHTS 4
+uniform sampler2D shadowAtlas;
+uniform float shadowTexelSize;
+uniform int shadowLightCount;
+uniform mat4 shadowMatrices[MAX_SHADOW_LIGHTS * 6];
+// xy = block origin, z = face size (atlas UV units), w = light range
+uniform vec4 shadowRegions[MAX_SHADOW_LIGHTS];
+uniform vec3 shadowLightPos[MAX_SHADOW_LIGHTS];
+
+// Applies a tangent space normal, the vertices carry no tangents so the frame comes from the
+// screen space derivatives of the position and texture coordinates
+vec3 surfaceNormal(vec3 normal, vec2 xy){
+	vec3 dp1 = dFdx(crntPos);
+	vec3 dp2 = dFdy(crntPos);
+	vec2 duv1 = dFdx(texCoord);
+	vec2 duv2 = dFdy(texCoord);
+
+	vec3 dp2perp = cross(dp2, normal);
+	vec3 dp1perp = cross(normal, dp1);
+	vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
+	vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
+	float scale = max(dot(T, T), dot(B, B));
+	if (scale <= 0.0) return normal;
+
+	vec3 n = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+	return normalize(mat3(T * inversesqrt(scale), B * inversesqrt(scale), normal) * n);
+}
+
+// Returns 1.0 when lit, 0.0 when fully shadowed
+float shadowFactor(int light){
+	if (light >= shadowLightCount) return 1.0;
+
+	vec3 toFrag = crntPos - shadowLightPos[light];
+	vec3 a = abs(toFrag);
+	int face;
+	if (a.x >= a.y && a.x >= a.z) face = toFrag.x > 0.0 ? 0 : 1;
+	else if (a.y >= a.z) face = toFrag.y > 0.0 ? 2 : 3;
+	else face = toFrag.z > 0.0 ? 4 : 5;
+
+	vec4 clip = shadowMatrices[light * 6 + face] * vec4(crntPos, 1.0);
+	vec2 uv = clip.xy / clip.w * 0.5 + 0.5;
+
+	vec4 region = shadowRegions[light];
+	float dist = length(toFrag) / region.w;
+	if (dist >= 1.0) return 1.0;
+
+	// Stay one texel inside the face so the filter never reads a neighbouring tile
+	vec2 faceMin = region.xy + vec2(face % 3, face / 3) * region.z;
+	vec2 lo = faceMin + shadowTexelSize;
+	vec2 hi = faceMin + region.z - shadowTexelSize;
+	vec2 center = faceMin + uv * region.z;
+
+	float bias = 0.005;
+	float lit = 0.0;
+	for (int x = -1; x <= 0; x++)
+		for (int y = -1; y <= 0; y++)
+		{
+			vec2 coord = clamp(center + (vec2(x, y) + 0.5) * shadowTexelSize, lo, hi);
+			lit += dist - bias > texture(shadowAtlas, coord).r ? 0.0 : 1.0;
+		}
+	return lit * 0.25;
+}
+
+vec3 applyFog(vec3 color){
+	if (fogEnabled == 0) return color;
+
+	// Slices are exponential in view distance, each layer holds the total up to its far side
+	float dist = max(-(fogView * vec4(crntPos, 1.0)).z, fogDepthRange.x);
+	float t = log(dist / fogDepthRange.x) / log(fogDepthRange.y / fogDepthRange.x);
+	vec3 uvw = vec3(gl_FragCoord.xy / fogScreenSize, t - 0.5 / float(textureSize(fogVolume, 0).z));
+	vec4 fog = texture(fogVolume, uvw);
+	return color * fog.a + fog.rgb;
+}
+
+// Blends the decals of the fragment's cluster into the albedo of the static room surfaces
+vec3 applyDecals(vec3 albedo){
+	if (decalsEnabled == 0 || lightUV.x < 0.0) return albedo;
+
+	// Same layout as the fog: screen tiles times exponential slices of the view distance
+	float dist = -(decalView * vec4(crntPos, 1.0)).z;
+	if (dist >= decalDepthRange.y) return albedo;
+	float t = log(max(dist, decalDepthRange.x) / decalDepthRange.x) / log(decalDepthRange.y / decalDepthRange.x);
+	ivec3 cluster = ivec3(vec3(gl_FragCoord.xy / decalScreenSize, t) * vec3(decalGrid));
+	cluster = clamp(cluster, ivec3(0), decalGrid - 1);
+	uvec2 range = texelFetch(decalClusters, (cluster.z * decalGrid.y + cluster.y) * decalGrid.x + cluster.x).rg;
+
+	// Derivatives are taken once outside the divergent loop, which samples with explicit gradients
+	vec3 dpdx = dFdx(crntPos);
+	vec3 dpdy = dFdy(crntPos);
+	vec3 normal = normalize(Normal);
+	vec4 p = vec4(crntPos, 1.0);
+	uint count = min(range.y, uint(MAX_DECALS_PER_CLUSTER));
+	for (uint i = 0u; i < count; i++)
+	{
+		int base = int(texelFetch(decalIndices, int(range.x + i)).r) * 5;
+		vec4 row0 = texelFetch(decalData, base);
+		vec4 row1 = texelFetch(decalData, base + 1);
+		vec4 row2 = texelFetch(decalData, base + 2);
+		vec3 box = vec3(dot(row0, p), dot(row1, p), dot(row2, p));
+		if (any(greaterThan(abs(box), vec3(0.5)))) continue;
+
+		// Fade on surfaces turned away from the projection and towards the ends of the box
+		float fade = smoothstep(0.2, 0.5, dot(normal, normalize(row2.xyz))) * (1.0 - smoothstep(0.35, 0.5, abs(box.z)));
+		vec4 rect = texelFetch(decalData, base + 3);
+		vec2 uv = rect.xy + (box.xy + 0.5) * rect.zw;
+		vec2 gradX = vec2(dot(row0.xyz, dpdx), dot(row1.xyz, dpdx)) * rect.zw;
+		vec2 gradY = vec2(dot(row0.xyz, dpdy), dot(row1.xyz, dpdy)) * rect.zw;
+		vec4 decal = textureGrad(decalAtlas, uv, gradX, gradY) * texelFetch(decalData, base + 4);
+		albedo = mix(albedo, decal.rgb, decal.a * fade);
+	}
+	return albedo;
+}
+
 vec4 pointLight(){
 
 	// vec3 lightVec = lightPos - crntPos;
@@ -59,26 +205,48 @@ vec4 pointLight(){
     float quadratic = 0.032;
     float attenuation = 1.0 / (constant + linear * dist + quadratic * (dist * dist));
 
+    // Material: packed albedo/occlusion + normal/roughness/height, or the albedo and specular maps
+    vec4 albedoTex = texture(diffuse0, texCoord);
+    vec3 albedo = applyDecals(albedoTex.rgb);
+    vec3 normal = normalize(Normal);
+    float occlusion = 1.0;
+    float specMap = texture(specular0, texCoord).r;
+    float shininess = 16.0;
+    if (surfaceMapped != 0)
+    {
+        vec4 surface = texture(surface0, texCoord);
+        occlusion = albedoTex.a;
+        normal = surfaceNormal(normal, surface.xy * 2.0 - 1.0);
+        specMap = 1.0 - surface.z;
+        shininess = exp2(mix(7.0, 1.0, surface.z));
+    }
+
     // ambient lighting
     float ambientStrength = 0.20f;
-    vec3 ambient = ambientStrength * lightColor.rgb * texture(diffuse0, texCoord).rgb;
+    vec3 ambient = ambientStrength * lightColor.rgb * albedo;
+    // Lightmapped surfaces get the baked static lighting instead of the constant ambient,
+    if (lightUV.x >= 0.0)
+        ambient = texture(lightmap, lightUV).rgb * albedo;
+    // and dynamic objects the light of the baked probes around them
+    else if (probeRoomCount > 0)
+        ambient = probeLight * albedo;
+    ambient *= occlusion;
 
     // diffuse lighting
-    vec3 normal = normalize(Normal);
     vec3 lightDirection = normalize(lightVec);
     float diff = max(dot(normal, lightDirection), 0.0);
-    vec3 diffuse = diff * lightColor.rgb * texture(diffuse0, texCoord).rgb;
+    vec3 diffuse = diff * lightColor.rgb * albedo;
 
     // specular lighting
     float specularStrength = 0.50f;
     vec3 viewDirection = normalize(camPos - crntPos);
     vec3 reflectionDirection = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDirection, reflectionDirection), 0.0), 16);
-    float specMap = texture(specular0, texCoord).r;
+    float spec = pow(max(dot(viewDirection, reflectionDirection), 0.0), shininess);
     vec3 specular = specularStrength * spec * specMap * lightColor.rgb;
 
     // Combine results with attenuation
-    vec3 result = (ambient + attenuation * (diffuse + specular));
+    float shadow = shadowFactor(0);
+    vec3 result = (ambient + attenuation * shadow * (diffuse + specular));
     return vec4(result, 1.0);
 }
 
@@ -135,4 +303,5 @@ void main()
 {	
 	// outputs final color
 	FragColor = pointLight(); // Change to direcLight() or spotLight() to use different lighting models
+	FragColor.rgb = applyFog(FragColor.rgb);
 }
\ No newline at end of file
@@ -8,6 +8,15 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aColor;
 // Texture Coordinates
 layout (location = 3) in vec2 aTex;
+// Lightmap coordinates, negative when the mesh isn't lightmapped
+layout (location = 4) in vec2 aLightUV;
+// Skin of skinned meshes and crowd characters: 4 bones and their weights
+layout (location = 5) in uvec4 aJoints;
+layout (location = 6) in vec4 aWeights;
+// Per crowd instance: model matrix, and first frame, frame count (negative when the clip doesn't
+// loop), start time and rate of its clip
+layout (location = 7) in mat4 aInstanceModel;
+layout (location = 11) in vec4 aInstanceClip;
 
 
 // Outputs the current position for the Fragment Shader
@@ -18,6 +27,8 @@ out vec3 Normal;
 out vec3 color;
 // Outputs the texture coordinates to the Fragment Shader
 out vec2 texCoord;
+// Outputs the lightmap coordinates to the Fragment Shader
+out vec2 lightUV;
 
 
 // Imports the camera matrix from the main function
@@ -25,21 +36,127 @@ uniform mat4 camMatrix;
 // Imports the model matrix from the main function
 uniform mat4 model;
 
+// Skinning matrix of every bone of the skinned mesh being drawn (see Mesh::setPose)
+#define MAX_BONES 128
+layout (std140) uniform Joints
+{
+	mat4 jointMatrices[MAX_BONES];
+};
+// 1 while a skinned mesh draws
+uniform int skinEnabled;
+
+// Bone matrices of the baked clips, one row per frame and three texels (matrix rows) per joint
+uniform sampler2D boneFrames;
+uniform float boneFrameRate;
+uniform float crowdTime;
+// 1 while a Crowd draws, the instance attributes replace the model matrix
+uniform int crowdEnabled;
+
+// Baked irradiance probes (see ProbeVolume): L1 coefficients for red, green and blue stacked along z
+#define MAX_PROBE_ROOMS 8
+uniform sampler3D probeVolume;
+uniform int probeRoomCount;
+uniform vec3 probeAtlasSize;
+uniform vec3 probeRoomMin[MAX_PROBE_ROOMS];
+uniform vec3 probeRoomMax[MAX_PROBE_ROOMS];
+uniform vec3 probeRoomSize[MAX_PROBE_ROOMS];
+uniform vec3 probeRoomOffset[MAX_PROBE_ROOMS];
+
+// Outputs the probe irradiance for the Fragment Shader
+out vec3 probeLight;
+
+vec3 sampleProbes(vec3 pos, vec3 normal){
+	// Grid of the room containing the vertex, or the closest one
+	int room = 0;
+	float best = 1e30;
+	for (int i = 0; i < probeRoomCount; i++)
+	{
+		vec3 outside = max(max(probeRoomMin[i] - pos, pos - probeRoomMax[i]), 0.0);
+		float dist = dot(outside, outside);
+		if (dist < best)
+		{
+			best = dist;
+			room = i;
+		}
+	}
+
+	// Probe centers are texel centers, clamping keeps the filter inside the room's grid
+	vec3 extent = max(probeRoomMax[room] - probeRoomMin[room], vec3(1e-4));
+	vec3 t = clamp((pos - probeRoomMin[room]) / extent, 0.0, 1.0) * (probeRoomSize[room] - 1.0) + 0.5;
+	vec3 uvw = (probeRoomOffset[room] + t) / vec3(probeAtlasSize.xy, probeAtlasSize.z * 3.0);
+
+	vec4 n = vec4(1.0, normal);
+	vec4 r = texture(probeVolume, uvw);
+	vec4 g = texture(probeVolume, uvw + vec3(0.0, 0.0, 1.0 / 3.0));
+	vec4 b = texture(probeVolume, uvw + vec3(0.0, 0.0, 2.0 / 3.0));
+	return max(vec3(dot(r, n), dot(g, n), dot(b, n)), 0.0);
+}
+
+// Skinning matrix of the vertex at the instance's point in its clip, blended between two frames
+mat4 crowdSkin(){
+	float count = abs(aInstanceClip.y);
+	float frame = (crowdTime - aInstanceClip.z) * aInstanceClip.w * boneFrameRate;
+	frame = aInstanceClip.y > 0.0 ? mod(frame, count) : clamp(frame, 0.0, count - 1.0);
+	int first = int(aInstanceClip.x);
+	int frameA = int(frame);
+	int frameB = aInstanceClip.y > 0.0 ? (frameA + 1) % int(count) : min(frameA + 1, int(count) - 1);
+	float blend = fract(frame);
+
+	vec4 rows[3] = vec4[3](vec4(0.0), vec4(0.0), vec4(0.0));
+	for (int k = 0; k < 4; k++)
+	{
+		if (aWeights[k] <= 0.0) continue;
+		int x = int(aJoints[k]) * 3;
+		for (int r = 0; r < 3; r++)
+		{
+			vec4 a = texelFetch(boneFrames, ivec2(x + r, first + frameA), 0);
+			vec4 b = texelFetch(boneFrames, ivec2(x + r, first + frameB), 0);
+			rows[r] += mix(a, b, blend) * aWeights[k];
+		}
+	}
+	return transpose(mat4(rows[0], rows[1], rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
 
 void main()
 {
+	// Crowd instances are skinned from the baked frames and placed by their own matrix
+	mat4 world = model;
+	vec3 position = aPos;
+	vec3 normal = aNormal;
+	if (crowdEnabled != 0)
+	{
+		mat4 skin = crowdSkin();
+		position = vec3(skin * vec4(aPos, 1.0));
+		normal = mat3(skin) * aNormal;
+		world = aInstanceModel;
+	}
+	else if (skinEnabled != 0)
+	{
+		mat4 skin = jointMatrices[aJoints.x] * aWeights.x + jointMatrices[aJoints.y] * aWeights.y +
+			jointMatrices[aJoints.z] * aWeights.z + jointMatrices[aJoints.w] * aWeights.w;
+		position = vec3(skin * vec4(aPos, 1.0));
+		normal = mat3(skin) * aNormal;
+	}
+
 	// calculates current position
-	crntPos = vec3(model * vec4(aPos, 1.0));
+	crntPos = vec3(world * vec4(position, 1.0));
 
 	// Assigns the normal from the Vertex Data to "Normal"
-	mat3 normalMatrix = mat3(transpose(inverse(model)));
-	Normal = normalize(normalMatrix * aNormal);
+	mat3 normalMatrix = mat3(transpose(inverse(world)));
+	Normal = normalize(normalMatrix * normal);
+
+	// Dynamic (non lightmapped) geometry gets its indirect light from the probes
+	probeLight = vec3(0.0);
+	if (aLightUV.x < 0.0 && probeRoomCount > 0)
+		probeLight = sampleProbes(crntPos, Normal);
 
 	// Assigns the colors from the Vertex Data to "color"
 	color = aColor;
 
 	// Assigns the texture coordinates from the Vertex Data to "texCoord"
 	texCoord = aTex;
+	lightUV = aLightUV;
 	
 	// Outputs the positions/coordinates of all vertices
 	gl_Position = camMatrix * vec4(crntPos, 1.0);
@@ -0,0 +1,110 @@
+#version 330 core
+
+// Lights one depth slice of the froxel grid: rgb = light scattered towards the camera, a = extinction
+out vec4 FragColor;
+
+// Froxel grid size and the slice being rendered
+uniform vec3 volumeSize;
+uniform int slice;
+// Position inside the froxel this frame, in [0, 1)
+uniform vec3 jitter;
+// Slices are spread exponentially between these view distances
+uniform vec2 depthRange;
+
+uniform mat4 inverseView;
+// tan(fov / 2) * aspect, tan(fov / 2)
+uniform vec2 projScale;
+uniform vec3 camPos;
+
+// Fog medium: a box with a soft edge
+uniform vec3 fogBoxMin;
+uniform vec3 fogBoxMax;
+uniform float fogDensity;
+uniform float fogEdge;
+uniform vec3 fogAlbedo;
+uniform vec3 fogAmbient;
+uniform float fogAnisotropy;
+
+uniform vec3 lightPos;
+uniform vec4 lightColor;
+
+// Last frame's injected grid, reprojected to accumulate the jittered samples
+uniform sampler3D history;
+uniform int hasHistory;
+uniform float historyWeight;
+uniform mat4 prevViewProjection;
+
+// Shadow atlas filled by the ShadowSystem, same layout as in default.frag
+#define MAX_SHADOW_LIGHTS 4
+uniform sampler2D shadowAtlas;
+uniform int shadowLightCount;
+uniform mat4 shadowMatrices[MAX_SHADOW_LIGHTS * 6];
+uniform vec4 shadowRegions[MAX_SHADOW_LIGHTS];
+uniform vec3 shadowLightPos[MAX_SHADOW_LIGHTS];
+
+const float PI = 3.14159265;
+
+// Single tap is enough, the temporal accumulation already blurs the shadow edges
+float shadowFactor(int light, vec3 pos){
+	if (light >= shadowLightCount) return 1.0;
+
+	vec3 toPos = pos - shadowLightPos[light];
+	vec3 a = abs(toPos);
+	int face;
+	if (a.x >= a.y && a.x >= a.z) face = toPos.x > 0.0 ? 0 : 1;
+	else if (a.y >= a.z) face = toPos.y > 0.0 ? 2 : 3;
+	else face = toPos.z > 0.0 ? 4 : 5;
+
+	vec4 clip = shadowMatrices[light * 6 + face] * vec4(pos, 1.0);
+	vec2 uv = clamp(clip.xy / clip.w * 0.5 + 0.5, 0.0, 1.0);
+
+	vec4 region = shadowRegions[light];
+	float dist = length(toPos) / region.w;
+	if (dist >= 1.0) return 1.0;
+
+	vec2 coord = region.xy + (vec2(face % 3, face / 3) + uv) * region.z;
+	return dist - 0.005 > texture(shadowAtlas, coord).r ? 0.0 : 1.0;
+}
+
+// Henyey-Greenstein phase function
+float phase(float cosTheta, float g){
+	float denom = 1.0 + g * g - 2.0 * g * cosTheta;
+	return (1.0 - g * g) / (4.0 * PI * denom * sqrt(denom));
+}
+
+float sliceDistance(float t){
+	return depthRange.x * pow(depthRange.y / depthRange.x, t);
+}
+
+void main()
+{
+	vec3 coord = (vec3(floor(gl_FragCoord.xy), float(slice)) + jitter) / volumeSize;
+	float dist = sliceDistance(coord.z);
+	vec3 viewPos = vec3((coord.xy * 2.0 - 1.0) * projScale * dist, -dist);
+	vec3 pos = vec3(inverseView * vec4(viewPos, 1.0));
+
+	vec3 outside = max(max(fogBoxMin - pos, pos - fogBoxMax), 0.0);
+	float density = fogDensity * (1.0 - smoothstep(0.0, fogEdge, length(outside)));
+
+	vec3 lightVec = lightPos - pos;
+	float lightDist = length(lightVec);
+	float attenuation = 1.0 / (1.0 + 0.09 * lightDist + 0.032 * lightDist * lightDist);
+	float cosTheta = dot(-lightVec / max(lightDist, 1e-4), normalize(camPos - pos));
+	vec3 light = lightColor.rgb * attenuation * shadowFactor(0, pos) * phase(cosTheta, fogAnisotropy);
+
+	vec4 result = vec4(density * fogAlbedo * (light + fogAmbient), density);
+
+	if (hasHistory != 0)
+	{
+		vec4 prevClip = prevViewProjection * vec4(pos, 1.0);
+		if (prevClip.w > 0.0)
+		{
+			vec3 prevCoord = vec3(prevClip.xy / prevClip.w * 0.5 + 0.5,
+			                      log(prevClip.w / depthRange.x) / log(depthRange.y / depthRange.x));
+			if (all(greaterThanEqual(prevCoord, vec3(0.0))) && all(lessThanEqual(prevCoord, vec3(1.0))))
+				result = mix(result, texture(history, prevCoord), historyWeight);
+		}
+	}
+
+	FragColor = result;
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+// Accumulates the injected slices front to back: rgb = light scattered between the camera and the
+// far side of the slice, a = transmittance over the same distance
+layout (location = 0) out vec4 integrated;
+// Same value, read back by the next slice
+layout (location = 1) out vec4 carry;
+
+uniform sampler3D scattering;
+uniform sampler2D previous;
+uniform int slice;
+uniform vec3 volumeSize;
+uniform vec2 depthRange;
+
+float sliceDistance(float t){
+	return depthRange.x * pow(depthRange.y / depthRange.x, t);
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	vec4 total = slice > 0 ? texelFetch(previous, texel, 0) : vec4(0.0, 0.0, 0.0, 1.0);
+	vec4 froxel = texelFetch(scattering, ivec3(texel, slice), 0);
+
+	// The first slice also covers the gap in front of the near distance
+	float start = slice > 0 ? sliceDistance(float(slice) / volumeSize.z) : 0.0;
+	float thickness = sliceDistance(float(slice + 1) / volumeSize.z) - start;
+
+	// Scattering integrated analytically over the slice
+	float transmittance = exp(-froxel.a * thickness);
+	vec3 scattered = froxel.a > 1e-5 ? froxel.rgb * (1.0 - transmittance) / froxel.a : froxel.rgb * thickness;
+	total.rgb += total.a * scattered;
+	total.a *= transmittance;
+
+	integrated = total;
+	carry = total;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 texCoord;
+in vec4 color;
+
+// Glyph coverage, with a solid texel used by the plain rectangles
+uniform sampler2D atlas;
+
+void main()
+{
+	FragColor = vec4(color.rgb, color.a * texture(atlas, texCoord).r);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// Screen space quads of the Hud, in pixels from the top left corner
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTex;
+layout (location = 2) in vec4 aColor;
+
+out vec2 texCoord;
+out vec4 color;
+
+uniform vec2 screenSize;
+
+void main()
+{
+	texCoord = aTex;
+	color = aColor;
+	gl_Position = vec4(aPos / screenSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 corner;
+in vec4 color;
+in float viewDepth;
+
+// Copy of the opaque scene's depth buffer
+uniform sampler2D sceneDepth;
+// Near and far planes of the camera, to linearize it
+uniform vec2 depthRange;
+uniform float softDistance;
+
+void main()
+{
+	// Round soft particle
+	float shape = 1.0 - smoothstep(0.5, 1.0, length(corner));
+	if (shape <= 0.0) discard;
+
+	// Fades out instead of cutting a hard line where the quad meets the scene
+	float depth = texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r * 2.0 - 1.0;
+	float sceneDistance = 2.0 * depthRange.x * depthRange.y / (depthRange.y + depthRange.x - depth * (depthRange.y - depthRange.x));
+	float soft = clamp((sceneDistance - viewDepth) / softDistance, 0.0, 1.0);
+
+	FragColor = color * shape * soft;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// One instance per particle: xyz = position, w = size, and its premultiplied color
+layout (location = 0) in vec4 aPositionSize;
+layout (location = 1) in vec4 aColor;
+
+out vec2 corner;
+out vec4 color;
+// Linear depth of the particle, compared to the scene's for the soft fade
+out float viewDepth;
+
+uniform mat4 camMatrix;
+uniform vec3 cameraRight;
+uniform vec3 cameraUp;
+
+void main()
+{
+	// Triangle strip corners in [-1, 1]
+	corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	color = aColor;
+
+	vec3 pos = aPositionSize.xyz + (cameraRight * corner.x + cameraUp * corner.y) * aPositionSize.w;
+	gl_Position = camMatrix * vec4(pos, 1.0);
+	viewDepth = gl_Position.w;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+// Picture rendered by the MonitorSystem
+uniform sampler2D diffuse0;
+
+void main()
+{
+	// Screens glow on their own, with faint scanlines
+	float scanline = 0.85 + 0.15 * sin(texCoord.y * 600.0);
+	FragColor = vec4(texture(diffuse0, texCoord).rgb * scanline, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Monitor screen: a textured quad, no lighting
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec2 aTex;
+
+out vec2 texCoord;
+
+uniform mat4 camMatrix;
+uniform mat4 model;
+
+void main()
+{
+	texCoord = aTex;
+	gl_Position = camMatrix * model * vec4(aPos, 1.0);
+}
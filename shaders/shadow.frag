@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 worldPos;
+
+uniform vec3 lightPos;
+uniform float farPlane;
+
+void main()
+{
+	// Stores the linear distance to the light so every face compares the same quantity
+	gl_FragDepth = length(worldPos - lightPos) / farPlane;
+}
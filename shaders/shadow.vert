@@ -0,0 +1,34 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+// Skin of skinned meshes: 4 bones and their weights
+layout (location = 5) in uvec4 aJoints;
+layout (location = 6) in vec4 aWeights;
+
+// Outputs the world position to compute the distance to the light
+out vec3 worldPos;
+
+// View-projection of the cube face being rendered
+uniform mat4 shadowMatrix;
+uniform mat4 model;
+
+// Skinning matrix of every bone, see default.vert
+#define MAX_BONES 128
+layout (std140) uniform Joints
+{
+	mat4 jointMatrices[MAX_BONES];
+};
+uniform int skinEnabled;
+
+void main()
+{
+	vec3 position = aPos;
+	if (skinEnabled != 0)
+	{
+		mat4 skin = jointMatrices[aJoints.x] * aWeights.x + jointMatrices[aJoints.y] * aWeights.y +
+			jointMatrices[aJoints.z] * aWeights.z + jointMatrices[aJoints.w] * aWeights.w;
+		position = vec3(skin * vec4(aPos, 1.0));
+	}
+	worldPos = vec3(model * vec4(position, 1.0));
+	gl_Position = shadowMatrix * vec4(worldPos, 1.0);
+}
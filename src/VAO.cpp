@@ -13,6 +13,14 @@ void VAO::LinkAttrib(VBO VBO, GLuint layout, GLuint numComp, GLenum type, GLsize
     VBO.Unbind();
 }
 
+void VAO::LinkAttribI(VBO VBO, GLuint layout, GLuint numComp, GLenum type, GLsizeiptr stride, void* offset)
+{
+    VBO.Bind();
+    glVertexAttribIPointer(layout,numComp,type,stride,offset);
+    glEnableVertexAttribArray(layout);
+    VBO.Unbind();
+}
+
 void VAO::Bind()
 {
     glBindVertexArray(ID);
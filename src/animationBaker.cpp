@@ -0,0 +1,447 @@
+#include "animationBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_access.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <assimp/postprocess.h>
+
+static glm::mat4 toGlm(const aiMatrix4x4& m)
+{
+    // assimp matrices are row major
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
+
+// Translation, rotation and scale of a matrix without shear
+static void decompose(const glm::mat4& m, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale)
+{
+    translation = glm::vec3(m[3]);
+    glm::mat3 basis(m);
+    scale = glm::vec3(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+    // Mirrored matrices keep a proper rotation, the flip goes to the scale
+    if (glm::determinant(basis) < 0.0f)
+    {
+        scale.x = -scale.x;
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        basis[c] /= scale[c];
+    }
+    rotation = glm::normalize(glm::quat_cast(basis));
+}
+
+// Key before the time and how far the time is towards the next one
+template <typename Key>
+static unsigned int findKey(const Key* keys, unsigned int count, double ticks, float& fraction)
+{
+    fraction = 0.0f;
+    if (count < 2 || ticks <= keys[0].mTime)
+    {
+        return 0;
+    }
+    for (unsigned int k = 0; k + 1 < count; k++)
+    {
+        if (ticks < keys[k + 1].mTime)
+        {
+            fraction = (float)((ticks - keys[k].mTime) / (keys[k + 1].mTime - keys[k].mTime));
+            return k;
+        }
+    }
+    return count - 1;
+}
+
+bool AnimationBaker::load(const std::string& path)
+{
+    // Same flags as Model::loadModel, the vertices must come out in the same order
+    scene_ = importer_.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs |
+                                          aiProcess_CalcTangentSpace);
+    if (!scene_ || scene_->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene_->mRootNode)
+    {
+        std::cerr << "Error: Failed to load model " << path << ": " << importer_.GetErrorString() << std::endl;
+        scene_ = nullptr;
+        return false;
+    }
+
+    // Nodes in depth first order, the meshes in the order Model::processNode visits them
+    nodes_.clear();
+    meshes_.clear();
+    joints_.clear();
+    bool skinned = false;
+    std::vector<std::pair<const aiNode*, int>> stack = {{scene_->mRootNode, -1}};
+    while (!stack.empty())
+    {
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+        int index = (int)nodes_.size();
+        nodes_.push_back({node, parent, toGlm(node->mTransformation)});
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            const aiMesh* mesh = scene_->mMeshes[node->mMeshes[i]];
+            meshes_.push_back(mesh);
+            skinned |= mesh->HasBones();
+        }
+        for (unsigned int i = node->mNumChildren; i-- > 0;)
+        {
+            stack.push_back({node->mChildren[i], index});
+        }
+    }
+    if (!skinned)
+    {
+        std::cerr << "Error: " << path << " has no skinned mesh" << std::endl;
+        return false;
+    }
+
+    // One palette for every mesh, joints shared by name
+    for (const aiMesh* mesh : meshes_)
+    {
+        for (unsigned int b = 0; b < mesh->mNumBones; b++)
+        {
+            const aiBone* bone = mesh->mBones[b];
+            std::string name = bone->mName.C_Str();
+            bool known = std::any_of(joints_.begin(), joints_.end(), [&](const Joint& joint) { return joint.name == name; });
+            if (!known)
+            {
+                joints_.push_back({name, findNode(name), toGlm(bone->mOffsetMatrix)});
+            }
+        }
+    }
+    if (joints_.size() > 256)
+    {
+        std::cerr << "Error: " << path << " has more than 256 joints" << std::endl;
+        return false;
+    }
+    for (const Joint& joint : joints_)
+    {
+        if (joint.node < 0)
+        {
+            std::cerr << "Error: no node for joint " << joint.name << std::endl;
+            return false;
+        }
+    }
+
+    // Skins ignore the transform of the mesh node (the glTF files scale it with the armature), the
+    // bind pose of a joint that moves vertices gives the mesh space instead
+    std::vector<glm::mat4> locals(nodes_.size()), global;
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        locals[i] = nodes_[i].local;
+    }
+    globals(locals, global);
+    for (const aiMesh* mesh : meshes_)
+    {
+        for (unsigned int b = 0; b < mesh->mNumBones; b++)
+        {
+            const aiBone* bone = mesh->mBones[b];
+            bool weighted = std::any_of(bone->mWeights, bone->mWeights + bone->mNumWeights,
+                                        [](const aiVertexWeight& weight) { return weight.mWeight > 0.0f; });
+            if (weighted)
+            {
+                meshInverse_ = glm::inverse(global[findNode(bone->mName.C_Str())] * toGlm(bone->mOffsetMatrix));
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+int AnimationBaker::findNode(const std::string& name) const
+{
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        if (name == nodes_[i].node->mName.C_Str())
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void AnimationBaker::globals(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& out) const
+{
+    out.resize(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        out[i] = nodes_[i].parent < 0 ? locals[i] : out[nodes_[i].parent] * locals[i];
+    }
+}
+
+void AnimationBaker::appendFrame(const std::vector<glm::mat4>& locals, BakedAnimation& animation) const
+{
+    std::vector<glm::mat4> global;
+    globals(locals, global);
+    for (const Joint& joint : joints_)
+    {
+        glm::mat4 skin = meshInverse_ * global[joint.node] * joint.offset;
+        for (int r = 0; r < 3; r++)
+        {
+            animation.rows.push_back(glm::row(skin, r));
+        }
+    }
+}
+
+void AnimationBaker::sampleClip(const aiAnimation& clip, double seconds, std::vector<glm::mat4>& locals) const
+{
+    double ticks = seconds * (clip.mTicksPerSecond > 0.0 ? clip.mTicksPerSecond : 25.0);
+    for (unsigned int c = 0; c < clip.mNumChannels; c++)
+    {
+        const aiNodeAnim* channel = clip.mChannels[c];
+        int node = findNode(channel->mNodeName.C_Str());
+        if (node < 0)
+        {
+            continue;
+        }
+
+        float t;
+        aiVector3D position(0.0f), scaling(1.0f);
+        aiQuaternion rotation;
+        if (channel->mNumPositionKeys > 0)
+        {
+            unsigned int k = findKey(channel->mPositionKeys, channel->mNumPositionKeys, ticks, t);
+            position = channel->mPositionKeys[k].mValue;
+            if (t > 0.0f)
+                position += (channel->mPositionKeys[k + 1].mValue - position) * t;
+        }
+        if (channel->mNumRotationKeys > 0)
+        {
+            unsigned int k = findKey(channel->mRotationKeys, channel->mNumRotationKeys, ticks, t);
+            rotation = channel->mRotationKeys[k].mValue;
+            if (t > 0.0f)
+                aiQuaternion::Interpolate(rotation, channel->mRotationKeys[k].mValue, channel->mRotationKeys[k + 1].mValue, t);
+        }
+        if (channel->mNumScalingKeys > 0)
+        {
+            unsigned int k = findKey(channel->mScalingKeys, channel->mNumScalingKeys, ticks, t);
+            scaling = channel->mScalingKeys[k].mValue;
+            if (t > 0.0f)
+                scaling += (channel->mScalingKeys[k + 1].mValue - scaling) * t;
+        }
+
+        locals[node] = toGlm(aiMatrix4x4(scaling, rotation, position));
+    }
+}
+
+void AnimationBaker::sampleFrames(const std::vector<ProceduralClip>& procedural, const ClipVisitor& beginClip,
+                                  const FrameVisitor& frame) const
+{
+    std::vector<glm::mat4> rest(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        rest[i] = nodes_[i].local;
+    }
+    std::vector<glm::mat4> locals;
+
+    for (unsigned int a = 0; a < scene_->mNumAnimations; a++)
+    {
+        const aiAnimation& clip = *scene_->mAnimations[a];
+        double tps = clip.mTicksPerSecond > 0.0 ? clip.mTicksPerSecond : 25.0;
+        std::string name = clip.mName.length ? clip.mName.C_Str() : "clip" + std::to_string(a);
+        int frameCount = std::max(1, (int)std::lround(clip.mDuration / tps * frameRate));
+        beginClip(name, frameCount);
+        for (int f = 0; f < frameCount; f++)
+        {
+            locals = rest;
+            sampleClip(clip, f / (double)frameRate, locals);
+            frame(locals);
+        }
+    }
+
+    // Procedural curves are given in the mesh space of the bind pose, around the joint
+    std::vector<glm::mat4> restGlobal;
+    globals(rest, restGlobal);
+    for (const ProceduralClip& clip : procedural)
+    {
+        int frameCount = std::max(1, (int)std::lround(clip.duration * frameRate));
+        beginClip(clip.name, frameCount);
+
+        std::vector<int> curveNodes;
+        for (const Curve& curve : clip.curves)
+        {
+            curveNodes.push_back(findNode(curve.joint));
+            if (curveNodes.back() < 0)
+            {
+                std::cerr << "Error: clip " << clip.name << " animates unknown joint " << curve.joint << std::endl;
+            }
+        }
+
+        for (int f = 0; f < frameCount; f++)
+        {
+            float phase = 6.2831853f * f / frameCount;
+            std::map<int, glm::mat4> motions;
+            for (size_t c = 0; c < clip.curves.size(); c++)
+            {
+                const Curve& curve = clip.curves[c];
+                int node = curveNodes[c];
+                if (node < 0)
+                {
+                    continue;
+                }
+
+                float value = curve.offset + curve.amplitude * std::sin(phase * curve.cycles + curve.phase);
+                glm::mat4 motion;
+                if (curve.translate)
+                {
+                    motion = glm::translate(glm::mat4(1.0f), glm::normalize(curve.axis) * value);
+                }
+                else
+                {
+                    glm::vec3 pivot(meshInverse_ * restGlobal[node][3]);
+                    motion = glm::translate(glm::mat4(1.0f), pivot) *
+                             glm::rotate(glm::mat4(1.0f), glm::radians(value), glm::normalize(curve.axis)) *
+                             glm::translate(glm::mat4(1.0f), -pivot);
+                }
+                auto it = motions.find(node);
+                motions[node] = it == motions.end() ? motion : motion * it->second;
+            }
+
+            // A mesh space motion M of a joint is M' = G^-1 * M * G in its own space, G being its bind pose
+            locals = rest;
+            for (const auto& [node, motion] : motions)
+            {
+                glm::mat4 bind = meshInverse_ * restGlobal[node];
+                locals[node] = locals[node] * glm::inverse(bind) * motion * bind;
+            }
+            frame(locals);
+        }
+    }
+}
+
+bool AnimationBaker::bake(const std::vector<ProceduralClip>& procedural, BakedAnimation& animation) const
+{
+    if (!scene_)
+    {
+        return false;
+    }
+
+    animation.frameRate = frameRate;
+    animation.jointCount = (int)joints_.size();
+    animation.clips.clear();
+    animation.rows.clear();
+
+    sampleFrames(
+        procedural,
+        [&](const std::string& name, int frameCount) {
+            BakedAnimation::Clip baked;
+            baked.name = name;
+            baked.firstFrame = animation.frameCount();
+            baked.frameCount = frameCount;
+            animation.clips.push_back(baked);
+        },
+        [&](const std::vector<glm::mat4>& locals) { appendFrame(locals, animation); });
+
+    // Four strongest joints per vertex
+    animation.meshVertexCounts.clear();
+    animation.joints.clear();
+    animation.weights.clear();
+    for (const aiMesh* mesh : meshes_)
+    {
+        std::vector<std::vector<std::pair<float, int>>> influences(mesh->mNumVertices);
+        for (unsigned int b = 0; b < mesh->mNumBones; b++)
+        {
+            const aiBone* bone = mesh->mBones[b];
+            int joint = 0;
+            while (joints_[joint].name != bone->mName.C_Str())
+            {
+                joint++;
+            }
+            for (unsigned int w = 0; w < bone->mNumWeights; w++)
+            {
+                const aiVertexWeight& weight = bone->mWeights[w];
+                if (weight.mWeight > 0.0f)
+                {
+                    influences[weight.mVertexId].push_back({weight.mWeight, joint});
+                }
+            }
+        }
+
+        animation.meshVertexCounts.push_back(mesh->mNumVertices);
+        for (auto& vertex : influences)
+        {
+            std::sort(vertex.begin(), vertex.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            vertex.resize(std::min<size_t>(vertex.size(), 4));
+            glm::u8vec4 joints(0);
+            glm::vec4 weights(0.0f);
+            float total = 0.0f;
+            for (size_t k = 0; k < vertex.size(); k++)
+            {
+                joints[k] = (uint8_t)vertex[k].second;
+                weights[k] = vertex[k].first;
+                total += vertex[k].first;
+            }
+            // Unskinned vertices follow the first joint
+            animation.joints.push_back(joints);
+            animation.weights.push_back(total > 0.0f ? weights / total : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
+        }
+    }
+    return true;
+}
+
+bool AnimationBaker::exportLibrary(const std::vector<ProceduralClip>& procedural, AnimationLibrary& library) const
+{
+    if (!scene_)
+    {
+        return false;
+    }
+
+    // The joints and their ancestors, nodes_ already puts parents first
+    std::vector<int> skeletonIndex(nodes_.size(), -1);
+    std::vector<bool> kept(nodes_.size(), false);
+    for (const Joint& joint : joints_)
+    {
+        for (int node = joint.node; node >= 0 && !kept[node]; node = nodes_[node].parent)
+        {
+            kept[node] = true;
+        }
+    }
+
+    Skeleton& skeleton = library.skeleton;
+    skeleton = Skeleton();
+    std::vector<int> skeletonNodes;
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        if (!kept[i])
+        {
+            continue;
+        }
+        skeletonIndex[i] = (int)skeletonNodes.size();
+        skeletonNodes.push_back((int)i);
+        glm::vec3 translation, scale;
+        glm::quat rotation;
+        decompose(nodes_[i].local, translation, rotation, scale);
+        skeleton.names.push_back(nodes_[i].node->mName.C_Str());
+        skeleton.parents.push_back(nodes_[i].parent < 0 ? -1 : skeletonIndex[nodes_[i].parent]);
+        skeleton.bindTranslations.push_back(translation);
+        skeleton.bindRotations.push_back(rotation);
+        skeleton.bindScales.push_back(scale);
+    }
+    skeleton.meshInverse = meshInverse_;
+    for (const Joint& joint : joints_)
+    {
+        skeleton.skinJoints.push_back(skeletonIndex[joint.node]);
+        skeleton.skinOffsets.push_back(joint.offset);
+    }
+
+    library.clips.clear();
+    std::vector<glm::vec3> translations(skeletonNodes.size()), scales(skeletonNodes.size());
+    std::vector<glm::quat> rotations(skeletonNodes.size());
+    sampleFrames(
+        procedural,
+        [&](const std::string& name, int frameCount) {
+            AnimationClip clip;
+            clip.name = name;
+            clip.frameRate = frameRate;
+            clip.frameCount = frameCount;
+            library.clips.push_back(clip);
+        },
+        [&](const std::vector<glm::mat4>& locals) {
+            for (size_t j = 0; j < skeletonNodes.size(); j++)
+            {
+                decompose(locals[skeletonNodes[j]], translations[j], rotations[j], scales[j]);
+            }
+            AnimationLibrary::packFrame(translations, rotations, scales, library.clips.back().frames);
+        });
+    return true;
+}
@@ -0,0 +1,167 @@
+#include "animationLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char libraryMagic[4] = {'M', 'C', 'S', 'K'};
+static const uint32_t libraryVersion = 1;
+
+int AnimationLibrary::findClip(const std::string& name) const
+{
+    for (size_t i = 0; i < clips.size(); i++)
+    {
+        if (clips[i].name == name)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void AnimationLibrary::packFrame(const std::vector<glm::vec3>& translations, const std::vector<glm::quat>& rotations,
+                                 const std::vector<glm::vec3>& scales, std::vector<JointGroup>& out)
+{
+    size_t groups = (translations.size() + 3) / 4;
+    for (size_t g = 0; g < groups; g++)
+    {
+        JointGroup group;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            // Padding lanes repeat the last joint so they stay valid quaternions
+            size_t joint = std::min(g * 4 + lane, translations.size() - 1);
+            // q and -q are the same rotation, a positive w keeps neighbouring frames close
+            glm::quat q = glm::normalize(rotations[joint]);
+            q = q.w < 0.0f ? -q : q;
+            const float components[4] = {q.x, q.y, q.z, q.w};
+            for (int c = 0; c < 4; c++)
+            {
+                group.rotation[c][lane] = (int16_t)std::lround(std::clamp(components[c], -1.0f, 1.0f) * 32767.0f);
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                group.translation[c][lane] = translations[joint][c];
+                group.scale[c][lane] = scales[joint][c];
+            }
+        }
+        out.push_back(group);
+    }
+}
+
+bool AnimationLibrary::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write animation library: " << path << std::endl;
+        return false;
+    }
+
+    auto write32 = [&](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+    auto writeString = [&](const std::string& text) {
+        write32(text.size());
+        out.write(text.data(), text.size());
+    };
+    auto writeArray = [&](const auto& values) {
+        write32(values.size());
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(values[0]));
+    };
+
+    out.write(libraryMagic, sizeof(libraryMagic));
+    write32(libraryVersion);
+
+    write32(skeleton.names.size());
+    for (const auto& name : skeleton.names)
+    {
+        writeString(name);
+    }
+    writeArray(skeleton.parents);
+    writeArray(skeleton.bindTranslations);
+    writeArray(skeleton.bindRotations);
+    writeArray(skeleton.bindScales);
+    out.write(reinterpret_cast<const char*>(&skeleton.meshInverse), sizeof(glm::mat4));
+    writeArray(skeleton.skinJoints);
+    writeArray(skeleton.skinOffsets);
+
+    write32(clips.size());
+    for (const auto& clip : clips)
+    {
+        writeString(clip.name);
+        out.write(reinterpret_cast<const char*>(&clip.frameRate), sizeof(float));
+        write32(clip.frameCount);
+        write32(clip.looping);
+        writeArray(clip.frames);
+    }
+    return (bool)out;
+}
+
+bool AnimationLibrary::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    auto read32 = [&]() {
+        uint32_t value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+    auto readString = [&](std::string& text) {
+        text.resize(read32());
+        in.read(&text[0], text.size());
+    };
+    auto readArray = [&](auto& values) {
+        values.resize(read32());
+        in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(values[0]));
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, libraryMagic, sizeof(magic)) != 0 || read32() != libraryVersion)
+    {
+        std::cerr << "Error: " << path << " is not an animation library" << std::endl;
+        return false;
+    }
+
+    skeleton.names.resize(read32());
+    for (auto& name : skeleton.names)
+    {
+        readString(name);
+    }
+    readArray(skeleton.parents);
+    readArray(skeleton.bindTranslations);
+    readArray(skeleton.bindRotations);
+    readArray(skeleton.bindScales);
+    in.read(reinterpret_cast<char*>(&skeleton.meshInverse), sizeof(glm::mat4));
+    readArray(skeleton.skinJoints);
+    readArray(skeleton.skinOffsets);
+
+    clips.resize(read32());
+    for (auto& clip : clips)
+    {
+        readString(clip.name);
+        in.read(reinterpret_cast<char*>(&clip.frameRate), sizeof(float));
+        clip.frameCount = (int)read32();
+        clip.looping = read32() != 0;
+        readArray(clip.frames);
+    }
+
+    if (!in)
+    {
+        std::cerr << "Error: truncated animation library: " << path << std::endl;
+        return false;
+    }
+    for (const auto& clip : clips)
+    {
+        if (clip.frames.size() != (size_t)clip.frameCount * skeleton.groupCount())
+        {
+            std::cerr << "Error: clip " << clip.name << " doesn't match the skeleton in " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
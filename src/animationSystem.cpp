@@ -0,0 +1,266 @@
+#include "animationSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "frustum.h"
+#include "jobSystem.h"
+#include "simd.h"
+
+// Normalized lerp of 4 quaternions per lane, along the shortest path
+static void nlerp(const Float4* a, const Float4* b, Float4 t, Float4* out)
+{
+    Float4 dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    Float4 wa = Float4(1.0f) - t;
+    Float4 wb = select(dot < Float4(0.0f), Float4(0.0f) - t, t);
+    for (int c = 0; c < 4; c++)
+    {
+        out[c] = a[c] * wa + b[c] * wb;
+    }
+    Float4 length = sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2] + out[3] * out[3]);
+    for (int c = 0; c < 4; c++)
+    {
+        out[c] = out[c] / length;
+    }
+}
+
+AnimationSystem::AnimationSystem(const AnimationLibrary& library) : library_(library)
+{
+}
+
+int AnimationSystem::add(Model& model, const std::vector<BlendPoint>& blendTree)
+{
+    CharacterState state;
+    state.model = &model;
+    for (const BlendPoint& point : blendTree)
+    {
+        if (point.clip < 0 || point.clip >= (int)library_.clips.size())
+        {
+            std::cerr << "Error: unknown clip in a blend tree" << std::endl;
+            continue;
+        }
+        state.settings.blendTree.push_back(point);
+    }
+    std::sort(state.settings.blendTree.begin(), state.settings.blendTree.end(),
+              [](const BlendPoint& a, const BlendPoint& b) { return a.speed < b.speed; });
+    if (model.joints.size() != library_.skeleton.skinJoints.size())
+    {
+        std::cerr << "Error: the animation library doesn't match the model's joints" << std::endl;
+        state.settings.blendTree.clear();
+    }
+
+    int groups = library_.skeleton.groupCount();
+    state.pose.resize(groups);
+    state.blendPose.resize(groups);
+    state.globals.resize(library_.skeleton.jointCount());
+    state.skin.resize(library_.skeleton.skinJoints.size());
+    characters_.push_back(state);
+    return (int)characters_.size() - 1;
+}
+
+template <typename Task>
+void AnimationSystem::parallel(int count, Task task)
+{
+    JobSystem& jobs = JobSystem::shared();
+    if (!jobs.worthSplitting(count, parallelThreshold))
+    {
+        task(0, count);
+        return;
+    }
+
+    // A character is heavy enough to be a job of its own once there are a few per thread
+    jobs.parallelFor(count, jobs.balancedGrain(count), task);
+}
+
+void AnimationSystem::update(float dt, const Camera& camera)
+{
+    Frustum frustum(camera.cameraMatrix);
+    due_.clear();
+    for (size_t i = 0; i < characters_.size(); i++)
+    {
+        CharacterState& state = characters_[i];
+        state.elapsed += dt;
+        if (state.settings.blendTree.empty())
+        {
+            continue;
+        }
+
+        const Character& settings = state.settings;
+        float distance = glm::length(settings.position - camera.Position);
+        if (!frustum.visible(settings.position, settings.radius))
+            state.interval = offscreenInterval;
+        else
+            state.interval = distance > farDistance ? 4 : distance > midDistance ? 2 : 1;
+
+        // Characters on the same interval take turns instead of all updating on the same frame
+        if (!state.posed || (frame_ + i) % state.interval == 0)
+        {
+            state.posed = true;
+            due_.push_back((int)i);
+        }
+    }
+    frame_++;
+
+    parallel((int)due_.size(), [this](int begin, int end) {
+        for (int k = begin; k < end; k++)
+        {
+            evaluate(characters_[due_[k]]);
+        }
+    });
+
+    // Uploads stay on the thread owning the GL context
+    for (int index : due_)
+    {
+        characters_[index].model->setPose(characters_[index].skin);
+    }
+    evaluated = (int)due_.size();
+}
+
+void AnimationSystem::evaluate(CharacterState& state) const
+{
+    const std::vector<BlendPoint>& tree = state.settings.blendTree;
+
+    // The two clips around the speed, clamped to the ends of the tree
+    size_t upper = 0;
+    while (upper < tree.size() && tree[upper].speed < state.settings.speed)
+    {
+        upper++;
+    }
+    size_t first = upper == 0 ? 0 : upper - 1;
+    size_t second = std::min(upper, tree.size() - 1);
+    float weight = 0.0f;
+    if (first != second && tree[second].speed > tree[first].speed)
+    {
+        weight = (state.settings.speed - tree[first].speed) / (tree[second].speed - tree[first].speed);
+    }
+
+    // Both clips share a normalized phase so the feet of a walk and a run stay in step
+    const AnimationClip& a = library_.clips[tree[first].clip];
+    const AnimationClip& b = library_.clips[tree[second].clip];
+    float duration = std::max(a.duration() + (b.duration() - a.duration()) * weight, 1e-3f);
+    state.phase = std::fmod(state.phase + state.elapsed / duration, 1.0f);
+    state.elapsed = 0.0f;
+
+    sample(a, state.phase * a.duration(), state.pose.data());
+    if (weight > 0.0f)
+    {
+        sample(b, state.phase * b.duration(), state.blendPose.data());
+        Float4 t(weight);
+        for (size_t g = 0; g < state.pose.size(); g++)
+        {
+            PoseGroup& out = state.pose[g];
+            const PoseGroup& in = state.blendPose[g];
+            Float4 qa[4], qb[4], q[4];
+            for (int c = 0; c < 4; c++)
+            {
+                qa[c] = Float4::load(out.rotation[c]);
+                qb[c] = Float4::load(in.rotation[c]);
+            }
+            nlerp(qa, qb, t, q);
+            for (int c = 0; c < 4; c++)
+            {
+                q[c].store(out.rotation[c]);
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                Float4 ta = Float4::load(out.translation[c]), sa = Float4::load(out.scale[c]);
+                (ta + (Float4::load(in.translation[c]) - ta) * t).store(out.translation[c]);
+                (sa + (Float4::load(in.scale[c]) - sa) * t).store(out.scale[c]);
+            }
+        }
+    }
+
+    toSkin(state);
+}
+
+void AnimationSystem::sample(const AnimationClip& clip, float time, PoseGroup* out) const
+{
+    int groups = library_.skeleton.groupCount();
+    float frame = time * clip.frameRate;
+    int frameA, frameB;
+    if (clip.looping)
+    {
+        frame = std::fmod(frame, (float)clip.frameCount);
+        frame = frame < 0.0f ? frame + clip.frameCount : frame;
+        frameA = std::min((int)frame, clip.frameCount - 1);
+        frameB = (frameA + 1) % clip.frameCount;
+    }
+    else
+    {
+        frame = std::min(std::max(frame, 0.0f), (float)(clip.frameCount - 1));
+        frameA = (int)frame;
+        frameB = std::min(frameA + 1, clip.frameCount - 1);
+    }
+    Float4 t(frame - (float)(int)frame);
+
+    const JointGroup* a = &clip.frames[(size_t)frameA * groups];
+    const JointGroup* b = &clip.frames[(size_t)frameB * groups];
+    const Float4 quantum(1.0f / 32767.0f);
+    for (int g = 0; g < groups; g++)
+    {
+        Float4 qa[4], qb[4], q[4];
+        for (int c = 0; c < 4; c++)
+        {
+            qa[c] = Float4::loadInt16(a[g].rotation[c]) * quantum;
+            qb[c] = Float4::loadInt16(b[g].rotation[c]) * quantum;
+        }
+        nlerp(qa, qb, t, q);
+        for (int c = 0; c < 4; c++)
+        {
+            q[c].store(out[g].rotation[c]);
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            Float4 ta = Float4::load(a[g].translation[c]), sa = Float4::load(a[g].scale[c]);
+            (ta + (Float4::load(b[g].translation[c]) - ta) * t).store(out[g].translation[c]);
+            (sa + (Float4::load(b[g].scale[c]) - sa) * t).store(out[g].scale[c]);
+        }
+    }
+}
+
+void AnimationSystem::toSkin(CharacterState& state) const
+{
+    const Skeleton& skeleton = library_.skeleton;
+    int jointCount = skeleton.jointCount();
+    const Float4 one(1.0f), two(2.0f);
+
+    for (size_t g = 0; g < state.pose.size(); g++)
+    {
+        // Rotation matrices of the 4 joints, columns scaled
+        const PoseGroup& pose = state.pose[g];
+        Float4 x = Float4::load(pose.rotation[0]), y = Float4::load(pose.rotation[1]);
+        Float4 z = Float4::load(pose.rotation[2]), w = Float4::load(pose.rotation[3]);
+        Float4 sx = Float4::load(pose.scale[0]), sy = Float4::load(pose.scale[1]), sz = Float4::load(pose.scale[2]);
+        Float4 xx = x * x, yy = y * y, zz = z * z;
+        Float4 xy = x * y, xz = x * z, yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+
+        alignas(16) float m[9][4];
+        (sx * (one - two * (yy + zz))).store(m[0]);
+        (sx * (two * (xy + wz))).store(m[1]);
+        (sx * (two * (xz - wy))).store(m[2]);
+        (sy * (two * (xy - wz))).store(m[3]);
+        (sy * (one - two * (xx + zz))).store(m[4]);
+        (sy * (two * (yz + wx))).store(m[5]);
+        (sz * (two * (xz + wy))).store(m[6]);
+        (sz * (two * (yz - wx))).store(m[7]);
+        (sz * (one - two * (xx + yy))).store(m[8]);
+
+        // Parents come first, so their model space matrix is always ready
+        for (int lane = 0; lane < 4 && (int)g * 4 + lane < jointCount; lane++)
+        {
+            int joint = (int)g * 4 + lane;
+            glm::mat4 local(m[0][lane], m[1][lane], m[2][lane], 0.0f,
+                            m[3][lane], m[4][lane], m[5][lane], 0.0f,
+                            m[6][lane], m[7][lane], m[8][lane], 0.0f,
+                            pose.translation[0][lane], pose.translation[1][lane], pose.translation[2][lane], 1.0f);
+            int parent = skeleton.parents[joint];
+            state.globals[joint] = (parent < 0 ? skeleton.meshInverse : state.globals[parent]) * local;
+        }
+    }
+
+    for (size_t k = 0; k < state.skin.size(); k++)
+    {
+        state.skin[k] = state.globals[skeleton.skinJoints[k]] * skeleton.skinOffsets[k];
+    }
+}
@@ -0,0 +1,147 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "animationBaker.h"
+
+// Offline animation baker. Run it from the runtime directory (build/bin): the clips of
+// ./models/player.glb are baked into ./animations/player.anim, which the game loads for the crowds,
+// and exported with the skeleton to ./animations/player.clips for the animation runtime.
+//
+// usage: Animator [output] [--model path] [--fps N]
+
+// The player model ships without animations, these clips are authored on top of its bind pose
+// (a T-pose, mesh space: +y up, +z forward, the character's left towards +x, about 1630 units tall)
+static std::vector<AnimationBaker::ProceduralClip> playerClips()
+{
+    const glm::vec3 side(1.0f, 0.0f, 0.0f), up(0.0f, 1.0f, 0.0f), forward(0.0f, 0.0f, 1.0f);
+    const float pi = 3.14159265f;
+
+    AnimationBaker::ProceduralClip idle;
+    idle.name = "idle";
+    idle.duration = 3.0f;
+    idle.curves = {
+        {"arm_L_upper_04", forward, -75.0f, 0.0f},
+        {"arm_L_upper_04", side, 0.0f, 3.0f, 1, 0.0f},
+        {"arm_L_lower_05", up, -10.0f, 0.0f},
+        {"arm_R_upper_018", forward, 75.0f, 0.0f},
+        {"arm_R_upper_018", side, 0.0f, 3.0f, 1, pi},
+        {"arm_R_lower_019", up, 10.0f, 0.0f},
+        {"spine_002_02", side, 0.0f, 1.5f, 2, 0.0f},
+        {"spine_004_031", up, 0.0f, 10.0f, 1, 0.0f},
+    };
+
+    AnimationBaker::ProceduralClip walk;
+    walk.name = "walk";
+    walk.duration = 1.0f;
+    walk.curves = {
+        {"_rootJoint", up, 0.0f, 20.0f, 2, pi / 2.0f, true},
+        {"thigh_L_032", side, 0.0f, 25.0f, 1, 0.0f},
+        {"shin_L_033", side, 20.0f, 20.0f, 1, -pi / 2.0f},
+        {"thigh_R_037", side, 0.0f, 25.0f, 1, pi},
+        {"shin_R_038", side, 20.0f, 20.0f, 1, pi / 2.0f},
+        {"arm_L_upper_04", forward, -75.0f, 0.0f},
+        {"arm_L_upper_04", side, 0.0f, 20.0f, 1, pi},
+        {"arm_L_lower_05", up, -20.0f, 0.0f},
+        {"arm_R_upper_018", forward, 75.0f, 0.0f},
+        {"arm_R_upper_018", side, 0.0f, 20.0f, 1, 0.0f},
+        {"arm_R_lower_019", up, 20.0f, 0.0f},
+        {"spine_002_02", up, 0.0f, 5.0f, 1, pi},
+    };
+
+    AnimationBaker::ProceduralClip run;
+    run.name = "run";
+    run.duration = 0.7f;
+    run.curves = {
+        {"_rootJoint", up, 0.0f, 40.0f, 2, pi / 2.0f, true},
+        {"spine_002_02", side, 10.0f, 0.0f},
+        {"thigh_L_032", side, 5.0f, 45.0f, 1, 0.0f},
+        {"shin_L_033", side, 40.0f, 35.0f, 1, -pi / 2.0f},
+        {"thigh_R_037", side, 5.0f, 45.0f, 1, pi},
+        {"shin_R_038", side, 40.0f, 35.0f, 1, pi / 2.0f},
+        {"arm_L_upper_04", forward, -70.0f, 0.0f},
+        {"arm_L_upper_04", side, 0.0f, 40.0f, 1, pi},
+        {"arm_L_lower_05", up, -60.0f, 0.0f},
+        {"arm_R_upper_018", forward, 70.0f, 0.0f},
+        {"arm_R_upper_018", side, 0.0f, 40.0f, 1, 0.0f},
+        {"arm_R_lower_019", up, 60.0f, 0.0f},
+        {"spine_002_02", up, 0.0f, 8.0f, 1, pi},
+    };
+
+    AnimationBaker::ProceduralClip wave;
+    wave.name = "wave";
+    wave.duration = 2.0f;
+    wave.curves = {
+        {"arm_L_upper_04", forward, -75.0f, 0.0f},
+        {"arm_L_lower_05", up, -10.0f, 0.0f},
+        {"arm_R_upper_018", forward, -50.0f, 0.0f},
+        {"arm_R_lower_019", forward, -40.0f, 25.0f, 4, 0.0f},
+        {"spine_004_031", forward, 0.0f, 5.0f, 1, 0.0f},
+    };
+
+    return {idle, walk, run, wave};
+}
+
+int main(int argc, char** argv)
+{
+    std::string output = "./animations/player.anim";
+    std::string model = "./models/player.glb";
+    AnimationBaker baker;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--model") && hasValue) model = argv[++i];
+        else if (!std::strcmp(argv[i], "--fps") && hasValue) baker.frameRate = (float)std::atof(argv[++i]);
+        else if (argv[i][0] != '-') output = argv[i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [output] [--model path] [--fps N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!baker.load(model))
+    {
+        return 1;
+    }
+
+    // Clips shipped with the model come first, the authored ones are only added when it has none
+    BakedAnimation animation;
+    std::vector<AnimationBaker::ProceduralClip> procedural;
+    if (baker.clipCount() == 0)
+    {
+        procedural = playerClips();
+    }
+    if (!baker.bake(procedural, animation))
+    {
+        return 1;
+    }
+
+    std::filesystem::path path(output);
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    if (!animation.save(output))
+    {
+        return 1;
+    }
+
+    AnimationLibrary library;
+    std::string libraryPath = path.replace_extension(".clips").string();
+    if (!baker.exportLibrary(procedural, library) || !library.save(libraryPath))
+    {
+        return 1;
+    }
+
+    for (const auto& clip : animation.clips)
+    {
+        std::cout << "Baked " << clip.name << ": " << clip.frameCount << " frames" << std::endl;
+    }
+    std::cout << animation.jointCount << " joints, " << animation.frameCount() << " frames written to " << output
+              << std::endl;
+    std::cout << library.skeleton.jointCount() << " skeleton joints written to " << libraryPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "bakedAnimation.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char animationMagic[4] = {'M', 'C', 'A', 'N'};
+static const uint32_t animationVersion = 1;
+
+int BakedAnimation::findClip(const std::string& name) const
+{
+    for (size_t i = 0; i < clips.size(); i++)
+    {
+        if (clips[i].name == name)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+size_t BakedAnimation::meshOffset(size_t mesh) const
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < mesh && i < meshVertexCounts.size(); i++)
+    {
+        offset += meshVertexCounts[i];
+    }
+    return offset;
+}
+
+bool BakedAnimation::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write animation: " << path << std::endl;
+        return false;
+    }
+
+    auto write32 = [&](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    out.write(animationMagic, sizeof(animationMagic));
+    write32(animationVersion);
+    out.write(reinterpret_cast<const char*>(&frameRate), sizeof(frameRate));
+    write32(jointCount);
+    write32(clips.size());
+    for (const auto& clip : clips)
+    {
+        write32(clip.name.size());
+        out.write(clip.name.data(), clip.name.size());
+        write32(clip.firstFrame);
+        write32(clip.frameCount);
+        write32(clip.looping);
+    }
+    write32(rows.size());
+    out.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(glm::vec4));
+    write32(meshVertexCounts.size());
+    out.write(reinterpret_cast<const char*>(meshVertexCounts.data()), meshVertexCounts.size() * sizeof(uint32_t));
+    write32(joints.size());
+    out.write(reinterpret_cast<const char*>(joints.data()), joints.size() * sizeof(glm::u8vec4));
+    out.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(glm::vec4));
+    return (bool)out;
+}
+
+bool BakedAnimation::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    auto read32 = [&]() {
+        uint32_t value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, animationMagic, sizeof(magic)) != 0 || read32() != animationVersion)
+    {
+        std::cerr << "Error: " << path << " is not an animation file" << std::endl;
+        return false;
+    }
+
+    in.read(reinterpret_cast<char*>(&frameRate), sizeof(frameRate));
+    jointCount = (int)read32();
+    clips.resize(read32());
+    for (auto& clip : clips)
+    {
+        clip.name.resize(read32());
+        in.read(&clip.name[0], clip.name.size());
+        clip.firstFrame = (int)read32();
+        clip.frameCount = (int)read32();
+        clip.looping = read32() != 0;
+    }
+    rows.resize(read32());
+    in.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(glm::vec4));
+    meshVertexCounts.resize(read32());
+    in.read(reinterpret_cast<char*>(meshVertexCounts.data()), meshVertexCounts.size() * sizeof(uint32_t));
+    joints.resize(read32());
+    weights.resize(joints.size());
+    in.read(reinterpret_cast<char*>(joints.data()), joints.size() * sizeof(glm::u8vec4));
+    in.read(reinterpret_cast<char*>(weights.data()), weights.size() * sizeof(glm::vec4));
+
+    if (!in)
+    {
+        std::cerr << "Error: truncated animation file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
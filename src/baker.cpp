@@ -0,0 +1,434 @@
+#include "baker.h"
+
+#include <cfloat>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "stb_image.h"
+
+// Same attenuation as pointLight() in default.frag
+static float attenuation(float dist)
+{
+    return 1.0f / (1.0f + 0.09f * dist + 0.032f * dist * dist);
+}
+
+// Average color of the albedo texture, grey when it can't be read
+static glm::vec3 averageColor(const char* path)
+{
+    int width, height, channels;
+    unsigned char* bytes = stbi_load(path, &width, &height, &channels, 3);
+    if (bytes == NULL)
+    {
+        std::cerr << "Warning: Failed to load albedo " << path << ", using grey" << std::endl;
+        return glm::vec3(0.5f);
+    }
+
+    glm::dvec3 sum(0.0);
+    size_t count = (size_t)width * height;
+    for (size_t i = 0; i < count; i++)
+    {
+        sum += glm::dvec3(bytes[i * 3], bytes[i * 3 + 1], bytes[i * 3 + 2]);
+    }
+    stbi_image_free(bytes);
+    return glm::vec3(sum / (255.0 * count));
+}
+
+Baker::Baker(const StaticSurface* surfaces, size_t surfaceCount, const StaticLight* lights, size_t lightCount)
+    : surfaces_(surfaces), surfaceCount_(surfaceCount), lights_(lights), lightCount_(lightCount)
+{
+    std::map<std::string, glm::vec3> albedoCache;
+    for (size_t s = 0; s < surfaceCount; s++)
+    {
+        const StaticSurface& surface = surfaces[s];
+
+        std::vector<glm::vec3> positions(surface.vertexCount);
+        for (size_t i = 0; i < surface.vertexCount; i++)
+        {
+            positions[i] = surface.vertices[i].position;
+        }
+        tracer_.addMesh(positions, surface.indices, surface.indexCount, (int)s);
+
+        auto cached = albedoCache.find(surface.albedo);
+        if (cached == albedoCache.end())
+        {
+            cached = albedoCache.emplace(surface.albedo, averageColor(surface.albedo)).first;
+        }
+        albedos_.push_back(cached->second);
+    }
+    tracer_.build();
+}
+
+float Baker::random(unsigned int& state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 Baker::cosineSample(const glm::vec3& normal, unsigned int& rng)
+{
+    float phi = 6.28318531f * random(rng);
+    float r2 = random(rng);
+    float r = std::sqrt(r2);
+
+    glm::vec3 reference = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 tangent = glm::normalize(glm::cross(reference, normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * std::sqrt(1.0f - r2);
+}
+
+void Baker::direct(const glm::vec3* positions, const glm::vec3* normals, int lanes, glm::vec3* result) const
+{
+    for (int lane = 0; lane < 4; lane++)
+    {
+        result[lane] = glm::vec3(0.0f);
+    }
+
+    for (size_t l = 0; l < lightCount_; l++)
+    {
+        RayPacket shadow;
+        float cosines[4] = {};
+        float distances[4] = {};
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!(lanes & (1 << lane)))
+            {
+                continue;
+            }
+            glm::vec3 toLight = lights_[l].position - positions[lane];
+            float dist = glm::length(toLight);
+            glm::vec3 direction = toLight / dist;
+            float cosine = glm::dot(normals[lane], direction);
+            if (cosine <= 0.0f)
+            {
+                continue;
+            }
+            cosines[lane] = cosine;
+            distances[lane] = dist;
+            shadow.set(lane, positions[lane] + normals[lane] * 1e-3f, direction, dist - 2e-3f);
+        }
+
+        int blocked = tracer_.occluded(shadow);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if ((shadow.active & (1 << lane)) && !(blocked & (1 << lane)))
+            {
+                result[lane] += lights_[l].color * cosines[lane] * attenuation(distances[lane]);
+            }
+        }
+    }
+}
+
+void Baker::trace(const glm::vec3* origins, const glm::vec3* directions, int lanes, unsigned int& rng, glm::vec3* result) const
+{
+    glm::vec3 origin[4], direction[4], throughput[4];
+    for (int lane = 0; lane < 4; lane++)
+    {
+        origin[lane] = origins[lane];
+        direction[lane] = directions[lane];
+        throughput[lane] = glm::vec3(1.0f);
+        result[lane] = glm::vec3(0.0f);
+    }
+
+    // The four paths advance together; lanes drop out of the packet when their path leaves the level
+    for (int bounce = 0; bounce < bounces && lanes; bounce++)
+    {
+        RayPacket packet;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (lanes & (1 << lane))
+            {
+                packet.set(lane, origin[lane], direction[lane], FLT_MAX);
+            }
+        }
+
+        PacketHit hit;
+        tracer_.intersect(packet, hit);
+
+        glm::vec3 hitPos[4], hitNormal[4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!(lanes & (1 << lane)))
+            {
+                continue;
+            }
+            if (hit.triangle[lane] < 0)
+            {
+                lanes &= ~(1 << lane);
+                continue;
+            }
+
+            const RayTriangle& triangle = tracer_.triangles[hit.triangle[lane]];
+            hitPos[lane] = origin[lane] + direction[lane] * hit.t[lane];
+            // Surfaces are lit from whichever side the path arrives
+            hitNormal[lane] = glm::dot(triangle.normal, direction[lane]) > 0.0f ? -triangle.normal : triangle.normal;
+            throughput[lane] *= albedos_[triangle.surface];
+        }
+
+        glm::vec3 irradiance[4];
+        direct(hitPos, hitNormal, lanes, irradiance);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (lanes & (1 << lane))
+            {
+                result[lane] += throughput[lane] * irradiance[lane];
+                origin[lane] = hitPos[lane] + hitNormal[lane] * 1e-3f;
+                direction[lane] = cosineSample(hitNormal[lane], rng);
+            }
+        }
+    }
+}
+
+void Baker::bakeLightmap(Lightmap& lightmap, int padding) const
+{
+    struct Texel
+    {
+        size_t index;
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+
+    // Rasterize every triangle in lightmap space to find the world position of the texels it covers
+    std::vector<Texel> work;
+    std::vector<bool> covered(lightmap.texels.size(), false);
+    glm::vec2 size((float)lightmap.width, (float)lightmap.height);
+    for (const auto& surface : lightmap.surfaces)
+    {
+        const StaticSurface* staticSurface = nullptr;
+        for (size_t s = 0; s < surfaceCount_; s++)
+        {
+            if (surface.name == surfaces_[s].name)
+            {
+                staticSurface = &surfaces_[s];
+            }
+        }
+        if (!staticSurface)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i + 2 < staticSurface->indexCount; i += 3)
+        {
+            unsigned int ids[3] = {staticSurface->indices[i], staticSurface->indices[i + 1], staticSurface->indices[i + 2]};
+            glm::vec2 uv[3];
+            bool mapped = true;
+            for (int k = 0; k < 3; k++)
+            {
+                uv[k] = surface.uvs[ids[k]] * size;
+                mapped = mapped && surface.uvs[ids[k]].x >= 0.0f;
+            }
+            float area = (uv[1].x - uv[0].x) * (uv[2].y - uv[0].y) - (uv[2].x - uv[0].x) * (uv[1].y - uv[0].y);
+            if (!mapped || std::abs(area) < 1e-8f)
+            {
+                continue;
+            }
+
+            glm::ivec2 lo = glm::max(glm::ivec2(glm::floor(glm::min(uv[0], glm::min(uv[1], uv[2])))), glm::ivec2(0));
+            glm::ivec2 hi = glm::min(glm::ivec2(glm::ceil(glm::max(uv[0], glm::max(uv[1], uv[2])))),
+                                     glm::ivec2(lightmap.width - 1, lightmap.height - 1));
+            for (int y = lo.y; y <= hi.y; y++)
+            {
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    glm::vec2 p(x + 0.5f, y + 0.5f);
+                    float w1 = ((p.x - uv[0].x) * (uv[2].y - uv[0].y) - (uv[2].x - uv[0].x) * (p.y - uv[0].y)) / area;
+                    float w2 = ((uv[1].x - uv[0].x) * (p.y - uv[0].y) - (p.x - uv[0].x) * (uv[1].y - uv[0].y)) / area;
+                    float w0 = 1.0f - w1 - w2;
+                    size_t index = (size_t)y * lightmap.width + x;
+                    if (w0 < -1e-4f || w1 < -1e-4f || w2 < -1e-4f || covered[index])
+                    {
+                        continue;
+                    }
+                    covered[index] = true;
+
+                    const Vertex* v = staticSurface->vertices;
+                    glm::vec3 position = v[ids[0]].position * w0 + v[ids[1]].position * w1 + v[ids[2]].position * w2;
+                    glm::vec3 normal = glm::normalize(v[ids[0]].normal * w0 + v[ids[1]].normal * w1 + v[ids[2]].normal * w2);
+                    work.push_back(Texel{index, position, normal});
+                }
+            }
+        }
+    }
+
+    std::cout << "Baking " << work.size() << " texels (" << lightmap.width << "x" << lightmap.height << ")" << std::endl;
+
+    std::atomic<size_t> done(0);
+    int packets = (samples + 3) / 4;
+    parallelFor(work.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Texel& texel = work[i];
+            // Seeded from the texel so the result doesn't depend on the thread count
+            unsigned int rng = (unsigned int)(texel.index * 9781u + 6271u) | 1u;
+
+            glm::vec3 origin = texel.position + texel.normal * 1e-3f;
+            glm::vec3 positions[4] = {texel.position, texel.position, texel.position, texel.position};
+            glm::vec3 normals[4] = {texel.normal, texel.normal, texel.normal, texel.normal};
+            glm::vec3 directLight[4];
+            direct(positions, normals, 1, directLight);
+
+            glm::vec3 indirect(0.0f);
+            for (int p = 0; p < packets; p++)
+            {
+                glm::vec3 origins[4] = {origin, origin, origin, origin};
+                glm::vec3 directions[4];
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    directions[lane] = cosineSample(texel.normal, rng);
+                }
+                glm::vec3 radiance[4];
+                trace(origins, directions, 0xF, rng, radiance);
+                indirect += radiance[0] + radiance[1] + radiance[2] + radiance[3];
+            }
+
+            lightmap.texels[texel.index] = directLight[0] + indirect / (float)(packets * 4);
+        }
+
+        size_t previous = done.fetch_add(end - begin);
+        if ((previous * 20) / work.size() != ((previous + end - begin) * 20) / work.size())
+        {
+            std::cout << "  " << ((previous + end - begin) * 100) / work.size() << "%" << std::endl;
+        }
+    });
+
+    // Grow the charts into their padding
+    for (int pass = 0; pass < padding; pass++)
+    {
+        std::vector<bool> next = covered;
+        for (int y = 0; y < lightmap.height; y++)
+        {
+            for (int x = 0; x < lightmap.width; x++)
+            {
+                size_t index = (size_t)y * lightmap.width + x;
+                if (covered[index])
+                {
+                    continue;
+                }
+
+                glm::vec3 sum(0.0f);
+                int count = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        int nx = x + dx, ny = y + dy;
+                        if (nx < 0 || ny < 0 || nx >= lightmap.width || ny >= lightmap.height)
+                        {
+                            continue;
+                        }
+                        size_t neighbour = (size_t)ny * lightmap.width + nx;
+                        if (covered[neighbour])
+                        {
+                            sum += lightmap.texels[neighbour];
+                            count++;
+                        }
+                    }
+                }
+                if (count > 0)
+                {
+                    lightmap.texels[index] = sum / (float)count;
+                    next[index] = true;
+                }
+            }
+        }
+        covered = next;
+    }
+}
+
+void Baker::bakeProbes(ProbeGrid& grid) const
+{
+    struct Probe
+    {
+        size_t index;
+        glm::vec3 position;
+    };
+
+    std::vector<Probe> work;
+    for (const auto& room : grid.rooms)
+    {
+        for (int z = 0; z < room.size.z; z++)
+            for (int y = 0; y < room.size.y; y++)
+                for (int x = 0; x < room.size.x; x++)
+                {
+                    glm::ivec3 probe(x, y, z);
+                    work.push_back(Probe{grid.index(room.offset + probe), grid.position(room, probe)});
+                }
+    }
+
+    std::cout << "Baking " << work.size() << " probes" << std::endl;
+
+    // Real L1 basis constants and the cosine lobe convolution (pi for band 0, 2pi/3 for band 1)
+    const float y0 = 0.282095f, y1 = 0.488603f;
+    const float a0 = 3.14159265f, a1 = 2.09439510f;
+    int packets = (samples + 3) / 4;
+
+    parallelFor(work.size(), 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Probe& probe = work[i];
+            unsigned int rng = (unsigned int)(probe.index * 7919u + 104729u) | 1u;
+
+            // Radiance coefficients: band 0 then the (x, y, z) band 1 terms
+            glm::vec3 c0(0.0f), cx(0.0f), cy(0.0f), cz(0.0f);
+
+            // Bounced light, uniform directions over the sphere (4pi / N per sample). The radiance is
+            // divided by pi so that integrating it against the cosine gives the lightmap's units
+            float weight = 4.0f / (packets * 4);
+            for (int p = 0; p < packets; p++)
+            {
+                glm::vec3 origins[4] = {probe.position, probe.position, probe.position, probe.position};
+                glm::vec3 directions[4];
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    float z = 1.0f - 2.0f * random(rng);
+                    float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+                    float phi = 6.28318531f * random(rng);
+                    directions[lane] = glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+                }
+
+                glm::vec3 radiance[4];
+                trace(origins, directions, 0xF, rng, radiance);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    glm::vec3 l = radiance[lane] * weight;
+                    c0 += l * y0;
+                    cx += l * (y1 * directions[lane].x);
+                    cy += l * (y1 * directions[lane].y);
+                    cz += l * (y1 * directions[lane].z);
+                }
+            }
+
+            // Static lights seen from the probe, as directional deltas
+            for (size_t l = 0; l < lightCount_; l++)
+            {
+                glm::vec3 toLight = lights_[l].position - probe.position;
+                float dist = glm::length(toLight);
+                glm::vec3 direction = toLight / dist;
+
+                RayPacket shadow;
+                shadow.set(0, probe.position, direction, dist - 2e-3f);
+                if (tracer_.occluded(shadow))
+                {
+                    continue;
+                }
+
+                glm::vec3 intensity = lights_[l].color * attenuation(dist);
+                c0 += intensity * y0;
+                cx += intensity * (y1 * direction.x);
+                cy += intensity * (y1 * direction.y);
+                cz += intensity * (y1 * direction.z);
+            }
+
+            // Fold the convolution and basis constants so the shader only needs a dot product
+            glm::vec3 e0 = c0 * (a0 * y0);
+            glm::vec3 ex = cx * (a1 * y1), ey = cy * (a1 * y1), ez = cz * (a1 * y1);
+            for (int channel = 0; channel < 3; channel++)
+            {
+                grid.coefficients[channel][probe.index] = glm::vec4(e0[channel], ex[channel], ey[channel], ez[channel]);
+            }
+        }
+    });
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "baker.h"
+#include "lightmap.h"
+#include "probeGrid.h"
+#include "staticLevel.h"
+
+// Headless lighting baker for the static rooms. Run it from the runtime directory (build/bin) so the
+// texture paths resolve, then the game picks up ./lightmaps/level.lm (lightmap) and
+// ./lightmaps/probes.lmp (irradiance probes for dynamic objects) on the next start.
+//
+// usage: Baker [output] [--samples N] [--bounces N] [--density texels-per-unit] [--probe-spacing units] [--threads N]
+
+int main(int argc, char** argv)
+{
+    std::string output = "./lightmaps/level.lm";
+    int samples = 256;
+    int bounces = 3;
+    float density = 32.0f;
+    float probeSpacing = 0.5f;
+    unsigned int threads = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--samples") && hasValue) samples = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--bounces") && hasValue) bounces = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--density") && hasValue) density = (float)std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--probe-spacing") && hasValue) probeSpacing = (float)std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threads") && hasValue) threads = (unsigned int)std::atoi(argv[++i]);
+        else if (argv[i][0] != '-') output = argv[i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [output] [--samples N] [--bounces N] [--density N] [--probe-spacing N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Sized before anything bakes
+    JobSystem::shared(threads);
+    auto start = std::chrono::steady_clock::now();
+
+    const int padding = 2;
+    Lightmap lightmap;
+    lightmap.unwrap(staticSurfaces, staticSurfaceCount, density, 1024, padding);
+
+    Baker baker(staticSurfaces, staticSurfaceCount, staticLights, staticLightCount);
+    baker.samples = samples;
+    baker.bounces = bounces;
+    baker.bakeLightmap(lightmap, padding);
+
+    std::filesystem::path path(output);
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    if (!lightmap.save(output))
+    {
+        return 1;
+    }
+
+    // Probes go next to the lightmap
+    ProbeGrid probes;
+    probes.layout(staticRooms, staticRoomCount, probeSpacing, 0.1f);
+    baker.bakeProbes(probes);
+    std::string probesOutput = (path.parent_path() / "probes.lmp").string();
+    if (!probes.save(probesOutput))
+    {
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Lightmap written to " << output << ", probes to " << probesOutput << " in " << seconds << "s" << std::endl;
+    return 0;
+}
@@ -11,8 +11,6 @@ Camera::Camera(int width, int height, glm::vec3 position, float FOVdeg, float ne
 
 void Camera::updateMatrix(float FOVdeg, float nearPlane, float farPlane, const glm::vec3& target)
 {
-	glm::mat4 view = glm::mat4(1.0f);
-	glm::mat4 projection = glm::mat4(1.0f);
 	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
 
 	view = glm::lookAt(Position, target, up);
@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "materialCooker.h"
+
+// Offline material cooker. Run it from the runtime directory (build/bin): every
+// ./textures/<name>_albedo.png is packed with its _normal, _roughness and _height maps into
+// ./materials/<name>.mat, which the game picks up on the next start.
+//
+// usage: Cooker [output] [--source dir] [--roughness default]
+
+int main(int argc, char** argv)
+{
+    std::string output = "./materials";
+    std::string source = "./textures";
+    MaterialCooker cooker;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--source") && hasValue) source = argv[++i];
+        else if (!std::strcmp(argv[i], "--roughness") && hasValue) cooker.defaultRoughness = (float)std::atof(argv[++i]);
+        else if (argv[i][0] != '-') output = argv[i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [output] [--source dir] [--roughness N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!std::filesystem::is_directory(source))
+    {
+        std::cerr << "Error: no texture directory " << source << std::endl;
+        return 1;
+    }
+    std::filesystem::create_directories(output);
+
+    const std::string suffix = "_albedo.png";
+    int cooked = 0, failed = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(source))
+    {
+        std::string file = entry.path().filename().string();
+        if (file.size() <= suffix.size() || file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            continue;
+        }
+
+        CookedMaterial material;
+        std::string name = file.substr(0, file.size() - suffix.size());
+        if (cooker.cook(source, name, material) && material.save(output))
+        {
+            std::cout << "Cooked " << name << ": albedo " << material.albedo.width << "x" << material.albedo.height
+                      << " (" << material.albedo.channels << " channels), surface " << material.surface.width << "x"
+                      << material.surface.height << std::endl;
+            cooked++;
+        }
+        else
+        {
+            failed++;
+        }
+    }
+
+    std::cout << cooked << " materials written to " << output << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+#include "crowd.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+#include "frustum.h"
+
+// Limbs leave the bind pose bounds, the culling sphere is grown to keep them
+static const float animatedBoundsScale = 1.5f;
+
+Crowd::Crowd(const BakedAnimation& animation, Mesh* mesh, size_t meshIndex, int maxInstances)
+    : clips_(animation.clips), frameRate_(animation.frameRate), mesh_(mesh), maxInstances_(maxInstances)
+{
+    // No model or nothing baked yet
+    if (!mesh || animation.frameCount() == 0)
+    {
+        return;
+    }
+    size_t first = animation.meshOffset(meshIndex);
+    if (meshIndex >= animation.meshVertexCounts.size() || animation.meshVertexCounts[meshIndex] != mesh->vertices.size())
+    {
+        std::cerr << "Error: the baked animation doesn't match the crowd mesh" << std::endl;
+        return;
+    }
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (animation.jointCount * 3 > maxSize || animation.frameCount() > maxSize)
+    {
+        std::cerr << "Error: too many joints or frames in the baked animation" << std::endl;
+        return;
+    }
+    valid_ = true;
+
+    // One row of the texture per frame, three texels per joint
+    glGenTextures(1, &frames_);
+    glBindTexture(GL_TEXTURE_2D, frames_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, animation.jointCount * 3, animation.frameCount(), 0, GL_RGBA, GL_FLOAT,
+                 animation.rows.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The crowd keeps its own copy of the geometry with the skin next to it
+    size_t vertexCount = mesh->vertices.size();
+    size_t jointBytes = vertexCount * sizeof(glm::u8vec4);
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vertexBuffer_);
+    glGenBuffers(1, &skinBuffer_);
+    glGenBuffers(1, &indexBuffer_);
+    glGenBuffers(1, &instanceBuffer_);
+    glBindVertexArray(vao_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), mesh->vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texUV));
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightUV));
+    for (GLuint attribute = 0; attribute <= 4; attribute++)
+    {
+        glEnableVertexAttribArray(attribute);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, skinBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, jointBytes + vertexCount * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, jointBytes, &animation.joints[first]);
+    glBufferSubData(GL_ARRAY_BUFFER, jointBytes, vertexCount * sizeof(glm::vec4), &animation.weights[first]);
+    glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, 0, (void*)0);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 0, (void*)jointBytes);
+    glEnableVertexAttribArray(5);
+    glEnableVertexAttribArray(6);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances_ * sizeof(Instance), NULL, GL_STREAM_DRAW);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(7 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                              (void*)(offsetof(Instance, transform) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(7 + column);
+        glVertexAttribDivisor(7 + column, 1);
+    }
+    glVertexAttribPointer(11, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, clip));
+    glEnableVertexAttribArray(11);
+    glVertexAttribDivisor(11, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(GLuint), mesh->indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    instances_.reserve(maxInstances_);
+    drawn_.reserve(maxInstances_);
+}
+
+int Crowd::add(const glm::mat4& transform, int clip, float rate, float startTime)
+{
+    if ((int)instances_.size() >= maxInstances_)
+    {
+        std::cerr << "Error: the crowd is full (" << maxInstances_ << " instances)" << std::endl;
+        return -1;
+    }
+    instances_.push_back({transform, glm::vec4(0.0f)});
+    play((int)instances_.size() - 1, clip, rate, startTime);
+    return (int)instances_.size() - 1;
+}
+
+void Crowd::setTransform(int instance, const glm::mat4& transform)
+{
+    instances_[instance].transform = transform;
+}
+
+void Crowd::play(int instance, int clip, float rate, float startTime)
+{
+    if (clip < 0 || clip >= (int)clips_.size())
+    {
+        // Bind pose: the first frame of the first clip, frozen
+        instances_[instance].clip = glm::vec4(0.0f, -1.0f, startTime, 0.0f);
+        return;
+    }
+    const BakedAnimation::Clip& baked = clips_[clip];
+    float count = (float)(baked.looping ? baked.frameCount : -baked.frameCount);
+    instances_[instance].clip = glm::vec4((float)baked.firstFrame, count, startTime, rate);
+}
+
+void Crowd::draw(Shader& shader, Camera& camera, float time, GLuint unit, const PortalSystem* portals)
+{
+    visible = 0;
+    if (!valid_ || instances_.empty() || (cell >= 0 && portals && !portals->cellVisible(cell)))
+    {
+        return;
+    }
+
+    Frustum frustum(camera.cameraMatrix);
+    drawn_.clear();
+    for (const Instance& instance : instances_)
+    {
+        const glm::mat4& m = instance.transform;
+        float scale = std::max({glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))});
+        glm::vec3 center(m * glm::vec4(mesh_->boundsCenter, 1.0f));
+        if (frustum.visible(center, mesh_->boundsRadius * scale * animatedBoundsScale))
+        {
+            drawn_.push_back(instance);
+        }
+    }
+    visible = (int)drawn_.size();
+    if (visible == 0)
+    {
+        return;
+    }
+
+    // Orphan last frame's storage so the upload never waits for the GPU to finish with it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances_ * sizeof(Instance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, visible * sizeof(Instance), drawn_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader.Activate();
+    glBindVertexArray(vao_);
+    mesh_->BindTextures();
+    glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+    camera.Matrix(shader, "camMatrix");
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, frames_);
+    glUniform1i(glGetUniformLocation(shader.ID, "boneFrames"), unit);
+    glUniform1f(glGetUniformLocation(shader.ID, "boneFrameRate"), frameRate_);
+    glUniform1f(glGetUniformLocation(shader.ID, "crowdTime"), time);
+    glUniform1i(glGetUniformLocation(shader.ID, "crowdEnabled"), 1);
+    glActiveTexture(GL_TEXTURE0);
+
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh_->indices.size(), GL_UNSIGNED_INT, 0, visible);
+
+    glUniform1i(glGetUniformLocation(shader.ID, "crowdEnabled"), 0);
+    glBindVertexArray(0);
+}
+
+void Crowd::Delete()
+{
+    glDeleteTextures(1, &frames_);
+    glDeleteBuffers(1, &vertexBuffer_);
+    glDeleteBuffers(1, &skinBuffer_);
+    glDeleteBuffers(1, &indexBuffer_);
+    glDeleteBuffers(1, &instanceBuffer_);
+    glDeleteVertexArrays(1, &vao_);
+}
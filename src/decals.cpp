@@ -0,0 +1,466 @@
+#include "decals.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "frustum.h"
+#include "stb_image.h"
+
+// Texels of decal data: three rows of the world to box matrix, atlas rectangle, tint
+static const int texelsPerDecal = 5;
+// Border around each atlas image, repeated from its edge so the mips never bleed into a neighbour
+static const int atlasPadding = 8;
+static const int atlasLevels = 3;
+
+static uint32_t nextRandom(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static float random01(uint32_t& state)
+{
+    return (nextRandom(state) & 0xFFFFFF) / 16777216.0f;
+}
+
+static GLuint createTextureBuffer(GLuint& buffer, GLenum format)
+{
+    GLuint texture;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return texture;
+}
+
+static void upload(GLuint buffer, const void* data, size_t bytes)
+{
+    // Orphan last frame's storage, never empty so the texture buffer stays valid
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(bytes, 16), NULL, GL_STREAM_DRAW);
+    if (bytes > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+DecalSystem::DecalSystem(int maxDecals, int atlasSize, glm::ivec3 clusters, float farDistance)
+    : maxDecals_(maxDecals), atlasSize_(atlasSize), clusters_(clusters), depthRange_(0.1f, farDistance)
+{
+    decals_.reserve(maxDecals_);
+    decalTexture_ = createTextureBuffer(decalBuffer_, GL_RGBA32F);
+    clusterTexture_ = createTextureBuffer(clusterBuffer_, GL_RG32UI);
+    indexTexture_ = createTextureBuffer(indexBuffer_, GL_R32UI);
+
+    // GL 3.3 only promises 65536 texels per texture buffer, the cluster lists are cut to fit
+    GLint maxTexels = 65536;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    maxIndices_ = (uint32_t)maxTexels;
+    maxDecals_ = std::min(maxDecals_, maxTexels / texelsPerDecal);
+}
+
+int DecalSystem::addImage(const char* path)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* bytes = stbi_load(path, &width, &height, &channels, 4);
+    if (!bytes)
+    {
+        std::cerr << "Error: could not load decal image " << path << std::endl;
+        return -1;
+    }
+    std::vector<unsigned char> rgba(bytes, bytes + width * height * 4);
+    stbi_image_free(bytes);
+    return addImage(rgba, width, height);
+}
+
+int DecalSystem::addImage(const std::vector<unsigned char>& rgba, int width, int height)
+{
+    if (atlas_ != 0)
+    {
+        std::cerr << "Error: decal images must be added before the first update" << std::endl;
+        return -1;
+    }
+
+    Image image = {rgba, width, height, glm::vec4(0.0f)};
+    // Halve large images until four fit side by side in the atlas
+    while (image.width > atlasSize_ / 4 || image.height > atlasSize_ / 4)
+    {
+        int w = std::max(image.width / 2, 1), h = std::max(image.height / 2, 1);
+        std::vector<unsigned char> half(w * h * 4);
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    int x0 = std::min(x * 2, image.width - 1), x1 = std::min(x * 2 + 1, image.width - 1);
+                    int y0 = std::min(y * 2, image.height - 1), y1 = std::min(y * 2 + 1, image.height - 1);
+                    int sum = image.rgba[(y0 * image.width + x0) * 4 + c] + image.rgba[(y0 * image.width + x1) * 4 + c] +
+                              image.rgba[(y1 * image.width + x0) * 4 + c] + image.rgba[(y1 * image.width + x1) * 4 + c];
+                    half[(y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        image.rgba.swap(half);
+        image.width = w;
+        image.height = h;
+    }
+
+    images_.push_back(std::move(image));
+    return (int)images_.size() - 1;
+}
+
+int DecalSystem::addShape(Shape shape, int size, const glm::vec4& color, uint32_t seed)
+{
+    uint32_t state = seed * 2654435761u + 1;
+
+    // Random lobes for the splat and scorch outlines, droplets around the splat
+    float phases[4], amplitudes[4];
+    for (int k = 0; k < 4; k++)
+    {
+        phases[k] = random01(state) * 6.2831853f;
+        amplitudes[k] = 0.04f + random01(state) * 0.08f;
+    }
+    glm::vec3 droplets[6];
+    for (glm::vec3& droplet : droplets)
+    {
+        float angle = random01(state) * 6.2831853f, distance = 0.3f + random01(state) * 0.15f;
+        droplet = glm::vec3(cos(angle) * distance, sin(angle) * distance, 0.015f + random01(state) * 0.03f);
+    }
+
+    std::vector<unsigned char> rgba(size * size * 4);
+    float aa = 1.5f / size;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            // Pixel center in [-0.5, 0.5]
+            glm::vec2 p((x + 0.5f) / size - 0.5f, (y + 0.5f) / size - 0.5f);
+            float r = glm::length(p), angle = atan2(p.y, p.x);
+            float outline = 0.0f;
+            for (int k = 0; k < 4; k++)
+            {
+                outline += amplitudes[k] * sin((k + 2) * angle + phases[k]);
+            }
+
+            float alpha = 0.0f;
+            if (shape == Shape::Splat)
+            {
+                alpha = glm::clamp((0.27f * (1.0f + outline) - r) / aa, 0.0f, 1.0f);
+                for (const glm::vec3& droplet : droplets)
+                {
+                    float d = glm::length(p - glm::vec2(droplet));
+                    alpha = std::max(alpha, glm::clamp((droplet.z - d) / aa, 0.0f, 1.0f));
+                }
+            }
+            else if (shape == Shape::Scorch)
+            {
+                // Soft burn, darkest in the middle
+                float edge = 0.42f * (1.0f + outline);
+                alpha = r < edge ? pow(1.0f - r / edge, 0.7f) : 0.0f;
+            }
+            else
+            {
+                // Sole and heel of a shoe print, toes up
+                glm::vec2 sole = (p - glm::vec2(0.0f, 0.12f)) / glm::vec2(0.2f, 0.3f);
+                glm::vec2 heel = (p - glm::vec2(0.0f, -0.3f)) / glm::vec2(0.16f, 0.15f);
+                float inside = std::min(glm::length(sole), glm::length(heel));
+                alpha = glm::clamp((1.0f - inside) * 8.0f, 0.0f, 1.0f) * (0.75f + 0.25f * random01(state));
+            }
+
+            unsigned char* out = &rgba[(y * size + x) * 4];
+            out[0] = (unsigned char)(glm::clamp(color.r, 0.0f, 1.0f) * 255.0f);
+            out[1] = (unsigned char)(glm::clamp(color.g, 0.0f, 1.0f) * 255.0f);
+            out[2] = (unsigned char)(glm::clamp(color.b, 0.0f, 1.0f) * 255.0f);
+            out[3] = (unsigned char)(glm::clamp(alpha * color.a, 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    return addImage(rgba, size, size);
+}
+
+int DecalSystem::add(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& size, float rotation,
+                     int image, const glm::vec4& tint, float depth)
+{
+    if (image < 0 || image >= (int)images_.size())
+    {
+        return -1;
+    }
+
+    // Upright on walls; on floors and ceilings the image top points to -z before the rotation
+    glm::vec3 z = glm::normalize(normal);
+    glm::vec3 up = std::abs(z.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 x = glm::normalize(glm::cross(up, z));
+    glm::vec3 y = glm::cross(z, x);
+    float c = cos(rotation), s = sin(rotation);
+    glm::vec3 rx = x * c + y * s;
+    glm::vec3 ry = y * c - x * s;
+
+    glm::mat4 boxToWorld(glm::vec4(rx * size.x, 0.0f), glm::vec4(ry * size.y, 0.0f), glm::vec4(z * depth * 2.0f, 0.0f),
+                         glm::vec4(position, 1.0f));
+    Decal decal;
+    decal.worldToBox = glm::inverse(boxToWorld);
+    for (int k = 0; k < 8; k++)
+    {
+        glm::vec3 corner((k & 1) ? 0.5f : -0.5f, (k & 2) ? 0.5f : -0.5f, (k & 4) ? 0.5f : -0.5f);
+        decal.corners[k] = glm::vec3(boxToWorld * glm::vec4(corner, 1.0f));
+    }
+    decal.image = image;
+    decal.tint = tint;
+
+    int index;
+    if ((int)decals_.size() < maxDecals_)
+    {
+        index = (int)decals_.size();
+        decals_.push_back(decal);
+    }
+    else
+    {
+        index = next_;
+        decals_[index] = decal;
+        next_ = (next_ + 1) % maxDecals_;
+    }
+    return index;
+}
+
+void DecalSystem::buildAtlas()
+{
+    // Shelf packing, tallest images first
+    std::vector<int> order(images_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return images_[a].height > images_[b].height; });
+
+    std::vector<unsigned char> pixels(atlasSize_ * atlasSize_ * 4, 0);
+    int penX = 0, penY = 0, shelfHeight = 0;
+    for (int index : order)
+    {
+        Image& image = images_[index];
+        int w = image.width + atlasPadding * 2, h = image.height + atlasPadding * 2;
+        if (penX + w > atlasSize_)
+        {
+            penX = 0;
+            penY += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (w > atlasSize_ || penY + h > atlasSize_)
+        {
+            std::cerr << "Error: decal atlas is full, image " << index << " is skipped" << std::endl;
+            continue;
+        }
+
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                int sx = glm::clamp(x - atlasPadding, 0, image.width - 1);
+                int sy = glm::clamp(y - atlasPadding, 0, image.height - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    pixels[((penY + y) * atlasSize_ + penX + x) * 4 + c] = image.rgba[(sy * image.width + sx) * 4 + c];
+                }
+            }
+        }
+        image.rect = glm::vec4(penX + atlasPadding, penY + atlasPadding, image.width, image.height) / (float)atlasSize_;
+        image.rgba.clear();
+        image.rgba.shrink_to_fit();
+
+        penX += w;
+        shelfHeight = std::max(shelfHeight, h);
+    }
+
+    glGenTextures(1, &atlas_);
+    glBindTexture(GL_TEXTURE_2D, atlas_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasSize_, atlasSize_, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, atlasLevels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DecalSystem::update(const Camera& camera, float nearPlane)
+{
+    if (atlas_ == 0)
+    {
+        buildAtlas();
+    }
+
+    depthRange_.x = nearPlane;
+    view_ = camera.view;
+    screenSize_ = glm::vec2((float)camera.width, (float)camera.height);
+
+    Frustum frustum(camera.cameraMatrix);
+    int clusterCount = clusters_.x * clusters_.y * clusters_.z;
+    float sliceScale = clusters_.z / log(depthRange_.y / depthRange_.x);
+    auto slice = [&](float distance) {
+        int s = (int)floor(log(std::max(distance, depthRange_.x) / depthRange_.x) * sliceScale);
+        return glm::clamp(s, 0, clusters_.z - 1);
+    };
+    auto tile = [&](const glm::vec2& ndc) {
+        return glm::clamp(glm::ivec2(glm::floor((ndc * 0.5f + 0.5f) * glm::vec2(clusters_))), glm::ivec2(0),
+                          glm::ivec2(clusters_) - 1);
+    };
+
+    clusterRanges_.assign(clusterCount * 2, 0);
+    decalTexels_.clear();
+    binMin_.clear();
+    binMax_.clear();
+
+    // Oldest first, so newer decals are blended over older ones
+    int count = (int)decals_.size();
+    int first = count == maxDecals_ ? next_ : 0;
+    for (int k = 0; k < count; k++)
+    {
+        const Decal& decal = decals_[(first + k) % count];
+        const Image& image = images_[decal.image];
+        if (image.rect.z <= 0.0f)
+        {
+            continue;
+        }
+
+        glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+        for (const glm::vec3& corner : decal.corners)
+        {
+            boxMin = glm::min(boxMin, corner);
+            boxMax = glm::max(boxMax, corner);
+        }
+        if (!frustum.visible(boxMin, boxMax))
+        {
+            continue;
+        }
+
+        // Screen rectangle and distance range of the box, the whole screen when it crosses the near plane
+        glm::vec2 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+        float distanceMin = FLT_MAX, distanceMax = 0.0f;
+        bool crossesNear = false;
+        for (const glm::vec3& corner : decal.corners)
+        {
+            glm::vec4 clip = camera.cameraMatrix * glm::vec4(corner, 1.0f);
+            distanceMin = std::min(distanceMin, clip.w);
+            distanceMax = std::max(distanceMax, clip.w);
+            if (clip.w <= nearPlane)
+            {
+                crossesNear = true;
+                continue;
+            }
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+        if (distanceMin >= depthRange_.y)
+        {
+            continue;
+        }
+        if (crossesNear)
+        {
+            ndcMin = glm::vec2(-1.0f);
+            ndcMax = glm::vec2(1.0f);
+        }
+
+        glm::ivec3 lo(tile(ndcMin), slice(distanceMin));
+        glm::ivec3 hi(tile(ndcMax), slice(distanceMax));
+        binMin_.push_back(lo);
+        binMax_.push_back(hi);
+        for (int z = lo.z; z <= hi.z; z++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    clusterRanges_[((z * clusters_.y + y) * clusters_.x + x) * 2 + 1]++;
+                }
+
+        glm::mat4 rows = glm::transpose(decal.worldToBox);
+        decalTexels_.push_back(rows[0]);
+        decalTexels_.push_back(rows[1]);
+        decalTexels_.push_back(rows[2]);
+        decalTexels_.push_back(image.rect);
+        decalTexels_.push_back(decal.tint);
+    }
+    visibleDecals = (int)binMin_.size();
+
+    // Offsets from the capped counts, then the lists are filled in a second pass
+    uint32_t offset = 0;
+    busiestCluster = 0;
+    for (int c = 0; c < clusterCount; c++)
+    {
+        uint32_t wanted = clusterRanges_[c * 2 + 1];
+        busiestCluster = std::max(busiestCluster, (int)wanted);
+        clusterRanges_[c * 2] = offset;
+        clusterRanges_[c * 2 + 1] = 0;
+        offset += std::min({wanted, (uint32_t)MAX_DECALS_PER_CLUSTER, maxIndices_ - offset});
+    }
+    clusterIndices_.resize(offset);
+    for (int i = 0; i < visibleDecals; i++)
+    {
+        const glm::ivec3& lo = binMin_[i];
+        const glm::ivec3& hi = binMax_[i];
+        for (int z = lo.z; z <= hi.z; z++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    int c = (z * clusters_.y + y) * clusters_.x + x;
+                    uint32_t start = clusterRanges_[c * 2];
+                    uint32_t end = c + 1 < clusterCount ? clusterRanges_[c * 2 + 2] : offset;
+                    if (start + clusterRanges_[c * 2 + 1] < end)
+                    {
+                        clusterIndices_[start + clusterRanges_[c * 2 + 1]++] = (uint32_t)i;
+                    }
+                }
+    }
+
+    upload(decalBuffer_, decalTexels_.data(), decalTexels_.size() * sizeof(glm::vec4));
+    upload(clusterBuffer_, clusterRanges_.data(), clusterRanges_.size() * sizeof(uint32_t));
+    upload(indexBuffer_, clusterIndices_.data(), clusterIndices_.size() * sizeof(uint32_t));
+}
+
+void DecalSystem::apply(Shader& shader, GLuint firstUnit)
+{
+    shader.Activate();
+
+    const GLenum targets[4] = {GL_TEXTURE_2D, GL_TEXTURE_BUFFER, GL_TEXTURE_BUFFER, GL_TEXTURE_BUFFER};
+    const GLuint textures[4] = {atlas_, decalTexture_, clusterTexture_, indexTexture_};
+    const char* names[4] = {"decalAtlas", "decalData", "decalClusters", "decalIndices"};
+    for (int k = 0; k < 4; k++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + k);
+        glBindTexture(targets[k], textures[k]);
+        glUniform1i(glGetUniformLocation(shader.ID, names[k]), firstUnit + k);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(shader.ID, "decalsEnabled"), atlas_ != 0);
+    glUniform3iv(glGetUniformLocation(shader.ID, "decalGrid"), 1, glm::value_ptr(clusters_));
+    glUniform2fv(glGetUniformLocation(shader.ID, "decalDepthRange"), 1, glm::value_ptr(depthRange_));
+    glUniform2fv(glGetUniformLocation(shader.ID, "decalScreenSize"), 1, glm::value_ptr(screenSize_));
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "decalView"), 1, GL_FALSE, glm::value_ptr(view_));
+}
+
+void DecalSystem::disable(Shader& shader)
+{
+    shader.Activate();
+    glUniform1i(glGetUniformLocation(shader.ID, "decalsEnabled"), 0);
+}
+
+void DecalSystem::Delete()
+{
+    glDeleteTextures(1, &atlas_);
+    glDeleteTextures(1, &decalTexture_);
+    glDeleteTextures(1, &clusterTexture_);
+    glDeleteTextures(1, &indexTexture_);
+    glDeleteBuffers(1, &decalBuffer_);
+    glDeleteBuffers(1, &clusterBuffer_);
+    glDeleteBuffers(1, &indexBuffer_);
+}
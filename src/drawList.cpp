@@ -0,0 +1,87 @@
+#include "drawList.h"
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "jobSystem.h"
+#include "node.h"
+
+void DrawList::build(Node& root, const glm::mat4& viewProjection, OcclusionCuller* occlusion)
+{
+    root.updateBounds();
+    Frustum frustum(viewProjection);
+    items_.clear();
+
+    JobSystem& jobs = JobSystem::shared();
+    if (!jobs.worthSplitting(Node::pool().size(), parallelThreshold))
+    {
+        root.collectVisible(frustum, occlusion, false, items_);
+    }
+    else
+    {
+        // Opened breadth first, so the ranges left are the subtrees below the top levels
+        ranges_.clear();
+        ranges_.push_back({&root, false});
+        size_t next = 0;
+        while (next < ranges_.size() && ranges_.size() - next < jobs.threadCount() * 4)
+        {
+            Range range = ranges_[next++];
+            if (!range.node->cull(frustum, occlusion, range.inside, items_))
+            {
+                continue;
+            }
+            for (const Node* child = range.node->firstChild(); child; child = child->nextSibling())
+            {
+                ranges_.push_back({child, range.inside});
+            }
+        }
+
+        threadItems_.resize(jobs.threadCount());
+        for (ThreadItems& thread : threadItems_)
+        {
+            thread.items.clear();
+        }
+        int count = (int)(ranges_.size() - next);
+        jobs.parallelFor(count, jobs.balancedGrain(count), [&](int begin, int end) {
+            std::vector<Item>& items = threadItems_[std::max(0, JobSystem::threadIndex())].items;
+            for (int k = begin; k < end; k++)
+            {
+                const Range& range = ranges_[next + k];
+                range.node->collectVisible(frustum, occlusion, range.inside, items);
+            }
+        });
+        for (const ThreadItems& thread : threadItems_)
+        {
+            items_.insert(items_.end(), thread.items.begin(), thread.items.end());
+        }
+    }
+
+    std::sort(items_.begin(), items_.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+}
+
+void DrawList::submit(Camera& camera) const
+{
+    GLuint program = 0;
+    GLint modelLocation = -1;
+    const Mesh* bound = nullptr;
+    for (const Item& item : items_)
+    {
+        Mesh* mesh = item.mesh;
+        if (mesh->shader.ID != program)
+        {
+            program = mesh->shader.ID;
+            mesh->shader.Activate();
+            glUniform3f(glGetUniformLocation(program, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+            camera.Matrix(mesh->shader, "camMatrix");
+            modelLocation = glGetUniformLocation(program, "model");
+            bound = nullptr;
+        }
+        if (mesh != bound)
+        {
+            mesh->Bind();
+            bound = mesh;
+        }
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(item.model));
+        mesh->DrawBound();
+    }
+}
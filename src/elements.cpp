@@ -1,4 +1,4 @@
-#include "elements.h"
+#include "staticLevel.h"
 
 // Salle principale
 Vertex MainFloorVerticies[4] = 
@@ -8,7 +8,7 @@ Vertex MainFloorVerticies[4] =
     Vertex{glm::vec3( 3.5f, -1.0f,  3.5f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.5f, -1.0f,  3.5f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint MainFloorIndicies[6] = {0, 1, 2, 2, 3, 0};
+unsigned int MainFloorIndicies[6] = {0, 1, 2, 2, 3, 0};
 
 Vertex MainWallVertices[16] = {
     // Face arrière
@@ -32,7 +32,7 @@ Vertex MainWallVertices[16] = {
     Vertex{glm::vec3( 3.5f,  1.0f,  3.5f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3( 3.5f, -1.0f,  3.5f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,0)}
 };
-GLuint MainWallIndices[24] = {
+unsigned int MainWallIndices[24] = {
     0,1,2, 2,3,0,      // back
     4,5,6, 6,7,4,      // front
     8,9,10, 10,11,8,   // left
@@ -45,7 +45,7 @@ Vertex MainCeilingVertices[4] = {
     Vertex{glm::vec3( 3.5f,  1.0f,  3.5f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.5f,  1.0f,  3.5f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint MainCeilingIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int MainCeilingIndices[6] = {0, 1, 2, 2, 3, 0};
 
 // Couloir
 Vertex corridorFloorVertices[4] = {
@@ -54,7 +54,7 @@ Vertex corridorFloorVertices[4] = {
     Vertex{glm::vec3( 0.5f, -1.0f,  6.0f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-0.5f, -1.0f,  6.0f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint corridorFloorIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int corridorFloorIndices[6] = {0, 1, 2, 2, 3, 0};
 
 Vertex corridorWallVertices[16] = {
     // // Face arrière
@@ -78,7 +78,7 @@ Vertex corridorWallVertices[16] = {
     Vertex{glm::vec3( 0.5f,  1.0f,  6.0f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3( 0.5f, -1.0f,  6.0f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,0)}
 };
-GLuint corridorWallIndices[24] = {
+unsigned int corridorWallIndices[24] = {
     0,1,2, 2,3,0,      // back
     4,5,6, 6,7,4,      // front
     8,9,10, 10,11,8,   // left
@@ -91,7 +91,7 @@ Vertex corridorCeilingVertices[4] = {
     Vertex{glm::vec3( 0.5f,  1.0f,  6.0f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-0.5f,  1.0f,  6.0f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint corridorCeilingIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int corridorCeilingIndices[6] = {0, 1, 2, 2, 3, 0};
 
 // Salle rectangulaire
 Vertex room2FloorVertices[4] = {
@@ -100,7 +100,7 @@ Vertex room2FloorVertices[4] = {
     Vertex{glm::vec3( 3.0f, -1.0f, 10.0f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.0f, -1.0f, 10.0f),  glm::vec3(0,1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint room2FloorIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int room2FloorIndices[6] = {0, 1, 2, 2, 3, 0};
 
 Vertex room2WallVertices[16] = {
     // // Face arrière
@@ -124,7 +124,7 @@ Vertex room2WallVertices[16] = {
     Vertex{glm::vec3( 3.0f,  1.0f, 10.0f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3( 3.0f, -1.0f, 10.0f),  glm::vec3(-1,0,0),glm::vec3(1,1,1), glm::vec2(1,0)}
 };
-GLuint room2WallIndices[24] = {
+unsigned int room2WallIndices[24] = {
     0,1,2, 2,3,0,      // back
     4,5,6, 6,7,4,      // front
     8,9,10, 10,11,8,   // left
@@ -137,7 +137,7 @@ Vertex room2CeilingVertices[4] = {
     Vertex{glm::vec3( 3.0f,  1.0f, 10.0f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.0f,  1.0f, 10.0f),  glm::vec3(0,-1,0),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint room2CeilingIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int room2CeilingIndices[6] = {0, 1, 2, 2, 3, 0};
 
 // Bouchons salle principale (avant) - séparés en 2 parties
 
@@ -148,7 +148,7 @@ Vertex roomFrontCapLeftVertices[4] = {
     Vertex{glm::vec3(-0.5f,  1.0f, 3.5f),  glm::vec3(0,0,-1),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.5f,  1.0f, 3.5f),  glm::vec3(0,0,-1),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint roomFrontCapLeftIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int roomFrontCapLeftIndices[6] = {0, 1, 2, 2, 3, 0};
 
 // Partie droite (à partir du bord droit du couloir)
 Vertex roomFrontCapRightVertices[4] = {
@@ -157,7 +157,7 @@ Vertex roomFrontCapRightVertices[4] = {
     Vertex{glm::vec3(3.5f,  1.0f, 3.5f),  glm::vec3(0,0,-1),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(0.5f,  1.0f, 3.5f),  glm::vec3(0,0,-1),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint roomFrontCapRightIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int roomFrontCapRightIndices[6] = {0, 1, 2, 2, 3, 0};
 
 
 // Bouchons salle rectangulaire (arrière) - séparés en 2 parties
@@ -169,7 +169,7 @@ Vertex room2BackCapLeftVertices[4] = {
     Vertex{glm::vec3(-0.5f,  1.0f, 6.0f),  glm::vec3(0,0,1),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(-3.0f,  1.0f, 6.0f),  glm::vec3(0,0,1),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint room2BackCapLeftIndices[6] = {0, 1, 2, 2, 3, 0};
+unsigned int room2BackCapLeftIndices[6] = {0, 1, 2, 2, 3, 0};
 
 // Partie droite (à partir du bord droit du couloir)
 Vertex room2BackCapRightVertices[4] = {
@@ -178,4 +178,48 @@ Vertex room2BackCapRightVertices[4] = {
     Vertex{glm::vec3(3.0f,  1.0f, 6.0f),  glm::vec3(0,0,1),glm::vec3(1,1,1), glm::vec2(1,1)},
     Vertex{glm::vec3(0.5f,  1.0f, 6.0f),  glm::vec3(0,0,1),glm::vec3(1,1,1), glm::vec2(0,1)}
 };
-GLuint room2BackCapRightIndices[6] = {0, 1, 2, 2, 3, 0};
\ No newline at end of file
+unsigned int room2BackCapRightIndices[6] = {0, 1, 2, 2, 3, 0};
+
+// Surfaces statiques (même textures que dans main.cpp)
+#define STATIC_SURFACE(name, vertices, indices, albedo) \
+    StaticSurface{name, vertices, sizeof(vertices) / sizeof(Vertex), indices, sizeof(indices) / sizeof(unsigned int), albedo}
+
+StaticSurface staticSurfaces[] = {
+    STATIC_SURFACE("MainFloor", MainFloorVerticies, MainFloorIndicies, "./textures/solSalleEclairee_albedo.png"),
+    STATIC_SURFACE("MainWall", MainWallVertices, MainWallIndices, "./textures/murSalleEclairee_albedo.png"),
+    STATIC_SURFACE("MainCeiling", MainCeilingVertices, MainCeilingIndices, "./textures/plafondSalleEclairee_albedo.png"),
+    STATIC_SURFACE("CorridorFloor", corridorFloorVertices, corridorFloorIndices, "./textures/solPasserelle_albedo.png"),
+    STATIC_SURFACE("CorridorWall", corridorWallVertices, corridorWallIndices, "./textures/murSalleEclairee_albedo.png"),
+    STATIC_SURFACE("CorridorCeiling", corridorCeilingVertices, corridorCeilingIndices, "./textures/plafondSalleEclairee_albedo.png"),
+    STATIC_SURFACE("Room2Floor", room2FloorVertices, room2FloorIndices, "./textures/solSalleSombre_albedo.png"),
+    STATIC_SURFACE("Room2Wall", room2WallVertices, room2WallIndices, "./textures/murSalleSombre_albedo.png"),
+    STATIC_SURFACE("Room2Ceiling", room2CeilingVertices, room2CeilingIndices, "./textures/plafondSalleSombre_albedo.png"),
+    STATIC_SURFACE("RoomFrontCapLeft", roomFrontCapLeftVertices, roomFrontCapLeftIndices, "./textures/murSalleEclairee_albedo.png"),
+    STATIC_SURFACE("RoomFrontCapRight", roomFrontCapRightVertices, roomFrontCapRightIndices, "./textures/murSalleEclairee_albedo.png"),
+    STATIC_SURFACE("Room2BackCapLeft", room2BackCapLeftVertices, room2BackCapLeftIndices, "./textures/murSalleSombre_albedo.png"),
+    STATIC_SURFACE("Room2BackCapRight", room2BackCapRightVertices, room2BackCapRightIndices, "./textures/murSalleSombre_albedo.png"),
+};
+const size_t staticSurfaceCount = sizeof(staticSurfaces) / sizeof(StaticSurface);
+
+// Plafonniers, au centre du plafond de chaque salle (dessinés par main.cpp) : une lampe blanc chaud
+// franche pour la salle principale, une veilleuse bleutée pour que la salle rectangulaire reste sombre
+StaticLight staticLights[] = {
+    StaticLight{glm::vec3(0.0f, 0.85f, 0.0f), glm::vec3(0.9f, 0.85f, 0.75f)},
+    StaticLight{glm::vec3(0.0f, 0.85f, 8.0f), glm::vec3(0.15f, 0.15f, 0.2f)},
+};
+const size_t staticLightCount = sizeof(staticLights) / sizeof(StaticLight);
+
+// Salle principale, couloir et salle rectangulaire
+StaticRoom staticRooms[] = {
+    StaticRoom{"MainRoom", glm::vec3(-3.5f, -1.0f, -3.5f), glm::vec3(3.5f, 1.0f, 3.5f)},
+    StaticRoom{"Corridor", glm::vec3(-0.5f, -1.0f, 3.5f), glm::vec3(0.5f, 1.0f, 6.0f)},
+    StaticRoom{"Room2", glm::vec3(-3.0f, -1.0f, 6.0f), glm::vec3(3.0f, 1.0f, 10.0f)},
+};
+const size_t staticRoomCount = sizeof(staticRooms) / sizeof(StaticRoom);
+
+// Portes entre les bouchons gauche et droit : salle principale <-> couloir <-> salle rectangulaire
+StaticPortal staticPortals[] = {
+    StaticPortal{"FrontDoor", 0, 1, {glm::vec3(-0.5f, -1.0f, 3.5f), glm::vec3(0.5f, -1.0f, 3.5f), glm::vec3(0.5f, 1.0f, 3.5f), glm::vec3(-0.5f, 1.0f, 3.5f)}},
+    StaticPortal{"BackDoor", 1, 2, {glm::vec3(-0.5f, -1.0f, 6.0f), glm::vec3(0.5f, -1.0f, 6.0f), glm::vec3(0.5f, 1.0f, 6.0f), glm::vec3(-0.5f, 1.0f, 6.0f)}},
+};
+const size_t staticPortalCount = sizeof(staticPortals) / sizeof(StaticPortal);
@@ -0,0 +1,35 @@
+#include "eventBus.h"
+
+#include <cstdlib>
+#include <iostream>
+
+int EventBus::registerEventType()
+{
+    static int count = 0;
+    if (count == MAX_EVENT_TYPES)
+    {
+        std::cerr << "Error: more than " << MAX_EVENT_TYPES << " event types" << std::endl;
+        std::abort();
+    }
+    return count++;
+}
+
+EventBus::Consumer& EventBus::consumer()
+{
+    consumers_.push_back(std::unique_ptr<Consumer>(new Consumer(*this)));
+    return *consumers_.back();
+}
+
+int EventBus::Consumer::dispatch(int maxEvents)
+{
+    int handled = 0;
+    for (auto& queue : queues_)
+    {
+        if (handled >= maxEvents)
+        {
+            break;
+        }
+        handled += queue->drain(maxEvents - handled);
+    }
+    return handled;
+}
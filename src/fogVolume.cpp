@@ -0,0 +1,195 @@
+#include "fogVolume.h"
+
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+static GLuint createVolume(const glm::ivec3& size)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size.x, size.y, size.z, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return texture;
+}
+
+static GLuint createSlice(const glm::ivec3& size)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// Low discrepancy sequence for the per frame jitter
+static float halton(int index, int base)
+{
+    float result = 0.0f, fraction = 1.0f / base;
+    for (; index > 0; index /= base, fraction /= base)
+    {
+        result += fraction * (index % base);
+    }
+    return result;
+}
+
+FogVolume::FogVolume(int width, int height, int depth, float nearDistance, float farDistance)
+    : size_(width, height, depth), depthRange_(nearDistance, farDistance),
+      injectShader_("./shaders/fog.vert", "./shaders/fogInject.frag"),
+      integrateShader_("./shaders/fog.vert", "./shaders/fogIntegrate.frag")
+{
+    scattering_[0] = createVolume(size_);
+    scattering_[1] = createVolume(size_);
+    integrated_ = createVolume(size_);
+    carry_[0] = createSlice(size_);
+    carry_[1] = createSlice(size_);
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, integrated_, 0, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, carry_[0], 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Error: fog framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // The fullscreen triangle comes from gl_VertexID, but the core profile still wants a VAO bound
+    glGenVertexArrays(1, &vao_);
+}
+
+void FogVolume::render(const Camera& camera, const glm::vec3& lightPos, const glm::vec4& lightColor,
+                       ShadowSystem& shadows, GLuint shadowUnit)
+{
+    if (density <= 0.0f)
+    {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, size_.x, size_.y);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glBindVertexArray(vao_);
+
+    GLuint current = scattering_[frame_ & 1];
+    GLuint history = scattering_[(frame_ + 1) & 1];
+    int sample = frame_ % 16 + 1;
+    glm::vec3 jitter(halton(sample, 2), halton(sample, 3), halton(sample, 5));
+
+    // Injection: one pass per slice, writing the slice's layer
+    shadows.apply(injectShader_, shadowUnit);
+    GLuint program = injectShader_.ID;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, history);
+    glUniform1i(glGetUniformLocation(program, "history"), 0);
+    glUniform1i(glGetUniformLocation(program, "hasHistory"), hasHistory_);
+    glUniform1f(glGetUniformLocation(program, "historyWeight"), historyWeight);
+    glUniformMatrix4fv(glGetUniformLocation(program, "prevViewProjection"), 1, GL_FALSE, glm::value_ptr(prevViewProjection_));
+    glUniform3f(glGetUniformLocation(program, "volumeSize"), (float)size_.x, (float)size_.y, (float)size_.z);
+    glUniform3fv(glGetUniformLocation(program, "jitter"), 1, glm::value_ptr(jitter));
+    glUniform2fv(glGetUniformLocation(program, "depthRange"), 1, glm::value_ptr(depthRange_));
+    glm::mat4 inverseView = glm::inverse(camera.view);
+    glUniformMatrix4fv(glGetUniformLocation(program, "inverseView"), 1, GL_FALSE, glm::value_ptr(inverseView));
+    glUniform2f(glGetUniformLocation(program, "projScale"), 1.0f / camera.projection[0][0], 1.0f / camera.projection[1][1]);
+    glUniform3fv(glGetUniformLocation(program, "camPos"), 1, glm::value_ptr(camera.Position));
+    glUniform3fv(glGetUniformLocation(program, "fogBoxMin"), 1, glm::value_ptr(boxMin));
+    glUniform3fv(glGetUniformLocation(program, "fogBoxMax"), 1, glm::value_ptr(boxMax));
+    glUniform1f(glGetUniformLocation(program, "fogDensity"), density);
+    glUniform1f(glGetUniformLocation(program, "fogEdge"), edge);
+    glUniform3fv(glGetUniformLocation(program, "fogAlbedo"), 1, glm::value_ptr(albedo));
+    glUniform3fv(glGetUniformLocation(program, "fogAmbient"), 1, glm::value_ptr(ambient));
+    glUniform1f(glGetUniformLocation(program, "fogAnisotropy"), anisotropy);
+    glUniform3fv(glGetUniformLocation(program, "lightPos"), 1, glm::value_ptr(lightPos));
+    glUniform4fv(glGetUniformLocation(program, "lightColor"), 1, glm::value_ptr(lightColor));
+
+    GLint sliceLocation = glGetUniformLocation(program, "slice");
+    GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(1, buffers);
+    for (int slice = 0; slice < size_.z; slice++)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, current, 0, slice);
+        glUniform1i(sliceLocation, slice);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // Integration: each slice adds itself to the running total of the one in front of it
+    integrateShader_.Activate();
+    program = integrateShader_.ID;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, current);
+    glUniform1i(glGetUniformLocation(program, "scattering"), 0);
+    glUniform1i(glGetUniformLocation(program, "previous"), 1);
+    glUniform3f(glGetUniformLocation(program, "volumeSize"), (float)size_.x, (float)size_.y, (float)size_.z);
+    glUniform2fv(glGetUniformLocation(program, "depthRange"), 1, glm::value_ptr(depthRange_));
+
+    sliceLocation = glGetUniformLocation(program, "slice");
+    glDrawBuffers(2, buffers);
+    glActiveTexture(GL_TEXTURE1);
+    for (int slice = 0; slice < size_.z; slice++)
+    {
+        glBindTexture(GL_TEXTURE_2D, carry_[(slice + 1) & 1]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, integrated_, 0, slice);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, carry_[slice & 1], 0);
+        glUniform1i(sliceLocation, slice);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    view_ = camera.view;
+    screenSize_ = glm::vec2((float)camera.width, (float)camera.height);
+    prevViewProjection_ = camera.cameraMatrix;
+    hasHistory_ = true;
+    frame_++;
+}
+
+void FogVolume::apply(Shader& shader, GLuint unit)
+{
+    shader.Activate();
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, integrated_);
+    glUniform1i(glGetUniformLocation(shader.ID, "fogVolume"), unit);
+    glUniform1i(glGetUniformLocation(shader.ID, "fogEnabled"), density > 0.0f);
+    glUniform2fv(glGetUniformLocation(shader.ID, "fogDepthRange"), 1, glm::value_ptr(depthRange_));
+    glUniform2fv(glGetUniformLocation(shader.ID, "fogScreenSize"), 1, glm::value_ptr(screenSize_));
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "fogView"), 1, GL_FALSE, glm::value_ptr(view_));
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void FogVolume::disable(Shader& shader)
+{
+    shader.Activate();
+    glUniform1i(glGetUniformLocation(shader.ID, "fogEnabled"), 0);
+}
+
+void FogVolume::Delete()
+{
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteTextures(2, scattering_);
+    glDeleteTextures(1, &integrated_);
+    glDeleteTextures(2, carry_);
+    injectShader_.Delete();
+    integrateShader_.Delete();
+}
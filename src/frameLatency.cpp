@@ -0,0 +1,95 @@
+#include "frameLatency.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <GLFW/glfw3.h>
+
+static const int slotCount = FrameLatency::MAX_QUEUED_FRAMES + 1;
+
+static uint64_t pack(const glm::vec2& v)
+{
+    return (uint64_t)std::bit_cast<uint32_t>(v.x) | (uint64_t)std::bit_cast<uint32_t>(v.y) << 32;
+}
+
+static glm::vec2 unpack(uint64_t word)
+{
+    return glm::vec2(std::bit_cast<float>((uint32_t)word), std::bit_cast<float>((uint32_t)(word >> 32)));
+}
+
+void FrameLatency::addLook(const glm::vec2& delta, double time)
+{
+    // The main thread is the only writer, the sum can't be raced
+    look_.store(pack(unpack(look_.load(std::memory_order_relaxed)) + delta), std::memory_order_release);
+    lookTime_.store(time, std::memory_order_release);
+}
+
+glm::vec2 FrameLatency::look() const
+{
+    return unpack(look_.load(std::memory_order_acquire));
+}
+
+glm::vec2 FrameLatency::beginFrame()
+{
+    while (count_ > 0 && retire(pending_[first_], false))
+    {
+        first_ = (first_ + 1) % slotCount;
+        count_--;
+    }
+    int allowed = std::clamp(maxQueuedFrames, 0, MAX_QUEUED_FRAMES);
+    while (count_ > allowed)
+    {
+        retire(pending_[first_], true);
+        first_ = (first_ + 1) % slotCount;
+        count_--;
+    }
+
+    // As late as possible, right before the frame is drawn
+    latchedTime_ = lookTime_.load(std::memory_order_acquire);
+    return look();
+}
+
+void FrameLatency::endFrame()
+{
+    Pending& frame = pending_[(first_ + count_) % slotCount];
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Frames showing no new input have nothing to measure
+    frame.inputTime = latchedTime_ > measuredTime_ ? latchedTime_ : -1.0;
+    measuredTime_ = std::max(measuredTime_, latchedTime_);
+    count_++;
+}
+
+bool FrameLatency::retire(Pending& frame, bool wait)
+{
+    GLenum status = glClientWaitSync(frame.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+    if (status == GL_TIMEOUT_EXPIRED && !wait)
+    {
+        return false;
+    }
+    if (status == GL_WAIT_FAILED)
+    {
+        std::cerr << "Error: waiting for a frame fence failed" << std::endl;
+    }
+
+    if (frame.inputTime >= 0.0)
+    {
+        float ms = (float)((glfwGetTime() - frame.inputTime) * 1000.0);
+        latencyMs = latencyMs > 0.0f ? latencyMs + (ms - latencyMs) * 0.1f : ms;
+    }
+    glDeleteSync(frame.fence);
+    frame.fence = 0;
+    return true;
+}
+
+void FrameLatency::Delete()
+{
+    for (Pending& frame : pending_)
+    {
+        if (frame.fence)
+        {
+            glDeleteSync(frame.fence);
+            frame.fence = 0;
+        }
+    }
+    count_ = 0;
+}
@@ -0,0 +1,103 @@
+#include "frameLimiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+// Sleep statistics weigh samples evenly up to this count, then forget the older ones so they
+// follow the system's load
+static const long long sleepHistory = 1000;
+
+void FrameLimiter::apply()
+{
+    glfwSwapInterval(mode == Mode::VSync ? 1 : 0);
+    started_ = false;
+    presented_ = false;
+}
+
+void FrameLimiter::wait()
+{
+    if (mode != Mode::Capped || targetFps <= 0.0f)
+    {
+        started_ = false;
+        return;
+    }
+
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+    Clock::time_point now = Clock::now();
+    // Frames late by more than a period don't make the next ones hurry to catch up
+    if (!started_ || now - deadline_ > period)
+    {
+        deadline_ = now;
+        started_ = true;
+        return;
+    }
+
+    deadline_ += period;
+    sleepUntil(deadline_);
+}
+
+void FrameLimiter::presented()
+{
+    Clock::time_point now = Clock::now();
+    // The first interval after a mode change belongs to the mode before
+    if (!presented_)
+    {
+        lastPresent_ = now;
+        windowStart_ = now;
+        averageInterval_ = 0.0;
+        presented_ = true;
+        return;
+    }
+
+    double interval = std::chrono::duration<double>(now - lastPresent_).count();
+    lastPresent_ = now;
+    averageInterval_ = averageInterval_ > 0.0 ? averageInterval_ + (interval - averageInterval_) * 0.05 : interval;
+    double period = averageInterval_;
+    if (mode == Mode::Capped && targetFps > 0.0f)
+    {
+        period = 1.0 / targetFps;
+    }
+    else if (mode == Mode::VSync && refreshRate > 0.0f)
+    {
+        period = 1.0 / refreshRate;
+    }
+
+    float errorUs = (float)(std::abs(interval - period) * 1e6);
+    pacingErrorUs += (errorUs - pacingErrorUs) * 0.05f;
+    windowWorst_ = std::max(windowWorst_, errorUs);
+    if (now - windowStart_ >= std::chrono::seconds(1))
+    {
+        worstErrorUs = windowWorst_;
+        windowWorst_ = 0.0f;
+        windowStart_ = now;
+    }
+}
+
+void FrameLimiter::sleepUntil(Clock::time_point deadline)
+{
+    // Sleeps of a millisecond while there is more left than they may take
+    for (;;)
+    {
+        double remaining = std::chrono::duration<double>(deadline - Clock::now()).count();
+        double estimate = sleepMean_ + std::sqrt(sleepVariance_);
+        if (remaining <= estimate)
+        {
+            break;
+        }
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double observed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        sleepCount_ = std::min(sleepCount_ + 1, sleepHistory);
+        double weight = 1.0 / sleepCount_;
+        double delta = observed - sleepMean_;
+        sleepMean_ += weight * delta;
+        sleepVariance_ = (1.0 - weight) * (sleepVariance_ + weight * delta * delta);
+    }
+    // Spun the rest of the way
+    while (Clock::now() < deadline)
+    {
+    }
+}
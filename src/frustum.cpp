@@ -0,0 +1,80 @@
+#include "frustum.h"
+
+#include <cmath>
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // Gribb-Hartmann: each plane is the last row plus or minus one of the others
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    glm::vec4 planes[8] = {row[3] + row[0], row[3] - row[0], row[3] + row[1], row[3] - row[1],
+                           row[3] + row[2], row[3] - row[2], glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+                           glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)};
+
+    float nx[8], ny[8], nz[8], ax[8], ay[8], az[8], d[8];
+    for (int i = 0; i < 8; i++)
+    {
+        // Normalized so the sphere test can compare against the radius
+        glm::vec4 plane = planes[i] / glm::max(glm::length(glm::vec3(planes[i])), 1e-6f);
+        nx[i] = plane.x;
+        ny[i] = plane.y;
+        nz[i] = plane.z;
+        ax[i] = std::abs(plane.x);
+        ay[i] = std::abs(plane.y);
+        az[i] = std::abs(plane.z);
+        d[i] = plane.w;
+    }
+
+    for (int g = 0; g < 2; g++)
+    {
+        nx_[g] = Float4::load(nx + 4 * g);
+        ny_[g] = Float4::load(ny + 4 * g);
+        nz_[g] = Float4::load(nz + 4 * g);
+        ax_[g] = Float4::load(ax + 4 * g);
+        ay_[g] = Float4::load(ay + 4 * g);
+        az_[g] = Float4::load(az + 4 * g);
+        d_[g] = Float4::load(d + 4 * g);
+    }
+}
+
+bool Frustum::visible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool* inside) const
+{
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+    Float4 cx(center.x), cy(center.y), cz(center.z);
+    Float4 ex(extent.x), ey(extent.y), ez(extent.z);
+    Float4 zero(0.0f);
+
+    int outside = 0, crossing = 0;
+    for (int g = 0; g < 2; g++)
+    {
+        // Signed distance of the center and how far the box reaches along the normal
+        Float4 distance = cx * nx_[g] + cy * ny_[g] + cz * nz_[g] + d_[g];
+        Float4 reach = ex * ax_[g] + ey * ay_[g] + ez * az_[g];
+        outside |= movemask(distance + reach < zero);
+        crossing |= movemask(distance - reach < zero);
+    }
+
+    if (inside)
+    {
+        *inside = crossing == 0;
+    }
+    return outside == 0;
+}
+
+bool Frustum::visible(const glm::vec3& center, float radius) const
+{
+    Float4 cx(center.x), cy(center.y), cz(center.z);
+    Float4 r(-radius);
+
+    int outside = 0;
+    for (int g = 0; g < 2; g++)
+    {
+        outside |= movemask(cx * nx_[g] + cy * ny_[g] + cz * nz_[g] + d_[g] < r);
+    }
+    return outside == 0;
+}
@@ -0,0 +1,254 @@
+#include "gameSystems.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+SystemScheduler::System lightAnimationSystem(World& world)
+{
+    int lights = world.query(World::mask<PointLight, LightPath>());
+    SystemScheduler::System system;
+    system.name = "light animation";
+    system.writes = World::mask<PointLight, LightPath>();
+    system.run = [lights](World& world, float dt) {
+        world.each<PointLight, LightPath>(lights, [dt](Entity, PointLight& light, LightPath& path) {
+            path.time += dt;
+            light.position = path.center + path.amplitude * std::cos(path.time * path.frequency);
+        });
+    };
+    return system;
+}
+
+SystemScheduler::System patrolSystem(World& world)
+{
+    int walkers = world.query(World::mask<Transform, Patrol, Locomotion>());
+    SystemScheduler::System system;
+    system.name = "patrol";
+    system.writes = World::mask<Transform, Patrol, Locomotion>();
+    system.run = [walkers](World& world, float dt) {
+        world.each<Transform, Patrol, Locomotion>(walkers, [dt](Entity, Transform& transform, Patrol& patrol, Locomotion& locomotion) {
+            transform.position.x += patrol.direction * patrol.speed * dt;
+            if (std::abs(transform.position.x - patrol.center.x) > patrol.extent)
+            {
+                transform.position.x = glm::clamp(transform.position.x, patrol.center.x - patrol.extent, patrol.center.x + patrol.extent);
+                patrol.direction = -patrol.direction;
+            }
+            transform.yaw = glm::radians(90.0f) * patrol.direction;
+            locomotion.speed = patrol.speed;
+        });
+    };
+    return system;
+}
+
+SystemScheduler::System cameraLookSystem(World& world, const GameInput& input)
+{
+    int cameras = world.query(World::mask<OrbitCamera>());
+    SystemScheduler::System system;
+    system.name = "camera look";
+    system.writes = World::mask<OrbitCamera>();
+    system.run = [cameras, &input](World& world, float) {
+        world.each<OrbitCamera>(cameras, [&input](Entity, OrbitCamera& orbit) {
+            orbit.yaw -= input.look.x * orbit.sensitivity;
+            orbit.pitch = glm::clamp(orbit.pitch - input.look.y * orbit.sensitivity, orbit.minPitch, orbit.maxPitch);
+        });
+    };
+    return system;
+}
+
+SystemScheduler::System playerMovementSystem(World& world, const GameInput& input, Walkable walkable)
+{
+    int players = world.query(World::mask<Transform, PlayerControl, Locomotion>());
+    SystemScheduler::System system;
+    system.name = "player movement";
+    system.reads = World::mask<OrbitCamera>();
+    system.writes = World::mask<Transform, PlayerControl, Locomotion>();
+    system.run = [players, &input, walkable](World& world, float dt) {
+        world.each<Transform, PlayerControl, Locomotion>(players, [&](Entity, Transform& transform, PlayerControl& control, Locomotion& locomotion) {
+            glm::vec3 previousPosition = transform.position;
+            const OrbitCamera* orbit = world.get<OrbitCamera>(control.camera);
+            if (glm::length(input.move) > 0.0f && orbit)
+            {
+                glm::vec2 move = glm::normalize(input.move);
+                float cameraYaw = glm::radians(orbit->yaw);
+                glm::vec3 forward = glm::vec3(sin(cameraYaw), 0.0f, cos(cameraYaw));
+                glm::vec3 right = glm::vec3(forward.z, 0.0f, forward.x);
+                glm::vec3 moveDirection = forward * move.y + right * move.x;
+
+                if (glm::length(moveDirection) > 0.0f)
+                {
+                    transform.yaw = atan2(moveDirection.x, moveDirection.z);
+                    float step = input.run ? control.runStep : control.walkStep;
+                    glm::vec3 newPotentialPos = transform.position + glm::normalize(moveDirection) * step;
+                    if (walkable(newPotentialPos))
+                    {
+                        transform.position = newPotentialPos;
+                    }
+                }
+            }
+
+            // Smoothed so the blend doesn't pop when a key is pressed or released
+            float measuredSpeed = dt > 0.0f ? glm::length(transform.position - previousPosition) / dt : 0.0f;
+            locomotion.speed += (measuredSpeed - locomotion.speed) * std::min(1.0f, dt * 10.0f);
+        });
+    };
+    return system;
+}
+
+SystemScheduler::System cameraFollowSystem(World& world, Walkable walkable)
+{
+    int cameras = world.query(World::mask<OrbitCamera>());
+    SystemScheduler::System system;
+    system.name = "camera follow";
+    system.reads = World::mask<Transform>();
+    system.writes = World::mask<OrbitCamera>();
+    system.run = [cameras, walkable](World& world, float) {
+        world.each<OrbitCamera>(cameras, [&](Entity, OrbitCamera& orbit) {
+            const Transform* target = world.get<Transform>(orbit.target);
+            if (!target)
+            {
+                return;
+            }
+            orbit.lookAt = target->position + glm::vec3(0.0f, 0.8f, 0.0f);
+            float currentDistance = orbit.distance;
+            while (currentDistance > 0.5f)
+            {
+                float horizontalDist = currentDistance * cos(glm::radians(orbit.pitch));
+                float verticalDist = currentDistance * sin(glm::radians(orbit.pitch));
+                float offsetX = horizontalDist * sin(glm::radians(orbit.yaw));
+                float offsetZ = horizontalDist * cos(glm::radians(orbit.yaw));
+
+                orbit.eye = glm::vec3(target->position.x - offsetX, target->position.y + verticalDist + 1.0f,
+                                      target->position.z - offsetZ);
+                if (walkable(orbit.eye))
+                {
+                    break;
+                }
+                currentDistance -= 0.1f;
+            }
+        });
+    };
+    return system;
+}
+
+SystemScheduler::System renderExtractionSystem(World& world, Entity view, RenderSnapshot& snapshot)
+{
+    int meshes = world.query(World::mask<Transform, Renderable>());
+    int lights = world.query(World::mask<PointLight>());
+    int lightNodes = world.query(World::mask<PointLight, Renderable>());
+    int characters = world.query(World::mask<Transform, Locomotion>());
+    SystemScheduler::System system;
+    system.name = "render extraction";
+    system.reads = World::mask<Transform, Renderable, PointLight, Locomotion, OrbitCamera>();
+    system.run = [=, &snapshot](World& world, float) {
+        // Cleared rather than rebuilt, the snapshot keeps its memory from one tick to the next
+        snapshot.nodes.clear();
+        snapshot.characters.clear();
+        snapshot.lights.clear();
+
+        world.each<Transform, Renderable>(meshes, [&snapshot](Entity, Transform& transform, Renderable& renderable) {
+            snapshot.nodes.push_back({renderable.node, transform.position, transform.yaw, transform.scale});
+        });
+        world.each<PointLight>(lights, [&snapshot](Entity, PointLight& light) { snapshot.lights.push_back(light.position); });
+        world.each<PointLight, Renderable>(lightNodes, [&snapshot](Entity, PointLight& light, Renderable& renderable) {
+            snapshot.nodes.push_back({renderable.node, light.position, 0.0f, 1.0f});
+        });
+        world.each<Transform, Locomotion>(characters, [&snapshot](Entity, Transform& transform, Locomotion& locomotion) {
+            if (locomotion.character >= 0)
+            {
+                snapshot.characters.push_back({locomotion.character, locomotion.speed, transform.position + glm::vec3(0.0f, 0.6f, 0.0f)});
+            }
+        });
+        if (const OrbitCamera* orbit = world.get<OrbitCamera>(view))
+        {
+            snapshot.eye = orbit->eye;
+            snapshot.lookAt = orbit->lookAt;
+            snapshot.sensitivity = orbit->sensitivity;
+            snapshot.pitch = orbit->pitch;
+            snapshot.minPitch = orbit->minPitch;
+            snapshot.maxPitch = orbit->maxPitch;
+        }
+    };
+    return system;
+}
+
+void applyRenderSnapshot(const RenderSnapshot& snapshot, Camera& camera, AnimationSystem& animations, float FOVdeg,
+                         float nearPlane, float farPlane, const glm::vec2& lateLook)
+{
+    for (const RenderSnapshot::NodeTransform& node : snapshot.nodes)
+    {
+        if (Node* target = node.node.get())
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), node.position);
+            model = glm::rotate(model, node.yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+            target->setTransform(glm::scale(model, glm::vec3(node.scale)));
+        }
+    }
+    for (const RenderSnapshot::CharacterInput& character : snapshot.characters)
+    {
+        animations.character(character.character).speed = character.speed;
+        animations.character(character.character).position = character.position;
+    }
+    // Same turn as cameraLookSystem's, around the point looked at. Too small to need the wall test.
+    glm::vec3 offset = snapshot.eye - snapshot.lookAt;
+    float distance = glm::length(offset);
+    if (lateLook != glm::vec2(0.0f) && distance > 0.0f)
+    {
+        float yaw = std::atan2(offset.x, offset.z) - glm::radians(lateLook.x * snapshot.sensitivity);
+        // Clamped the way the orbit's pitch will be, then applied to the view's own elevation
+        float pitchTurn = glm::clamp(snapshot.pitch - lateLook.y * snapshot.sensitivity, snapshot.minPitch, snapshot.maxPitch) - snapshot.pitch;
+        float pitch = std::asin(glm::clamp(offset.y / distance, -1.0f, 1.0f)) + glm::radians(pitchTurn);
+        offset = distance * glm::vec3(std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw));
+    }
+    camera.Position = snapshot.lookAt + offset;
+    camera.updateMatrix(FOVdeg, nearPlane, farPlane, snapshot.lookAt);
+}
+
+void RenderSnapshot::interpolate(const RenderSnapshot& from, const RenderSnapshot& to, float alpha, RenderSnapshot& result)
+{
+    result.nodes.assign(to.nodes.begin(), to.nodes.end());
+    for (size_t i = 0; i < result.nodes.size() && i < from.nodes.size(); i++)
+    {
+        NodeTransform& node = result.nodes[i];
+        const NodeTransform& start = from.nodes[i];
+        if (start.node != node.node)
+        {
+            continue;
+        }
+        node.position = glm::mix(start.position, node.position, alpha);
+        // The shorter way around, yaw wraps at +-pi
+        float turn = std::remainder(node.yaw - start.yaw, glm::two_pi<float>());
+        node.yaw = start.yaw + turn * alpha;
+        node.scale = glm::mix(start.scale, node.scale, alpha);
+    }
+
+    result.characters.assign(to.characters.begin(), to.characters.end());
+    for (size_t i = 0; i < result.characters.size() && i < from.characters.size(); i++)
+    {
+        CharacterInput& character = result.characters[i];
+        const CharacterInput& start = from.characters[i];
+        if (start.character == character.character)
+        {
+            character.speed = glm::mix(start.speed, character.speed, alpha);
+            character.position = glm::mix(start.position, character.position, alpha);
+        }
+    }
+
+    result.lights.assign(to.lights.begin(), to.lights.end());
+    if (from.lights.size() == to.lights.size())
+    {
+        for (size_t i = 0; i < result.lights.size(); i++)
+        {
+            result.lights[i] = glm::mix(from.lights[i], to.lights[i], alpha);
+        }
+    }
+
+    // The blended view has taken in the blend of the ticks' mouse movement
+    result.look = glm::mix(from.look, to.look, alpha);
+    result.sensitivity = to.sensitivity;
+    result.pitch = glm::mix(from.pitch, to.pitch, alpha);
+    result.minPitch = to.minPitch;
+    result.maxPitch = to.maxPitch;
+    result.eye = glm::mix(from.eye, to.eye, alpha);
+    result.lookAt = glm::mix(from.lookAt, to.lookAt, alpha);
+    result.time = glm::mix(from.time, to.time, (double)alpha);
+}
@@ -0,0 +1,219 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// Glyphs are laid out 16 per row, the cell after the last glyph is solid for rect()
+static const int atlasColumns = 16;
+static const int solidCell = HUD_GLYPH_COUNT;
+
+static uint32_t packColor(const glm::vec4& color)
+{
+    glm::uvec4 c = glm::uvec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return c.r | (c.g << 8) | (c.b << 16) | (c.a << 24);
+}
+
+Hud::Hud(int screenWidth, int screenHeight, int scale, int maxQuads)
+    : scale(scale), screenSize_((float)screenWidth, (float)screenHeight),
+      maxQuads_(std::min(maxQuads, 16384)), shader_("./shaders/hud.vert", "./shaders/hud.frag")
+{
+    // Font atlas, expanded from the 1 bit glyphs
+    int rows = (HUD_GLYPH_COUNT + 1 + atlasColumns - 1) / atlasColumns;
+    atlasSize_ = glm::ivec2(atlasColumns * HUD_GLYPH_WIDTH, rows * HUD_GLYPH_HEIGHT);
+    std::vector<unsigned char> pixels(atlasSize_.x * atlasSize_.y, 0);
+    for (int cell = 0; cell <= HUD_GLYPH_COUNT; cell++)
+    {
+        int x0 = (cell % atlasColumns) * HUD_GLYPH_WIDTH;
+        int y0 = (cell / atlasColumns) * HUD_GLYPH_HEIGHT;
+        for (int y = 0; y < HUD_GLYPH_HEIGHT; y++)
+        {
+            unsigned char bits = cell == solidCell ? 0xFF : hudGlyphs[cell][y];
+            for (int x = 0; x < HUD_GLYPH_WIDTH; x++)
+            {
+                pixels[(y0 + y) * atlasSize_.x + x0 + x] = (bits & (0x80 >> x)) ? 255 : 0;
+            }
+        }
+    }
+
+    glGenTextures(1, &atlas_);
+    glBindTexture(GL_TEXTURE_2D, atlas_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasSize_.x, atlasSize_.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Quads share a static index buffer, only the vertices are streamed
+    std::vector<GLushort> indices(maxQuads_ * 6);
+    for (int q = 0; q < maxQuads_; q++)
+    {
+        const GLushort corners[6] = {0, 1, 2, 0, 2, 3};
+        for (int k = 0; k < 6; k++)
+        {
+            indices[q * 6 + k] = (GLushort)(q * 4 + corners[k]);
+        }
+    }
+
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, maxQuads_ * 4 * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, uv));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)offsetof(HudVertex, color));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    vertices_.reserve(maxQuads_ * 4);
+}
+
+void Hud::quad(std::vector<HudVertex>& out, glm::vec2 min, glm::vec2 max, glm::vec2 uvMin, glm::vec2 uvMax,
+               uint32_t color) const
+{
+    out.push_back({min, uvMin, color});
+    out.push_back({glm::vec2(max.x, min.y), glm::vec2(uvMax.x, uvMin.y), color});
+    out.push_back({max, uvMax, color});
+    out.push_back({glm::vec2(min.x, max.y), glm::vec2(uvMin.x, uvMax.y), color});
+}
+
+void Hud::layout(std::vector<HudVertex>& out, float x, float y, const char* text, const glm::vec4& color) const
+{
+    uint32_t packed = packColor(color);
+    glm::vec2 glyphSize(HUD_GLYPH_WIDTH * scale, HUD_GLYPH_HEIGHT * scale);
+    glm::vec2 cellUV(HUD_GLYPH_WIDTH / (float)atlasSize_.x, HUD_GLYPH_HEIGHT / (float)atlasSize_.y);
+    glm::vec2 pen(x, y);
+
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '\n')
+        {
+            pen = glm::vec2(x, pen.y + glyphSize.y);
+            continue;
+        }
+
+        int glyph = (unsigned char)*c - HUD_GLYPH_FIRST;
+        if (glyph < 0 || glyph >= HUD_GLYPH_COUNT)
+        {
+            glyph = '?' - HUD_GLYPH_FIRST;
+        }
+        // Spaces only move the pen
+        if (glyph > 0)
+        {
+            glm::vec2 uv = glm::vec2(glyph % atlasColumns, glyph / atlasColumns) * cellUV;
+            quad(out, pen, pen + glyphSize, uv, uv + cellUV, packed);
+        }
+        pen.x += glyphSize.x;
+    }
+}
+
+void Hud::text(float x, float y, const char* text, const glm::vec4& color)
+{
+    layout(vertices_, x, y, text, color);
+}
+
+void Hud::rect(float x, float y, float width, float height, const glm::vec4& color)
+{
+    // Center of the solid cell, nearest filtering keeps it solid
+    glm::vec2 uv((solidCell % atlasColumns + 0.5f) * HUD_GLYPH_WIDTH / atlasSize_.x,
+                 (solidCell / atlasColumns + 0.5f) * HUD_GLYPH_HEIGHT / atlasSize_.y);
+    quad(vertices_, glm::vec2(x, y), glm::vec2(x + width, y + height), uv, uv, packColor(color));
+}
+
+int Hud::cache(const std::string& text, const glm::vec4& color)
+{
+    cache_.emplace_back();
+    layout(cache_.back(), 0.0f, 0.0f, text.c_str(), color);
+    return (int)cache_.size() - 1;
+}
+
+void Hud::cached(int id, float x, float y)
+{
+    for (HudVertex vertex : cache_[id])
+    {
+        vertex.position += glm::vec2(x, y);
+        vertices_.push_back(vertex);
+    }
+}
+
+glm::vec2 Hud::measure(const char* text) const
+{
+    int columns = 0, longest = 0, lines = 1;
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '\n')
+        {
+            lines++;
+            columns = 0;
+            continue;
+        }
+        longest = std::max(longest, ++columns);
+    }
+    return glm::vec2(longest * HUD_GLYPH_WIDTH * scale, lines * HUD_GLYPH_HEIGHT * scale);
+}
+
+void Hud::draw()
+{
+    int quads = (int)vertices_.size() / 4;
+    if (quads > maxQuads_)
+    {
+        std::cerr << "Error: too many HUD quads, only the first " << maxQuads_ << " are drawn" << std::endl;
+        quads = maxQuads_;
+    }
+    if (quads == 0)
+    {
+        vertices_.clear();
+        return;
+    }
+
+    // Orphan last frame's storage so the upload never waits for the GPU to finish with it
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, maxQuads_ * 4 * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quads * 4 * sizeof(HudVertex), vertices_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertices_.clear();
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader_.Activate();
+    glUniform2fv(glGetUniformLocation(shader_.ID, "screenSize"), 1, &screenSize_.x);
+    glUniform1i(glGetUniformLocation(shader_.ID, "atlas"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas_);
+
+    glBindVertexArray(vao_);
+    glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT, 0);
+    glBindVertexArray(0);
+
+    if (depthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+}
+
+void Hud::Delete()
+{
+    glDeleteTextures(1, &atlas_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ebo_);
+    glDeleteVertexArrays(1, &vao_);
+    shader_.Delete();
+}
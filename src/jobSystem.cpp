@@ -0,0 +1,329 @@
+#include "jobSystem.h"
+
+#include <iostream>
+
+// Index of the calling thread in the system it belongs to
+static thread_local int currentThread = -1;
+
+// Rounds a worker spins looking for jobs before sleeping
+static const int idleSpins = 64;
+
+bool JobSystem::Deque::push(Job* job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= QUEUE_SIZE)
+    {
+        return false;
+    }
+    buffer[b % QUEUE_SIZE].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+JobSystem::Job* JobSystem::Deque::pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = buffer[b % QUEUE_SIZE].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // The last job, a thief may be taking it at the same time
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job* JobSystem::Deque::steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return nullptr;
+    }
+    Job* job = buffer[t % QUEUE_SIZE].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem& JobSystem::shared(unsigned int threads)
+{
+    static JobSystem system(std::max(1u, threads ? threads : std::thread::hardware_concurrency()) - 1, 1);
+    return system;
+}
+
+JobSystem::JobSystem(unsigned int workers, unsigned int attachable)
+    : threadCount_(workers + 1 + attachable), firstAttachable_(workers + 1), threads_(new ThreadState[threadCount_]),
+      attached_(attachable, false)
+{
+    currentThread = 0;
+    for (unsigned int i = 0; i < threadCount_; i++)
+    {
+        threads_[i].random = 0x9e3779b9u * (i + 1);
+    }
+    for (unsigned int i = 1; i < firstAttachable_; i++)
+    {
+        workers_.emplace_back(&JobSystem::workerLoop, this, (int)i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+    currentThread = -1;
+}
+
+int JobSystem::threadIndex()
+{
+    return currentThread;
+}
+
+bool JobSystem::attachThread()
+{
+    if (currentThread >= 0)
+    {
+        std::cerr << "Error: attaching a thread already running jobs" << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(attachMutex_);
+    for (size_t i = 0; i < attached_.size(); i++)
+    {
+        if (!attached_[i])
+        {
+            attached_[i] = true;
+            currentThread = (int)(firstAttachable_ + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::detachThread()
+{
+    if (currentThread < (int)firstAttachable_)
+    {
+        return;
+    }
+    if (glThread_.load() == currentThread)
+    {
+        runGLJobs();
+        glThread_ = 0;
+    }
+    std::lock_guard<std::mutex> lock(attachMutex_);
+    attached_[currentThread - firstAttachable_] = false;
+    currentThread = -1;
+}
+
+void JobSystem::setGLThread()
+{
+    if (currentThread < 0)
+    {
+        std::cerr << "Error: the GL thread must be attached to the job system" << std::endl;
+        return;
+    }
+    glThread_ = currentThread;
+}
+
+JobSystem::Job* JobSystem::claim(int thread)
+{
+    ThreadState& state = threads_[thread];
+    for (;;)
+    {
+        // Skips the slots still in flight rather than waiting for one, it may belong to a job
+        // further up this very thread's stack. Re-read every round, the jobs helped with may
+        // allocate from this ring too.
+        for (int i = 0; i < QUEUE_SIZE; i++)
+        {
+            Job* job = &state.jobs[state.nextJob++ % QUEUE_SIZE];
+            if (!job->busy.load(std::memory_order_acquire))
+            {
+                job->busy.store(true, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        if (!help(thread))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::enqueue(int thread, Job* job)
+{
+    if (!threads_[thread].deque.push(job))
+    {
+        execute(job);
+        return;
+    }
+    queued_.fetch_add(1);
+    if (sleeping_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wake_.notify_one();
+    }
+}
+
+void JobSystem::execute(Job* job)
+{
+    Counter* counter = job->counter;
+    job->function(*job);
+    job->busy.store(false, std::memory_order_release);
+    finish(counter);
+}
+
+void JobSystem::finish(Counter* counter)
+{
+    if (!counter)
+    {
+        return;
+    }
+    counter->finishing_.fetch_add(1);
+    std::vector<Job*> released;
+    if (counter->pending_.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex_);
+        released.swap(counter->dependents_);
+    }
+    counter->finishing_.fetch_sub(1);
+
+    // Outside the lock, a job run right away may depend on the counter again. Only the calling
+    // thread pushes to its own deque.
+    for (Job* job : released)
+    {
+        if (currentThread < 0)
+        {
+            execute(job);
+        }
+        else
+        {
+            enqueue(currentThread, job);
+        }
+    }
+}
+
+JobSystem::Job* JobSystem::take(int thread)
+{
+    Job* job = threads_[thread].deque.pop();
+    if (!job)
+    {
+        // Victims in a random order so thieves don't all pile on the same thread
+        uint32_t& random = threads_[thread].random;
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        for (unsigned int k = 0; k < threadCount_ && !job; k++)
+        {
+            unsigned int victim = (random + k) % threadCount_;
+            if ((int)victim != thread)
+            {
+                job = threads_[victim].deque.steal();
+            }
+        }
+    }
+    if (job)
+    {
+        queued_.fetch_sub(1);
+    }
+    return job;
+}
+
+void JobSystem::workerLoop(int thread)
+{
+    currentThread = thread;
+    int idle = 0;
+    while (!stop_.load())
+    {
+        if (Job* job = take(thread))
+        {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < idleSpins)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleeping_.fetch_add(1);
+        wake_.wait(lock, [this]() { return queued_.load() > 0 || stop_.load(); });
+        sleeping_.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::wait(Counter& counter)
+{
+    int thread = currentThread;
+    while (!counter.done())
+    {
+        if (thread < 0 || !help(thread))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::help(int thread)
+{
+    if (thread == glThread_.load(std::memory_order_relaxed))
+    {
+        runGLJobs();
+    }
+    Job* job = take(thread);
+    if (!job)
+    {
+        return false;
+    }
+    execute(job);
+    return true;
+}
+
+void JobSystem::runGLJobs()
+{
+    if (currentThread != glThread_.load())
+    {
+        return;
+    }
+    // Jobs queued by the ones running are left for the next call
+    std::vector<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(glMutex_);
+        if (glJobs_.empty())
+        {
+            return;
+        }
+        jobs.swap(glJobs_);
+    }
+    for (Job* job : jobs)
+    {
+        execute(job);
+    }
+}
@@ -0,0 +1,257 @@
+#include "lightmap.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char lightmapMagic[4] = {'M', 'C', 'L', 'M'};
+static const uint32_t lightmapVersion = 1;
+
+namespace
+{
+    struct Chart
+    {
+        size_t surface;
+        std::vector<unsigned int> vertices;
+        std::vector<glm::vec2> coords;
+        glm::ivec2 size;
+        glm::ivec2 offset = glm::ivec2(0);
+    };
+}
+
+void Lightmap::unwrap(const StaticSurface* staticSurfaces, size_t count, float texelsPerUnit, int atlasWidth, int padding)
+{
+    surfaces.clear();
+    std::vector<Chart> charts;
+
+    for (size_t s = 0; s < count; s++)
+    {
+        const StaticSurface& surface = staticSurfaces[s];
+        surfaces.push_back(Surface{surface.name, std::vector<glm::vec2>(surface.vertexCount, glm::vec2(-1.0f))});
+
+        // Face normals, degenerate triangles (unused vertex slots) get no chart
+        size_t triangleCount = surface.indexCount / 3;
+        std::vector<glm::vec3> normals(triangleCount);
+        std::vector<bool> assigned(triangleCount, false);
+        std::vector<std::vector<size_t>> vertexTriangles(surface.vertexCount);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3& a = surface.vertices[surface.indices[t * 3]].position;
+            const glm::vec3& b = surface.vertices[surface.indices[t * 3 + 1]].position;
+            const glm::vec3& c = surface.vertices[surface.indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            if (area < 1e-8f)
+            {
+                assigned[t] = true;
+                continue;
+            }
+            normals[t] = normal / area;
+            for (int k = 0; k < 3; k++)
+            {
+                vertexTriangles[surface.indices[t * 3 + k]].push_back(t);
+            }
+        }
+
+        // Flood fill coplanar triangles that share vertices into a chart
+        for (size_t seed = 0; seed < triangleCount; seed++)
+        {
+            if (assigned[seed])
+            {
+                continue;
+            }
+
+            Chart chart;
+            chart.surface = s;
+            glm::vec3 normal = normals[seed];
+            std::vector<size_t> open = {seed};
+            std::vector<bool> inChart(surface.vertexCount, false);
+            assigned[seed] = true;
+            while (!open.empty())
+            {
+                size_t t = open.back();
+                open.pop_back();
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int vertex = surface.indices[t * 3 + k];
+                    if (!inChart[vertex])
+                    {
+                        inChart[vertex] = true;
+                        chart.vertices.push_back(vertex);
+                    }
+                    for (size_t neighbour : vertexTriangles[vertex])
+                    {
+                        if (!assigned[neighbour] && glm::dot(normals[neighbour], normal) > 0.999f)
+                        {
+                            assigned[neighbour] = true;
+                            open.push_back(neighbour);
+                        }
+                    }
+                }
+            }
+
+            // Planar projection, one texel per 1/texelsPerUnit world units
+            glm::vec3 reference = std::abs(normal.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 tangent = glm::normalize(glm::cross(reference, normal));
+            glm::vec3 bitangent = glm::cross(normal, tangent);
+            glm::vec2 coordMin(FLT_MAX), coordMax(-FLT_MAX);
+            for (unsigned int vertex : chart.vertices)
+            {
+                const glm::vec3& p = surface.vertices[vertex].position;
+                glm::vec2 coord = glm::vec2(glm::dot(p, tangent), glm::dot(p, bitangent)) * texelsPerUnit;
+                chart.coords.push_back(coord);
+                coordMin = glm::min(coordMin, coord);
+                coordMax = glm::max(coordMax, coord);
+            }
+            for (auto& coord : chart.coords)
+            {
+                coord -= coordMin;
+            }
+            chart.size = glm::ivec2(glm::ceil(coordMax - coordMin)) + 1;
+            charts.push_back(chart);
+        }
+    }
+
+    // Shelf packing, tallest charts first
+    std::vector<Chart*> order;
+    for (auto& chart : charts)
+    {
+        order.push_back(&chart);
+    }
+    std::sort(order.begin(), order.end(), [](const Chart* a, const Chart* b) { return a->size.y > b->size.y; });
+
+    int x = padding, y = padding, shelfHeight = 0;
+    for (Chart* chart : order)
+    {
+        if (chart->size.x + 2 * padding > atlasWidth)
+        {
+            std::cerr << "Error: lightmap chart wider than the atlas, lower the texel density" << std::endl;
+            chart->size.x = atlasWidth - 2 * padding;
+        }
+        if (x + chart->size.x + padding > atlasWidth)
+        {
+            x = padding;
+            y += shelfHeight + padding;
+            shelfHeight = 0;
+        }
+        chart->offset = glm::ivec2(x, y);
+        x += chart->size.x + padding;
+        shelfHeight = std::max(shelfHeight, chart->size.y);
+    }
+
+    width = atlasWidth;
+    height = y + shelfHeight + padding;
+    texels.assign((size_t)width * height, glm::vec3(0.0f));
+
+    // Vertices land on texel centers
+    for (const auto& chart : charts)
+    {
+        for (size_t i = 0; i < chart.vertices.size(); i++)
+        {
+            glm::vec2 texel = glm::vec2(chart.offset) + chart.coords[i] + 0.5f;
+            surfaces[chart.surface].uvs[chart.vertices[i]] = texel / glm::vec2(width, height);
+        }
+    }
+}
+
+const Lightmap::Surface* Lightmap::find(const std::string& name) const
+{
+    for (const auto& surface : surfaces)
+    {
+        if (surface.name == name)
+        {
+            return &surface;
+        }
+    }
+    return nullptr;
+}
+
+void Lightmap::applyUVs(StaticSurface* staticSurfaces, size_t count) const
+{
+    for (size_t s = 0; s < count; s++)
+    {
+        const Surface* surface = find(staticSurfaces[s].name);
+        if (!surface || surface->uvs.size() != staticSurfaces[s].vertexCount)
+        {
+            std::cerr << "Warning: no lightmap UVs for surface " << staticSurfaces[s].name << std::endl;
+            continue;
+        }
+        for (size_t i = 0; i < surface->uvs.size(); i++)
+        {
+            staticSurfaces[s].vertices[i].lightUV = surface->uvs[i];
+        }
+    }
+}
+
+bool Lightmap::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write lightmap: " << path << std::endl;
+        return false;
+    }
+
+    auto write32 = [&](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    out.write(lightmapMagic, sizeof(lightmapMagic));
+    write32(lightmapVersion);
+    write32(width);
+    write32(height);
+    write32(surfaces.size());
+    for (const auto& surface : surfaces)
+    {
+        write32(surface.name.size());
+        out.write(surface.name.data(), surface.name.size());
+        write32(surface.uvs.size());
+        out.write(reinterpret_cast<const char*>(surface.uvs.data()), surface.uvs.size() * sizeof(glm::vec2));
+    }
+    out.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(glm::vec3));
+    return (bool)out;
+}
+
+bool Lightmap::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    auto read32 = [&]() {
+        uint32_t value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, lightmapMagic, sizeof(magic)) != 0 || read32() != lightmapVersion)
+    {
+        std::cerr << "Error: " << path << " is not a lightmap file" << std::endl;
+        return false;
+    }
+
+    width = read32();
+    height = read32();
+    surfaces.resize(read32());
+    for (auto& surface : surfaces)
+    {
+        surface.name.resize(read32());
+        in.read(&surface.name[0], surface.name.size());
+        surface.uvs.resize(read32());
+        in.read(reinterpret_cast<char*>(surface.uvs.data()), surface.uvs.size() * sizeof(glm::vec2));
+    }
+    texels.resize((size_t)width * height);
+    in.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(glm::vec3));
+
+    if (!in)
+    {
+        std::cerr << "Error: truncated lightmap file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
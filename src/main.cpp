@@ -2,6 +2,10 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <math.h>
+#include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <thread>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,15 +14,53 @@
 #include "model.h"
 #include "node.h"
 #include "elements.h"
+#include "shadow.h"
+#include "lightmap.h"
+#include "probeVolume.h"
+#include "material.h"
+#include "portal.h"
+#include "fogVolume.h"
+#include "monitor.h"
+#include "hud.h"
+#include "particles.h"
+#include "decals.h"
+#include "crowd.h"
+#include "animationSystem.h"
+#include "gameSystems.h"
+#include "jobSystem.h"
+#include "tripleBuffer.h"
+#include "frameLatency.h"
+#include "frameLimiter.h"
+#include "eventBus.h"
 
 /// constants for the camera
 const float FOV = 45.0f;
 const float nearPlane = 0.1f;
 const float farPlane = 10000.0f;
 
+// the simulation runs at a fixed rate, the rendering interpolates between its last two ticks
+const double tickSeconds = 1.0 / 60.0;
+// longest stretch of time caught up at once after a stall, the rest is dropped
+const double maxCatchUp = 0.25;
+
+// how frames are presented: held by vsync, uncapped, or capped at cappedFps by the frame limiter
+const FrameLimiter::Mode presentMode = FrameLimiter::Mode::VSync;
+const float cappedFps = 144.0f;
+
 const unsigned int width = 1728;
 const unsigned int height = 972;
 
+// texture unit reserved for the shadow atlas (mesh textures use the first units)
+const GLuint shadowUnit = 7;
+// texture unit reserved for the irradiance probe volume
+const GLuint probeUnit = 6;
+// texture unit reserved for the integrated volumetric fog
+const GLuint fogUnit = 5;
+// first of the four texture units reserved for the decal atlas and cluster buffers
+const GLuint decalUnit = 8;
+// texture unit reserved for the baked bone frames of the crowd
+const GLuint crowdUnit = 12;
+
 // use left mouse button to interact with the camera
 // use z, q, d, d to move the camera
 // use left control to move down
@@ -99,57 +141,23 @@ int main() {
 
     Model playerModel("./models/player.glb", shaderProgram);
 
-    // Textures
-    Texture MainFloorTexture[2] = {
-        Texture("./textures/solSalleEclairee_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/solSalleEclairee_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-    Texture MainWallTexture[2] = {
-        Texture("./textures/murSalleEclairee_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/murSalleEclairee_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-    Texture MainCeilingTexture[2] = {
-        Texture("./textures/plafondSalleEclairee_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/plafondSalleEclairee_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-
-    Texture CorridorFloorTexture[2] = {
-        Texture("./textures/solPasserelle_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/solPasserelle_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-
-    Texture CorridorWallTexture[2] = {
-        Texture("./textures/murSalleEclairee_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/murSalleEclairee_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
+    // Packed materials, cooked by the Cooker target (albedo + occlusion, normal + roughness + height)
+    Material MainFloorMaterial("solSalleEclairee");
+    Material MainWallMaterial("murSalleEclairee");
+    Material MainCeilingMaterial("plafondSalleEclairee");
 
-    Texture CorridorCeilingTexture[2] = {
-        Texture("./textures/plafondSalleEclairee_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/plafondSalleEclairee_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
+    Material CorridorFloorMaterial("solPasserelle");
 
+    Material Room2FloorMaterial("solSalleSombre");
+    Material Room2WallMaterial("murSalleSombre");
+    Material Room2CeilingMaterial("plafondSalleSombre");
 
-    Texture Room2FloorTexture[2] = {
-        Texture("./textures/solSalleSombre_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/solSalleSombre_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-    Texture Room2WallTexture[2] = {
-        Texture("./textures/murSalleSombre_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/murSalleSombre_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
-    Texture Room2CeilingTexture[2] = {
-        Texture("./textures/plafondSalleSombre_albedo.png", "diffuse", 0, GL_RGBA, GL_UNSIGNED_BYTE),
-        Texture("./textures/plafondSalleSombre_normal.png", "specular", 1, GL_RED, GL_UNSIGNED_BYTE)
-        // or GL_RGBA if your specular is RGBA
-    };
+    // Baked static lighting, produced by the Baker target. Without it the rooms keep the constant ambient.
+    Lightmap lightmap;
+    bool lightmapped = lightmap.load("./lightmaps/level.lm");
+    if (lightmapped) {
+        lightmap.applyUVs(staticSurfaces, staticSurfaceCount);
+    }
 
     // Meshes
     std::vector<Vertex> MFV(MainFloorVerticies, MainFloorVerticies + 4);
@@ -195,44 +203,60 @@ int main() {
 
 
     // Vecteurs de textures pour chaque Mesh
-    std::vector<Texture> MFTextures(MainFloorTexture, MainFloorTexture + 2);
-    std::vector<Texture> MWTextures(MainWallTexture, MainWallTexture + 2);
-    std::vector<Texture> MCTextures(MainCeilingTexture, MainCeilingTexture + 2);
-    std::vector<Texture> CFTextures(CorridorFloorTexture, CorridorFloorTexture + 2);
-    std::vector<Texture> CWTextures(CorridorWallTexture, CorridorWallTexture + 2);
-    std::vector<Texture> CCTextures(CorridorCeilingTexture, CorridorCeilingTexture + 2);
-    std::vector<Texture> R2FTextures(Room2FloorTexture, Room2FloorTexture + 2);
-    std::vector<Texture> R2WTextures(Room2WallTexture, Room2WallTexture + 2);
-    std::vector<Texture> R2CTextures(Room2CeilingTexture, Room2CeilingTexture + 2);
+    std::vector<Texture> MFTextures = MainFloorMaterial.textures();
+    std::vector<Texture> MWTextures = MainWallMaterial.textures();
+    std::vector<Texture> MCTextures = MainCeilingMaterial.textures();
+    std::vector<Texture> CFTextures = CorridorFloorMaterial.textures();
+    std::vector<Texture> CWTextures = MainWallMaterial.textures();
+    std::vector<Texture> CCTextures = MainCeilingMaterial.textures();
+    std::vector<Texture> R2FTextures = Room2FloorMaterial.textures();
+    std::vector<Texture> R2WTextures = Room2WallMaterial.textures();
+    std::vector<Texture> R2CTextures = Room2CeilingMaterial.textures();
     // Pour les bouchons, on peut réutiliser les textures murales correspondantes
-    std::vector<Texture> RFCTextures(MainWallTexture, MainWallTexture + 2);
-    std::vector<Texture> R2BCTextures(Room2WallTexture, Room2WallTexture + 2);
+    std::vector<Texture> RFCTextures = MainWallMaterial.textures();
+    std::vector<Texture> R2BCTextures = Room2WallMaterial.textures();
+
+    // Irradiance probes for the player and other dynamic objects, baked along with the lightmap
+    ProbeGrid probeGrid;
+    if (!probeGrid.load("./lightmaps/probes.lmp"))
+        probeGrid = ProbeGrid();
+    ProbeVolume probes(probeGrid);
+    probes.apply(shaderProgram, probeUnit);
+
+    Texture LightmapTexture;
+    if (lightmapped) {
+        LightmapTexture = Texture(&lightmap.texels[0].x, lightmap.width, lightmap.height, "lightmap", 2);
+        for (auto *textures: {&MFTextures, &MWTextures, &MCTextures, &CFTextures, &CWTextures, &CCTextures,
+                              &R2FTextures, &R2WTextures, &R2CTextures, &RFCTextures, &R2BCTextures}) {
+            textures->push_back(LightmapTexture);
+        }
+    }
 
     // Meshes
-    Mesh MainFloorMesh(MFV, MFI, MFTextures, shaderProgram);
-    Mesh MainWallMesh(MWV, MWI, MWTextures, shaderProgram);
-    Mesh MainCeilingMesh(MCV, MCI, MCTextures, shaderProgram);
+    MeshHandle MainFloorMesh = Mesh::pool().create(MFV, MFI, MFTextures, shaderProgram);
+    MeshHandle MainWallMesh = Mesh::pool().create(MWV, MWI, MWTextures, shaderProgram);
+    MeshHandle MainCeilingMesh = Mesh::pool().create(MCV, MCI, MCTextures, shaderProgram);
 
-    Mesh CorridorFloorMesh(CFV, CFI, CFTextures, shaderProgram);
-    Mesh CorridorWallMesh(CWV, CWI, CWTextures, shaderProgram);
-    Mesh CorridorCeilingMesh(CCV, CCI, CCTextures, shaderProgram);
+    MeshHandle CorridorFloorMesh = Mesh::pool().create(CFV, CFI, CFTextures, shaderProgram);
+    MeshHandle CorridorWallMesh = Mesh::pool().create(CWV, CWI, CWTextures, shaderProgram);
+    MeshHandle CorridorCeilingMesh = Mesh::pool().create(CCV, CCI, CCTextures, shaderProgram);
 
-    Mesh Room2FloorMesh(R2FV, R2FI, R2FTextures, shaderProgram);
-    Mesh Room2WallMesh(R2WV, R2WI, R2WTextures, shaderProgram);
-    Mesh Room2CeilingMesh(R2CV, R2CI, R2CTextures, shaderProgram);
+    MeshHandle Room2FloorMesh = Mesh::pool().create(R2FV, R2FI, R2FTextures, shaderProgram);
+    MeshHandle Room2WallMesh = Mesh::pool().create(R2WV, R2WI, R2WTextures, shaderProgram);
+    MeshHandle Room2CeilingMesh = Mesh::pool().create(R2CV, R2CI, R2CTextures, shaderProgram);
 
-    Mesh RoomFrontCapLeftMesh(RFCLV, RFCLI, RFCTextures, shaderProgram);
+    MeshHandle RoomFrontCapLeftMesh = Mesh::pool().create(RFCLV, RFCLI, RFCTextures, shaderProgram);
 
-    Mesh RoomFrontCapRightMesh(RFCRV, RFCRI, RFCTextures, shaderProgram);
-    Mesh Room2BackCapLeftMesh(R2BCLV, R2BCLI, R2BCTextures, shaderProgram);
+    MeshHandle RoomFrontCapRightMesh = Mesh::pool().create(RFCRV, RFCRI, RFCTextures, shaderProgram);
+    MeshHandle Room2BackCapLeftMesh = Mesh::pool().create(R2BCLV, R2BCLI, R2BCTextures, shaderProgram);
 
-    Mesh Room2BackCapRightMesh(R2BCRV, R2BCRI, R2BCTextures, shaderProgram);
+    MeshHandle Room2BackCapRightMesh = Mesh::pool().create(R2BCRV, R2BCRI, R2BCTextures, shaderProgram);
 
     // Store mesh data in vectors for the mesh
     std::vector<Vertex> lightVerts(lightVertices, lightVertices + sizeof(lightVertices) / sizeof(Vertex));
     std::vector<GLuint> lightInd(lightIndices, lightIndices + sizeof(lightIndices) / sizeof(GLuint));
     std::vector<Texture> lightTextures;
-    Mesh light(lightVerts, lightInd, lightTextures, lightShader);
+    MeshHandle light = Mesh::pool().create(lightVerts, lightInd, lightTextures, lightShader);
 
     glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
     glm::vec3 lightPos = glm::vec3(0.0f, 4.5f, 0.5f);
@@ -254,30 +278,63 @@ int main() {
                 lightColor.w);
     glUniform3f(glGetUniformLocation(shaderProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
 
-    Node *root = new Node();
-    //add the meshes to the root node
-    root->add(&MainFloorMesh);
-    root->add(&MainWallMesh);
-    root->add(&MainCeilingMesh);
-    root->add(&CorridorFloorMesh);
-    root->add(&CorridorWallMesh);
-    root->add(&CorridorCeilingMesh);
-    root->add(&Room2FloorMesh);
-    root->add(&Room2WallMesh);
-    root->add(&Room2CeilingMesh);
+    NodeHandle root = Node::create();
+    // one node per static mesh so each can be occlusion culled on its own, walls and caps occlude
+    auto addStatic = [root](MeshHandle mesh, bool occluder) {
+        NodeHandle node = Node::create();
+        node->add(mesh);
+        node->setOccluder(occluder);
+        root->add(node);
+        return node;
+    };
+    NodeHandle mainFloor = addStatic(MainFloorMesh, false);
+    NodeHandle mainWall = addStatic(MainWallMesh, true);
+    NodeHandle mainCeiling = addStatic(MainCeilingMesh, false);
+    NodeHandle corridorFloor = addStatic(CorridorFloorMesh, false);
+    NodeHandle corridorWall = addStatic(CorridorWallMesh, true);
+    NodeHandle corridorCeiling = addStatic(CorridorCeilingMesh, false);
+    NodeHandle room2Floor = addStatic(Room2FloorMesh, false);
+    NodeHandle room2Wall = addStatic(Room2WallMesh, true);
+    NodeHandle room2Ceiling = addStatic(Room2CeilingMesh, false);
     // Add the separated caps (avant)
-    root->add(&RoomFrontCapLeftMesh);
-    root->add(&RoomFrontCapRightMesh);
+    NodeHandle frontCapLeft = addStatic(RoomFrontCapLeftMesh, true);
+    NodeHandle frontCapRight = addStatic(RoomFrontCapRightMesh, true);
 
     // Add the separated caps (arrière)
-    root->add(&Room2BackCapLeftMesh);
-    root->add(&Room2BackCapRightMesh);
+    NodeHandle backCapLeft = addStatic(Room2BackCapLeftMesh, true);
+    NodeHandle backCapRight = addStatic(Room2BackCapRightMesh, true);
+
+    // Rooms are cells joined by their doorways, only the rooms seen through them are drawn.
+    // The caps frame a doorway so they belong to both rooms it joins.
+    PortalSystem portals;
+    for (size_t i = 0; i < staticRoomCount; i++)
+    {
+        portals.addCell(staticRooms[i].boundsMin, staticRooms[i].boundsMax);
+    }
+    for (size_t i = 0; i < staticPortalCount; i++)
+    {
+        portals.addPortal(staticPortals[i].roomA, staticPortals[i].roomB, staticPortals[i].corners, 4);
+    }
+    for (NodeHandle node : {mainFloor, mainWall, mainCeiling, frontCapLeft, frontCapRight})
+    {
+        portals.addNode(0, node);
+    }
+    for (NodeHandle node : {corridorFloor, corridorWall, corridorCeiling, frontCapLeft, frontCapRight, backCapLeft, backCapRight})
+    {
+        portals.addNode(1, node);
+    }
+    for (NodeHandle node : {room2Floor, room2Wall, room2Ceiling, backCapLeft, backCapRight})
+    {
+        portals.addNode(2, node);
+    }
 
-    Node *playerNode = new Node();
-    for (auto &mesh: playerModel.meshes) {
-        playerNode->add(&mesh);
+    NodeHandle playerNode = Node::create();
+    for (MeshHandle mesh: playerModel.meshes) {
+        playerNode->add(mesh);
     }
     root->add(playerNode);
+    // the player moves every frame, so it is composited over the cached room shadows
+    playerNode->setDynamic(true);
 
     glm::mat4 playerTransform = glm::mat4(1.0f);
     playerTransform = glm::translate(playerTransform, glm::vec3(0.0f, -0.75f, 0.0f));
@@ -285,29 +342,369 @@ int main() {
     playerTransform = glm::scale(playerTransform, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
     playerNode->setTransform(playerTransform);
 
-    Node *lightNode = new Node(glm::translate(glm::mat4(1.0f), lightPos));
-    lightNode->add(&light);
+    // A coworker pacing the back of the main room, animated like the player
+    Model coworkerModel("./models/player.glb", shaderProgram);
+    NodeHandle coworkerNode = Node::create();
+    for (MeshHandle mesh: coworkerModel.meshes) {
+        coworkerNode->add(mesh);
+    }
+    root->add(coworkerNode);
+    coworkerNode->setDynamic(true);
+
+    NodeHandle lightNode = Node::create(glm::translate(glm::mat4(1.0f), lightPos));
+    lightNode->add(light);
+    // the light sits inside its own cube, which must not occlude it
+    lightNode->setCastShadows(false);
 
     root->add(lightNode);
 
+    // Ceiling fixtures of the static lights the lightmaps are baked from, flat panels of the light cube
+    for (size_t i = 0; i < staticLightCount; i++) {
+        glm::mat4 fixture = glm::translate(glm::mat4(1.0f), glm::vec3(staticLights[i].position.x, 0.97f, staticLights[i].position.z));
+        NodeHandle lampNode = Node::create(glm::scale(fixture, glm::vec3(1.5f, 0.15f, 1.5f)));
+        lampNode->add(light);
+        lampNode->setCastShadows(false);
+        root->add(lampNode);
+    }
+
     glEnable(GL_DEPTH_TEST);
 
+    // Software depth buffer of the walls, rejects what they hide before it is submitted
+    OcclusionCuller occlusion;
+    root->addOccluders(occlusion);
+
+    ShadowSystem shadows;
+    int shadowLight = shadows.addLight(lightPos, 15.0f);
+
+    // Volumetric fog filling the dark room (Room2), lit by the moving light
+    FogVolume fog;
+    fog.boxMin = staticRooms[2].boundsMin;
+    fog.boxMax = staticRooms[2].boundsMax;
+    fog.density = 0.35f;
+
+    // Security monitors on the main room's back wall, watching the dark room and the corridor
+    Shader screenShader("./shaders/screen.vert", "./shaders/screen.frag");
+    MonitorSystem monitors;
+    int room2Monitor = monitors.addMonitor(glm::vec3(2.7f, 0.7f, 9.7f), glm::vec3(0.0f, -0.6f, 7.5f), 256, 144, 10.0f);
+    int corridorMonitor = monitors.addMonitor(glm::vec3(0.0f, 0.8f, 5.9f), glm::vec3(0.0f, -0.5f, 3.5f), 192, 108, 4.0f);
+    std::vector<GLuint> screenIndices = {0, 1, 2, 0, 2, 3};
+    std::vector<std::vector<Vertex>> screenVertices;
+    std::vector<std::vector<Texture>> screenTextures;
+    for (float left : {-1.6f, 0.2f})
+    {
+        float right = left + 1.4f, bottom = -0.1f, top = bottom + 0.7875f, z = -3.49f;
+        screenVertices.push_back({
+            Vertex{glm::vec3(left, bottom, z), glm::vec3(0, 0, 1), glm::vec3(1, 1, 1), glm::vec2(0, 0)},
+            Vertex{glm::vec3(right, bottom, z), glm::vec3(0, 0, 1), glm::vec3(1, 1, 1), glm::vec2(1, 0)},
+            Vertex{glm::vec3(right, top, z), glm::vec3(0, 0, 1), glm::vec3(1, 1, 1), glm::vec2(1, 1)},
+            Vertex{glm::vec3(left, top, z), glm::vec3(0, 0, 1), glm::vec3(1, 1, 1), glm::vec2(0, 1)}
+        });
+    }
+    screenTextures.push_back({monitors.texture(room2Monitor)});
+    screenTextures.push_back({monitors.texture(corridorMonitor)});
+    for (int monitor : {room2Monitor, corridorMonitor})
+    {
+        MeshHandle screenMesh = Mesh::pool().create(screenVertices[monitor], screenIndices, screenTextures[monitor], screenShader);
+        NodeHandle screenNode = Node::create();
+        screenNode->add(screenMesh);
+        screenNode->setCastShadows(false);
+        root->add(screenNode);
+        portals.addNode(0, screenNode);
+        monitors.setScreen(monitor, screenNode);
+    }
+
     Camera camera(width, height, glm::vec3(0.0f, 0.0f, 2.0f), FOV, nearPlane, farPlane);
 
-    glm::vec3 playerPosition(0.0f, -1.0f, 2.0f);
-    float playerRotationY = glm::radians(180.0f);
-    float cameraDistance = 4.0f;
-    float cameraPitch = 25.0f;
-    float cameraAngleAroundPlayer = 0.0f;
+    // Dust floating in the main room, steam rising in the corridor, sparks from the dark room's lamp
+    ParticleSystem particles;
+    ParticleSystem::Emitter dust;
+    dust.spawnExtent = glm::vec3(3.3f, 0.95f, 3.3f);
+    dust.velocityJitter = glm::vec3(0.02f);
+    dust.gravity = glm::vec3(0.0f, -0.002f, 0.0f);
+    dust.drag = 0.1f;
+    dust.lifetime = 8.0f;
+    dust.lifetimeJitter = 2.0f;
+    dust.rate = 2500.0f;
+    dust.budget = 20000;
+    dust.sizeStart = dust.sizeEnd = 0.008f;
+    dust.colorStart = glm::vec4(1.0f, 0.95f, 0.85f, 0.4f);
+    dust.colorEnd = glm::vec4(1.0f, 0.95f, 0.85f, 0.0f);
+    dust.additive = true;
+    dust.cell = 0;
+    particles.addEmitter(dust);
+
+    ParticleSystem::Emitter steam;
+    steam.position = glm::vec3(0.0f, -0.9f, 4.8f);
+    steam.spawnExtent = glm::vec3(0.3f, 0.05f, 0.3f);
+    steam.velocity = glm::vec3(0.0f, 0.25f, 0.0f);
+    steam.velocityJitter = glm::vec3(0.05f);
+    steam.lifetime = 3.0f;
+    steam.lifetimeJitter = 0.5f;
+    steam.rate = 120.0f;
+    steam.budget = 400;
+    steam.sizeStart = 0.08f;
+    steam.sizeEnd = 0.3f;
+    steam.colorStart = glm::vec4(0.7f, 0.7f, 0.7f, 0.25f);
+    steam.colorEnd = glm::vec4(0.7f, 0.7f, 0.7f, 0.0f);
+    steam.cell = 1;
+    particles.addEmitter(steam);
+
+    ParticleSystem::Emitter sparks;
+    sparks.position = glm::vec3(2.5f, 0.9f, 9.5f);
+    sparks.spawnExtent = glm::vec3(0.02f);
+    sparks.velocity = glm::vec3(0.0f, -0.5f, 0.0f);
+    sparks.velocityJitter = glm::vec3(1.0f, 0.5f, 1.0f);
+    sparks.gravity = glm::vec3(0.0f, -9.8f, 0.0f);
+    sparks.drag = 0.5f;
+    sparks.lifetime = 0.8f;
+    sparks.lifetimeJitter = 0.3f;
+    sparks.rate = 600.0f;
+    sparks.budget = 1000;
+    sparks.sizeStart = 0.012f;
+    sparks.sizeEnd = 0.006f;
+    sparks.colorStart = glm::vec4(1.0f, 0.7f, 0.3f, 1.0f);
+    sparks.colorEnd = glm::vec4(1.0f, 0.2f, 0.0f, 0.0f);
+    sparks.additive = true;
+    sparks.cell = 2;
+    particles.addEmitter(sparks);
+
+    // Poster in the main room, scorch marks in the corridor, footprints leading into the dark room
+    // where the floor and walls are covered in blood
+    DecalSystem decals;
+    int posterImage = decals.addImage("./textures/pop_cat.png");
+    int splatImages[4];
+    for (int k = 0; k < 4; k++)
+        splatImages[k] = decals.addShape(DecalSystem::Shape::Splat, 128, glm::vec4(0.35f, 0.02f, 0.02f, 0.9f), k + 1);
+    int scorchImage = decals.addShape(DecalSystem::Shape::Scorch, 128, glm::vec4(0.03f, 0.02f, 0.02f, 0.85f), 7);
+    int footprintImage = decals.addShape(DecalSystem::Shape::Footprint, 64, glm::vec4(0.2f, 0.03f, 0.02f, 0.8f), 11);
+
+    decals.add(glm::vec3(-3.5f, 0.2f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f), 0.0f, posterImage);
+    decals.add(glm::vec3(0.1f, -1.0f, 4.6f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.9f), 0.6f, scorchImage);
+    decals.add(glm::vec3(0.5f, -0.2f, 5.2f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.7f), 2.1f, scorchImage);
+    for (int step = 0; step < 14; step++)
+    {
+        float side = step % 2 ? 0.09f : -0.09f;
+        decals.add(glm::vec3(side + 0.05f * sin(step * 0.7f), -1.0f, 3.0f + step * 0.42f), glm::vec3(0.0f, 1.0f, 0.0f),
+                   glm::vec2(0.12f, 0.28f), glm::radians(180.0f), footprintImage, glm::vec4(1.0f), 0.05f);
+    }
+    uint32_t decalRandom = 12345;
+    auto randomRange = [&](float low, float high) {
+        decalRandom = decalRandom * 1664525u + 1013904223u;
+        return low + (high - low) * ((decalRandom >> 8) / 16777216.0f);
+    };
+    for (int k = 0; k < 1500; k++)
+    {
+        int image = splatImages[k % 4];
+        float size = randomRange(0.05f, 0.4f);
+        glm::vec4 tint(glm::vec3(randomRange(0.6f, 1.0f)), 1.0f);
+        float wall = randomRange(0.0f, 1.0f);
+        if (wall < 0.7f)
+            decals.add(glm::vec3(randomRange(-2.9f, 2.9f), -1.0f, randomRange(6.1f, 9.9f)), glm::vec3(0.0f, 1.0f, 0.0f),
+                       glm::vec2(size), randomRange(0.0f, 6.28f), image, tint);
+        else if (wall < 0.85f)
+            decals.add(glm::vec3(wall < 0.775f ? -3.0f : 3.0f, randomRange(-1.0f, 0.6f), randomRange(6.1f, 9.9f)),
+                       glm::vec3(wall < 0.775f ? 1.0f : -1.0f, 0.0f, 0.0f), glm::vec2(size), randomRange(0.0f, 6.28f),
+                       image, tint);
+        else
+            decals.add(glm::vec3(randomRange(-2.9f, 2.9f), randomRange(-1.0f, 0.6f), 10.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                       glm::vec2(size), randomRange(0.0f, 6.28f), image, tint);
+    }
+    // Binds the samplers to their units before the first frame, the decals stay off until update()
+    decals.apply(shaderProgram, decalUnit);
+
+    // Spectators packing the dark room, skinned in default.vert from the clips baked by the Animator target
+    BakedAnimation crowdAnimation;
+    if (!crowdAnimation.load("./animations/player.anim"))
+        std::cout << "No baked animations, run the Animator target to fill the dark room" << std::endl;
+    Crowd crowd(crowdAnimation, playerModel.meshes.empty() ? nullptr : playerModel.meshes[0].get());
+    crowd.cell = 2;
+    int crowdClips[4] = {crowdAnimation.findClip("idle"), crowdAnimation.findClip("idle"), crowdAnimation.findClip("wave"),
+                         crowdAnimation.findClip("walk")};
+    if (crowd.valid())
+    {
+        for (int row = 0; row < 10; row++)
+            for (int column = 0; column < 14; column++)
+            {
+                glm::vec3 position(-2.6f + column * 0.4f + randomRange(-0.08f, 0.08f), -1.0f,
+                                   6.4f + row * 0.37f + randomRange(-0.08f, 0.08f));
+                // Facing the door to the corridor
+                glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+                transform = glm::rotate(transform, glm::radians(180.0f) + randomRange(-0.4f, 0.4f), glm::vec3(0.0f, 1.0f, 0.0f));
+                transform = glm::scale(transform, glm::vec3(0.00075f));
+                crowd.add(transform, crowdClips[(row * 7 + column * 3) % 4], randomRange(0.8f, 1.2f), randomRange(0.0f, 3.0f));
+            }
+    }
+
+    // The player and the coworker blend idle, walk and run by their speed (units per second, the
+    // walk and run speeds at 60 fps), skinned in default.vert
+    AnimationLibrary animationLibrary;
+    if (!animationLibrary.load("./animations/player.clips"))
+        std::cout << "No animation clips, run the Animator target to animate the characters" << std::endl;
+    AnimationSystem animations(animationLibrary);
+    std::vector<AnimationSystem::BlendPoint> locomotion = {{animationLibrary.findClip("idle"), 0.0f},
+                                                           {animationLibrary.findClip("walk"), 3.0f},
+                                                           {animationLibrary.findClip("run"), 5.4f}};
+    int playerCharacter = -1, coworkerCharacter = -1;
+    if (!animationLibrary.clips.empty())
+    {
+        playerCharacter = animations.add(playerModel, locomotion);
+        coworkerCharacter = animations.add(coworkerModel, locomotion);
+    }
+
+    // Live stats overlay, the title never changes so it is laid out once
+    Hud hud(width, height);
+    int hudTitle = hud.cache("Projet Mortal Company", glm::vec4(1.0f, 0.85f, 0.4f, 1.0f));
+    char hudLine[320];
+    double lastFrameTime = glfwGetTime();
+    double frameMs = 0.0;
+
+    // Game objects, updated by the systems every frame
+    World world;
+    Entity player = world.create(Transform{glm::vec3(0.0f, -1.0f, 2.0f), glm::radians(180.0f), 0.00075f},
+                                 PlayerControl{}, Locomotion{playerCharacter}, Renderable{playerNode});
+    Entity view = world.create(OrbitCamera{player});
+    world.get<PlayerControl>(player)->camera = view;
+    world.create(Transform{glm::vec3(-2.5f, -1.0f, -2.5f), 0.0f, 0.00075f},
+                 Patrol{glm::vec3(0.0f, -1.0f, -2.5f), 2.5f, 3.0f}, Locomotion{coworkerCharacter}, Renderable{coworkerNode});
+    world.create(PointLight{lightPos}, LightPath{glm::vec3(0.0f, 0.5f, 4.5f), glm::vec3(0.0f, 0.0f, 5.0f)},
+                 Renderable{lightNode});
+
+    // Visible meshes of the main view, culled and sorted over the JobSystem every frame
+    DrawList sceneDraws;
+
+    GameInput input;
+    SystemScheduler systems;
+    systems.add(lightAnimationSystem(world));
+    systems.add(patrolSystem(world));
+    systems.add(cameraLookSystem(world, input));
+    systems.add(playerMovementSystem(world, input, isPositionValid));
+    systems.add(cameraFollowSystem(world, isPositionValid));
+    // Filled by the last system of each tick, then handed to the render thread with the tick before
+    RenderSnapshot latestTick, previousTick;
+    TripleBuffer<RenderTicks> ticks;
+    systems.add(renderExtractionSystem(world, view, latestTick));
+
+    // Mouse movement goes straight to the render thread as well, which turns the camera by what the
+    // ticks haven't taken in yet. One frame at most queued in the driver.
+    FrameLatency latency;
+    latency.maxQueuedFrames = 1;
+    glm::vec2 tickLook = glm::vec2(0.0f);
+    FrameLimiter limiter;
+    limiter.mode = presentMode;
+    limiter.targetFps = cappedFps;
+    if (const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor()))
+        limiter.refreshRate = (float)videoMode->refreshRate;
+
+    // Keys are published by the window on this thread and handled by whoever listens, here the
+    // render thread, where F1 cycles the present modes
+    EventBus events;
+    EventBus::Consumer& renderEvents = events.consumer();
+    renderEvents.listen<KeyEvent>([&](const KeyEvent* keys, int count) {
+        for (int i = 0; i < count; i++) {
+            if (keys[i].key == GLFW_KEY_F1 && keys[i].action == GLFW_PRESS) {
+                limiter.mode = (FrameLimiter::Mode)(((int)limiter.mode + 1) % 3);
+                limiter.apply();
+            }
+        }
+    });
+    glfwSetWindowUserPointer(window, &events);
+    glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int, int action, int mods) {
+        ((EventBus*)glfwGetWindowUserPointer(window))->publish(KeyEvent{key, action, mods});
+    });
+
     double lastMouseX, lastMouseY;
     glfwGetCursorPos(window, &lastMouseX, &lastMouseY);
     bool firstClick = true;
 
 
-    while (!glfwWindowShouldClose(window)) {
-        glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // The GL context moves to the render thread, which draws as fast as it can between the last
+    // two ticks while this thread, the one GLFW delivers input on, runs the simulation
+    std::atomic<bool> rendering(true);
+    JobSystem::shared();
+    glfwMakeContextCurrent(NULL);
+    std::thread renderThread([&]() {
+        glfwMakeContextCurrent(window);
+        JobSystem::shared().attachThread();
+        JobSystem::shared().setGLThread();
+        limiter.apply();
+        RenderSnapshot frame;
+        ticks.waitPublished();
+        while (rendering.load()) {
+            renderEvents.dispatch();
+            JobSystem::shared().runGLJobs();
+            limiter.wait();
+            glm::vec2 look = latency.beginFrame();
+            double now = glfwGetTime();
+            float dt = (float)std::min(now - lastFrameTime, 0.1);
+            lastFrameTime = now;
+
+            // One tick behind the simulation, so there are always two ticks around the time drawn
+            const RenderTicks& latest = ticks.acquire();
+            float alpha = (float)glm::clamp((now - latest.current.time) / tickSeconds, 0.0, 1.0);
+            RenderSnapshot::interpolate(latest.previous, latest.current, alpha, frame);
+            applyRenderSnapshot(frame, camera, animations, FOV, nearPlane, farPlane, look - frame.look);
+
+            glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            if (playerCharacter >= 0)
+            {
+                animations.update(dt, camera);
+            }
 
+            if (!frame.lights.empty())
+                lightPos = frame.lights[0];
+            shaderProgram.Activate();
+            glUniform3f(glGetUniformLocation(shaderProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
+
+            shadows.setLightPosition(shadowLight, lightPos);
+            shadows.render(*root, camera);
+            shadows.apply(shaderProgram, shadowUnit);
+
+            fog.disable(shaderProgram);
+            decals.disable(shaderProgram);
+            monitors.render(*root, camera, glfwGetTime(), &portals, &occlusion);
+
+            fog.render(camera, lightPos, lightColor, shadows, shadowUnit);
+            fog.apply(shaderProgram, fogUnit);
+            decals.update(camera, nearPlane);
+            decals.apply(shaderProgram, decalUnit);
+
+            portals.update(camera.cameraMatrix, camera.Position);
+            occlusion.render(camera.cameraMatrix);
+            sceneDraws.build(*root, camera.cameraMatrix, &occlusion);
+            sceneDraws.submit(camera);
+            crowd.draw(shaderProgram, camera, (float)glfwGetTime(), crowdUnit, &portals);
+
+            particles.update(dt, camera, &portals);
+            particles.draw(camera, nearPlane, farPlane);
+
+            frameMs += (dt * 1000.0 - frameMs) * 0.05;
+            hud.rect(8.0f, 8.0f, 272.0f, 156.0f, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+            hud.cached(hudTitle, 16.0f, 14.0f);
+            snprintf(hudLine, sizeof(hudLine), "frame %6.2f ms %5.0f fps\npacing %.0f us worst %.0f\ncells %d  portals %d  input %.1f ms\noccluded %d / %d  draws %d\nmonitors %d seen %d refreshed\nparticles %d drawn %d\ndecals %d busiest %d\ncrowd %d drawn  skeletons %d",
+                     frameMs, 1000.0 / std::max(frameMs, 0.001), limiter.pacingErrorUs, limiter.worstErrorUs,
+                     portals.visibleCells, portals.portalsTested, latency.latencyMs,
+                     occlusion.culled.load(), occlusion.tested.load(), (int)sceneDraws.items().size(), monitors.visibleMonitors, monitors.refreshes,
+                     particles.alive, particles.drawn, decals.visibleDecals, decals.busiestCluster,
+                     crowd.visible, animations.evaluated);
+            hud.text(16.0f, 32.0f, hudLine, glm::vec4(0.85f, 0.95f, 0.85f, 1.0f));
+            hud.draw();
+
+            glfwSwapBuffers(window);
+            limiter.presented();
+            latency.endFrame();
+        }
+        JobSystem::shared().detachThread();
+        glfwMakeContextCurrent(NULL);
+    });
+
+    double simulatedTime = glfwGetTime();
+    while (!glfwWindowShouldClose(window)) {
+        // Sleeps until the next tick is due, waking up for input
+        glfwWaitEventsTimeout(std::max(0.0, simulatedTime + tickSeconds - glfwGetTime()));
+        double now = glfwGetTime();
+        // Sampled on every wake up, not only when a tick is due
         if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
             if (firstClick) {
@@ -324,82 +721,66 @@ int main() {
             lastMouseX = mouseX;
             lastMouseY = mouseY;
 
-            float rotationSpeed = 0.2f;
-            cameraAngleAroundPlayer -= deltaX * rotationSpeed;
-            cameraPitch -= deltaY * rotationSpeed;
-
-            if (cameraPitch > 85.0f) cameraPitch = 85.0f;
-            if (cameraPitch < 5.0f) cameraPitch = 5.0f;
+            if (deltaX != 0.0f || deltaY != 0.0f)
+                latency.addLook(glm::vec2(deltaX, deltaY), now);
         } else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE) {
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
             firstClick = true;
         }
 
-        glm::vec3 moveInput(0.0f);
-        float playerSpeed = 0.05f;
-
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) moveInput.z = 1.0f;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) moveInput.z = -1.0f;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) moveInput.x = 1.0f;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) moveInput.x = -1.0f;
-
-        if (glm::length(moveInput) > 0.0f) {
-            moveInput = glm::normalize(moveInput);
-
-            float cameraYaw = glm::radians(cameraAngleAroundPlayer);
-            glm::vec3 forward = glm::vec3(sin(cameraYaw), 0.0f, cos(cameraYaw));
-            glm::vec3 right = glm::vec3(forward.z, 0.0f, forward.x);
-
-            glm::vec3 moveDirection = forward * moveInput.z + right * moveInput.x;
-
-            if (glm::length(moveDirection) > 0.0f) {
-                playerRotationY = atan2(moveDirection.x, moveDirection.z);
-
-                glm::vec3 newPotentialPos = playerPosition + glm::normalize(moveDirection) * playerSpeed;
-                if (isPositionValid(newPotentialPos)) {
-                    playerPosition = newPotentialPos;
-                }
-            }
+        if (now - simulatedTime > maxCatchUp)
+            simulatedTime = now - maxCatchUp;
+        if (simulatedTime + tickSeconds > now)
+            continue;
+
+        input.move = glm::vec2(0.0f);
+        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input.move.y = 1.0f;
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input.move.y = -1.0f;
+        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input.move.x = 1.0f;
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input.move.x = -1.0f;
+        input.run = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+
+        // The keys drive every tick of a catch up, the mouse movement only the first
+        input.look = latency.look() - tickLook;
+        tickLook = latency.look();
+        while (simulatedTime + tickSeconds <= now) {
+            systems.run(world, (float)tickSeconds);
+            simulatedTime += tickSeconds;
+            latestTick.time = simulatedTime;
+            latestTick.look = tickLook;
+
+            RenderTicks& handed = ticks.back();
+            // Nothing to blend from before the first tick
+            handed.previous = previousTick.time > 0.0 ? previousTick : latestTick;
+            handed.current = latestTick;
+            ticks.publish();
+            std::swap(previousTick, latestTick);
+            input.look = glm::vec2(0.0f);
         }
+    }
 
-        glm::mat4 playerTransform = glm::mat4(1.0f);
-        playerTransform = glm::translate(playerTransform, playerPosition);
-        playerTransform = glm::rotate(playerTransform, playerRotationY, glm::vec3(0.0f, 1.0f, 0.0f));
-        float scaleFactor = 0.00075f;
-        playerTransform = glm::scale(playerTransform, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
-        playerNode->setTransform(playerTransform);
-
-        glm::vec3 cameraTarget = playerPosition + glm::vec3(0.0f, 0.8f, 0.0f);
-        float currentCameraDistance = cameraDistance;
-        while (currentCameraDistance > 0.5f)
-        {
-            float horizontalDist = currentCameraDistance * cos(glm::radians(cameraPitch));
-            float verticalDist = currentCameraDistance * sin(glm::radians(cameraPitch));
-            float offsetX = horizontalDist * sin(glm::radians(cameraAngleAroundPlayer));
-            float offsetZ = horizontalDist * cos(glm::radians(cameraAngleAroundPlayer));
-
-            camera.Position = glm::vec3(playerPosition.x - offsetX, playerPosition.y + verticalDist + 1.0f,
-                                        playerPosition.z - offsetZ);
-
-            if (isPositionValid(camera.Position)) {
-                break;
-            }
-
-            currentCameraDistance -= 0.1f;
-        }
-        camera.updateMatrix(FOV, nearPlane, farPlane, cameraTarget);
-
-        lightPos = glm::vec3(0.0f, 0.5f, 4.5f + 5.0f * cos(glfwGetTime()));
-        lightNode->setTransform(glm::translate(glm::mat4(1.0f), lightPos));
-        shaderProgram.Activate();
-        glUniform3f(glGetUniformLocation(shaderProgram.ID, "lightPos"), lightPos.x, lightPos.y, lightPos.z);
-
-        root->draw(camera, glm::mat4(1.0f));
+    rendering = false;
+    // Wakes the render thread up if it never got a tick
+    ticks.publish();
+    renderThread.join();
+    glfwSetKeyCallback(window, NULL);
+    glfwMakeContextCurrent(window);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    Node::destroy(root);
+    latency.Delete();
+    shadows.Delete();
+    fog.Delete();
+    monitors.Delete();
+    hud.Delete();
+    particles.Delete();
+    decals.Delete();
+    crowd.Delete();
+    screenShader.Delete();
+    probes.Delete();
+    for (Material* material : {&MainFloorMaterial, &MainWallMaterial, &MainCeilingMaterial, &CorridorFloorMaterial,
+                               &Room2FloorMaterial, &Room2WallMaterial, &Room2CeilingMaterial}) {
+        material->Delete();
     }
-
     shaderProgram.Delete();
     lightShader.Delete();
     glfwDestroyWindow(window);
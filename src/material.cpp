@@ -0,0 +1,32 @@
+#include "material.h"
+
+Material::Material(const std::string& name, GLuint albedoSlot, GLuint surfaceSlot)
+{
+    CookedMaterial cooked;
+    if (!cooked.load("./materials", name))
+    {
+        std::cerr << "Warning: material " << name << " isn't cooked, run Cooker to speed up loading" << std::endl;
+        if (!MaterialCooker().cook("./textures", name, cooked))
+        {
+            return;
+        }
+    }
+
+    albedo = Texture(cooked.albedo, "diffuse", albedoSlot);
+    surface = Texture(cooked.surface, "surface", surfaceSlot);
+}
+
+std::vector<Texture> Material::textures() const
+{
+    if (albedo.ID == 0)
+    {
+        return {};
+    }
+    return {albedo, surface};
+}
+
+void Material::Delete()
+{
+    albedo.Delete();
+    surface.Delete();
+}
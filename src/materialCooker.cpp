@@ -0,0 +1,386 @@
+#include "materialCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <glm/glm.hpp>
+
+#include "stb_image.h"
+
+static const char imageMagic[4] = {'M', 'C', 'T', 'X'};
+static const uint32_t imageVersion = 1;
+
+namespace
+{
+    // Source map as floats in [0, 1], bilinearly sampled with wrapping like the GL_REPEAT textures
+    struct Plane
+    {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        std::vector<float> data;
+
+        float at(int x, int y, int c) const
+        {
+            x = ((x % width) + width) % width;
+            y = ((y % height) + height) % height;
+            return data[((size_t)y * width + x) * channels + c];
+        }
+
+        float sample(float u, float v, int c) const
+        {
+            float x = u * width - 0.5f, y = v * height - 0.5f;
+            int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+            float fx = x - x0, fy = y - y0;
+            float top = at(x0, y0, c) * (1.0f - fx) + at(x0 + 1, y0, c) * fx;
+            float bottom = at(x0, y0 + 1, c) * (1.0f - fx) + at(x0 + 1, y0 + 1, c) * fx;
+            return top * (1.0f - fy) + bottom * fy;
+        }
+    };
+
+    // False without a message when the map simply isn't shipped
+    bool loadPlane(const std::string& path, int channels, Plane& plane)
+    {
+        if (!std::filesystem::exists(path))
+        {
+            return false;
+        }
+
+        stbi_set_flip_vertically_on_load(true);
+        int sourceChannels;
+        unsigned char* bytes = stbi_load(path.c_str(), &plane.width, &plane.height, &sourceChannels, channels);
+        if (bytes == NULL)
+        {
+            std::cerr << "Error: Failed to load texture: " << path << std::endl;
+            return false;
+        }
+
+        plane.channels = channels;
+        plane.data.resize((size_t)plane.width * plane.height * channels);
+        for (size_t i = 0; i < plane.data.size(); i++)
+        {
+            plane.data[i] = bytes[i] / 255.0f;
+        }
+        stbi_image_free(bytes);
+        return true;
+    }
+
+    // Grey maps, or alpha-only ones with black rgb (how the roughness maps are exported)
+    bool loadScalar(const std::string& path, Plane& plane)
+    {
+        Plane rgba;
+        if (!loadPlane(path, 4, rgba))
+        {
+            return false;
+        }
+
+        bool alphaOnly = true;
+        for (size_t i = 0; i < rgba.data.size() && alphaOnly; i += 4)
+        {
+            alphaOnly = rgba.data[i] == 0.0f && rgba.data[i + 1] == 0.0f && rgba.data[i + 2] == 0.0f;
+        }
+
+        plane.width = rgba.width;
+        plane.height = rgba.height;
+        plane.channels = 1;
+        plane.data.resize((size_t)plane.width * plane.height);
+        for (size_t i = 0; i < plane.data.size(); i++)
+        {
+            plane.data[i] = rgba.data[i * 4 + (alphaOnly ? 3 : 0)];
+        }
+        return true;
+    }
+
+    unsigned char toByte(float value)
+    {
+        return (unsigned char)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+    }
+
+    // Cavity term: texels below the average height of their neighbourhood get darker
+    Plane occlusion(const Plane& height, float strength, float radius)
+    {
+        int w = height.width, h = height.height;
+        int r = std::max(1, (int)std::lround(w * radius));
+
+        // Summed area table, clamped at the borders
+        std::vector<double> sums((size_t)(w + 1) * (h + 1), 0.0);
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                sums[(size_t)(y + 1) * (w + 1) + x + 1] = height.at(x, y, 0) + sums[(size_t)y * (w + 1) + x + 1] +
+                                                          sums[(size_t)(y + 1) * (w + 1) + x] - sums[(size_t)y * (w + 1) + x];
+            }
+        }
+
+        Plane ao;
+        ao.width = w;
+        ao.height = h;
+        ao.channels = 1;
+        ao.data.resize((size_t)w * h);
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                int x0 = std::max(x - r, 0), x1 = std::min(x + r + 1, w);
+                int y0 = std::max(y - r, 0), y1 = std::min(y + r + 1, h);
+                double sum = sums[(size_t)y1 * (w + 1) + x1] - sums[(size_t)y0 * (w + 1) + x1] -
+                             sums[(size_t)y1 * (w + 1) + x0] + sums[(size_t)y0 * (w + 1) + x0];
+                float mean = (float)(sum / ((x1 - x0) * (y1 - y0)));
+                ao.data[(size_t)y * w + x] = std::clamp(1.0f - strength * std::max(mean - height.at(x, y, 0), 0.0f), 0.0f, 1.0f);
+            }
+        }
+        return ao;
+    }
+
+    // 2x2 box filter down to 1x1. With normalXY the first two channels hold a tangent space normal
+    // that is averaged as a unit vector and renormalized.
+    void buildMips(CookedImage& image, bool normalXY)
+    {
+        int w = image.width, h = image.height, c = image.channels;
+        while (w > 1 || h > 1)
+        {
+            const std::vector<unsigned char>& source = image.mips.back();
+            int mw = std::max(w / 2, 1), mh = std::max(h / 2, 1);
+            std::vector<unsigned char> mip((size_t)mw * mh * c);
+
+            for (int y = 0; y < mh; y++)
+            {
+                for (int x = 0; x < mw; x++)
+                {
+                    const unsigned char* texels[4];
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int sx = std::min(x * 2 + (k & 1), w - 1), sy = std::min(y * 2 + (k >> 1), h - 1);
+                        texels[k] = &source[((size_t)sy * w + sx) * c];
+                    }
+
+                    unsigned char* out = &mip[((size_t)y * mw + x) * c];
+                    int first = 0;
+                    if (normalXY)
+                    {
+                        glm::vec3 normal(0.0f);
+                        for (const unsigned char* texel : texels)
+                        {
+                            glm::vec2 xy = glm::vec2(texel[0], texel[1]) / 255.0f * 2.0f - 1.0f;
+                            normal += glm::vec3(xy, std::sqrt(std::max(1.0f - glm::dot(xy, xy), 0.0f)));
+                        }
+                        normal = glm::normalize(normal);
+                        out[0] = toByte(normal.x * 0.5f + 0.5f);
+                        out[1] = toByte(normal.y * 0.5f + 0.5f);
+                        first = 2;
+                    }
+                    for (int ch = first; ch < c; ch++)
+                    {
+                        out[ch] = (unsigned char)((texels[0][ch] + texels[1][ch] + texels[2][ch] + texels[3][ch] + 2) / 4);
+                    }
+                }
+            }
+
+            image.mips.push_back(std::move(mip));
+            w = mw;
+            h = mh;
+        }
+    }
+}
+
+bool CookedImage::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write texture: " << path << std::endl;
+        return false;
+    }
+
+    auto write32 = [&](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    out.write(imageMagic, sizeof(imageMagic));
+    write32(imageVersion);
+    write32(width);
+    write32(height);
+    write32(channels);
+    write32(mips.size());
+    for (const auto& mip : mips)
+    {
+        out.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+    }
+    return (bool)out;
+}
+
+bool CookedImage::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Error: Failed to load texture: " << path << std::endl;
+        return false;
+    }
+
+    auto read32 = [&]() {
+        uint32_t value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, imageMagic, sizeof(magic)) != 0 || read32() != imageVersion)
+    {
+        std::cerr << "Error: " << path << " is not a cooked texture" << std::endl;
+        return false;
+    }
+
+    width = read32();
+    height = read32();
+    channels = read32();
+    mips.resize(read32());
+    int w = width, h = height;
+    for (auto& mip : mips)
+    {
+        mip.resize((size_t)w * h * channels);
+        in.read(reinterpret_cast<char*>(mip.data()), mip.size());
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+
+    if (!in || mips.empty())
+    {
+        std::cerr << "Error: truncated cooked texture: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CookedMaterial::save(const std::string& dir) const
+{
+    std::string descriptor = (std::filesystem::path(dir) / (name + ".mat")).string();
+    std::ofstream out(descriptor);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write material: " << descriptor << std::endl;
+        return false;
+    }
+
+    out << "# Packed material, cooked from " << name << "_*.png" << std::endl;
+    out << "albedo " << name << "_albedo.tex" << std::endl;
+    out << "surface " << name << "_surface.tex" << std::endl;
+
+    return (bool)out && albedo.save((std::filesystem::path(dir) / (name + "_albedo.tex")).string()) &&
+           surface.save((std::filesystem::path(dir) / (name + "_surface.tex")).string());
+}
+
+bool CookedMaterial::load(const std::string& dir, const std::string& materialName)
+{
+    std::ifstream in((std::filesystem::path(dir) / (materialName + ".mat")).string());
+    if (!in)
+    {
+        return false;
+    }
+
+    name = materialName;
+    bool hasAlbedo = false, hasSurface = false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string key, file;
+        if (!(fields >> key >> file) || key[0] == '#')
+        {
+            continue;
+        }
+
+        std::string path = (std::filesystem::path(dir) / file).string();
+        if (key == "albedo")
+        {
+            hasAlbedo = albedo.load(path);
+        }
+        else if (key == "surface")
+        {
+            hasSurface = surface.load(path);
+        }
+    }
+
+    if (!hasAlbedo || !hasSurface)
+    {
+        std::cerr << "Error: incomplete material: " << materialName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MaterialCooker::cook(const std::string& sourceDir, const std::string& name, CookedMaterial& material) const
+{
+    auto source = [&](const char* map) { return (std::filesystem::path(sourceDir) / (name + map)).string(); };
+
+    Plane albedo, normal, roughness, height;
+    if (!loadPlane(source("_albedo.png"), 3, albedo))
+    {
+        std::cerr << "Error: no albedo for material " << name << std::endl;
+        return false;
+    }
+    bool hasNormal = loadPlane(source("_normal.png"), 3, normal);
+    bool hasRoughness = loadScalar(source("_roughness.png"), roughness);
+    bool hasHeight = loadScalar(source("_height.png"), height);
+
+    material.name = name;
+
+    // Albedo, with the occlusion in alpha when a height map gives us one
+    CookedImage& color = material.albedo;
+    color.width = albedo.width;
+    color.height = albedo.height;
+    color.channels = hasHeight ? 4 : 3;
+    color.mips.assign(1, std::vector<unsigned char>((size_t)color.width * color.height * color.channels));
+    Plane ao = hasHeight ? occlusion(height, occlusionStrength, occlusionRadius) : Plane();
+    for (int y = 0; y < color.height; y++)
+    {
+        for (int x = 0; x < color.width; x++)
+        {
+            unsigned char* out = &color.mips[0][((size_t)y * color.width + x) * color.channels];
+            for (int c = 0; c < 3; c++)
+            {
+                out[c] = toByte(albedo.at(x, y, c));
+            }
+            if (hasHeight)
+            {
+                out[3] = toByte(ao.sample((x + 0.5f) / color.width, (y + 0.5f) / color.height, 0));
+            }
+        }
+    }
+    buildMips(color, false);
+
+    // Normal xy, roughness and height at the resolution of the most detailed of them
+    const Plane& reference = hasNormal ? normal : hasHeight ? height : hasRoughness ? roughness : albedo;
+    CookedImage& surface = material.surface;
+    surface.width = reference.width;
+    surface.height = reference.height;
+    surface.channels = 4;
+    surface.mips.assign(1, std::vector<unsigned char>((size_t)surface.width * surface.height * 4));
+    for (int y = 0; y < surface.height; y++)
+    {
+        for (int x = 0; x < surface.width; x++)
+        {
+            float u = (x + 0.5f) / surface.width, v = (y + 0.5f) / surface.height;
+            glm::vec3 n(0.0f, 0.0f, 1.0f);
+            if (hasNormal)
+            {
+                n = glm::vec3(normal.sample(u, v, 0), normal.sample(u, v, 1), normal.sample(u, v, 2)) * 2.0f - 1.0f;
+                n = glm::length(n) > 1e-4f ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+
+            unsigned char* out = &surface.mips[0][((size_t)y * surface.width + x) * 4];
+            out[0] = toByte(n.x * 0.5f + 0.5f);
+            out[1] = toByte(n.y * 0.5f + 0.5f);
+            out[2] = toByte(hasRoughness ? roughness.sample(u, v, 0) : defaultRoughness);
+            out[3] = toByte(hasHeight ? height.sample(u, v, 0) : 0.5f);
+        }
+    }
+    buildMips(surface, true);
+
+    return true;
+}
@@ -1,35 +1,135 @@
 #include "mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices, std::vector<Texture> &textures, Shader &shader)
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+
+// Uniform buffer binding point of the bone palettes
+static const GLuint paletteBinding = 0;
+
+Pool<Mesh>& Mesh::pool()
+{
+	static Pool<Mesh> meshes(MAX_MESHES);
+	return meshes;
+}
+
+Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices, std::vector<Texture> &textures, Shader &shader,
+	const std::vector<SkinVertex> &skin, const std::vector<Bone> &bones)
 	: shader(shader)
 {
 	Mesh::vertices = vertices;
 	Mesh::indices = indices;
 	Mesh::textures = textures;
+	Mesh::skin = skin;
+	Mesh::bones = bones;
 
 	Mesh::shader = shader;
 
+	boundsMin = glm::vec3(0.0f);
+	boundsMax = glm::vec3(0.0f);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		boundsMin = i ? glm::min(boundsMin, vertices[i].position) : vertices[i].position;
+		boundsMax = i ? glm::max(boundsMax, vertices[i].position) : vertices[i].position;
+	}
+	boundsCenter = (boundsMin + boundsMax) * 0.5f;
+	boundsRadius = 0.0f;
+	for (const Vertex& vertex : vertices)
+	{
+		boundsRadius = glm::max(boundsRadius, glm::length(vertex.position - boundsCenter));
+	}
+
 	vao.Bind();
-	VBO VBO(vertices);
+	VBO vbo(vertices);
 	EBO EBO(indices);
 
-	vao.LinkAttrib(VBO, 0, 3, GL_FLOAT, sizeof(Vertex), (void *)0);
-	vao.LinkAttrib(VBO, 1, 3, GL_FLOAT, sizeof(Vertex), (void *)(3 * sizeof(float)));
-	vao.LinkAttrib(VBO, 2, 3, GL_FLOAT, sizeof(Vertex), (void *)(6 * sizeof(float)));
-	vao.LinkAttrib(VBO, 3, 2, GL_FLOAT, sizeof(Vertex), (void *)(9 * sizeof(float)));
+	vao.LinkAttrib(vbo, 0, 3, GL_FLOAT, sizeof(Vertex), (void *)0);
+	vao.LinkAttrib(vbo, 1, 3, GL_FLOAT, sizeof(Vertex), (void *)(3 * sizeof(float)));
+	vao.LinkAttrib(vbo, 2, 3, GL_FLOAT, sizeof(Vertex), (void *)(6 * sizeof(float)));
+	vao.LinkAttrib(vbo, 3, 2, GL_FLOAT, sizeof(Vertex), (void *)(9 * sizeof(float)));
+	vao.LinkAttrib(vbo, 4, 2, GL_FLOAT, sizeof(Vertex), (void *)(11 * sizeof(float)));
+
+	// Skinned meshes read their bones from a second stream, the vertex layout stays the same
+	if (!bones.empty() && (int)bones.size() <= MAX_BONES && skin.size() == vertices.size())
+	{
+		VBO skinVBO(Mesh::skin);
+		vao.LinkAttribI(skinVBO, 5, 4, GL_UNSIGNED_BYTE, sizeof(SkinVertex), (void *)offsetof(SkinVertex, joints));
+		vao.LinkAttrib(skinVBO, 6, 4, GL_FLOAT, sizeof(SkinVertex), (void *)offsetof(SkinVertex, weights));
+
+		pose.assign(bones.size(), glm::mat4(1.0f));
+		glGenBuffers(1, &palette);
+		glBindBuffer(GL_UNIFORM_BUFFER, palette);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_BONES * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, pose.size() * sizeof(glm::mat4), pose.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
 
 	vao.Unbind();
-	VBO.Unbind();
+	vbo.Unbind();
 	EBO.Unbind();
 }
 
+void Mesh::setPose(const std::vector<glm::mat4> &jointMatrices)
+{
+	if (!skinned())
+	{
+		return;
+	}
+	for (size_t i = 0; i < bones.size(); i++)
+	{
+		int joint = bones[i].joint;
+		pose[i] = joint < (int)jointMatrices.size() ? jointMatrices[joint] : glm::mat4(1.0f);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, palette);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, pose.size() * sizeof(glm::mat4), pose.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Mesh::BindPalette(Shader &target)
+{
+	glUniform1i(glGetUniformLocation(target.ID, "skinEnabled"), skinned());
+	if (!skinned())
+	{
+		return;
+	}
+	GLuint block = glGetUniformBlockIndex(target.ID, "Joints");
+	if (block != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(target.ID, block, paletteBinding);
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, paletteBinding, palette);
+}
+
 void Mesh::Draw(Camera &camera)
 {
 	shader.Activate();
 	vao.Bind();
+	BindTextures();
+	BindPalette(shader);
+
+	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
+	camera.Matrix(shader, "camMatrix");
+
+
+	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+}
+
+void Mesh::Bind()
+{
+	vao.Bind();
+	BindTextures();
+	BindPalette(shader);
+}
+
+void Mesh::DrawBound()
+{
+	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+}
 
+void Mesh::BindTextures()
+{
 	unsigned int numDiffuse = 0;
 	unsigned int numSpecular = 0;
+	unsigned int numSurface = 0;
 
 	for (unsigned int i = 0; i < textures.size(); i++)
 	{
@@ -43,13 +143,20 @@ void Mesh::Draw(Camera &camera)
 		{
 			num = std::to_string(numSpecular++);
 		}
+		else if (type == "surface")
+		{
+			num = std::to_string(numSurface++);
+		}
 		textures[i].texUnit(shader, (type + num).c_str(), i);
 		textures[i].Bind();
 	}
+	// Packed materials replace the specular map with the surface texture (normal, roughness, height)
+	glUniform1i(glGetUniformLocation(shader.ID, "surfaceMapped"), numSurface > 0);
+}
 
-	glUniform3f(glGetUniformLocation(shader.ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
-	camera.Matrix(shader, "camMatrix");
-
-
+void Mesh::DrawDepth(Shader &depthShader)
+{
+	vao.Bind();
+	BindPalette(depthShader);
 	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
 }
\ No newline at end of file
@@ -1,11 +1,29 @@
 #include "model.h"
 #include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+// assimp matrices are row major
+static glm::mat4 toGlm(const aiMatrix4x4& m)
+{
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
 
 Model::Model(std::string const &path, Shader &shader) : shader(shader)
 {
     loadModel(path);
 }
 
+void Model::setPose(const std::vector<glm::mat4>& jointMatrices)
+{
+    for (MeshHandle mesh : meshes)
+    {
+        if (Mesh* target = mesh.get())
+        {
+            target->setPose(jointMatrices);
+        }
+    }
+}
+
 
 void Model::loadModel(std::string const &path)
 {
@@ -39,7 +57,7 @@ void Model::processNode(aiNode *node, const aiScene *scene)
 
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
+MeshHandle Model::processMesh(aiMesh *mesh, const aiScene *scene)
 {
     // data to fill
     std::vector<Vertex> vertices;
@@ -88,6 +106,16 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         for(unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
     }
+    // bones and the strongest influences of every vertex
+    std::vector<SkinVertex> skin;
+    std::vector<Mesh::Bone> bones;
+    if (mesh->HasBones())
+    {
+        if ((int)mesh->mNumBones > Mesh::MAX_BONES)
+            std::cerr << "Error: " << mesh->mName.C_Str() << " has more than " << Mesh::MAX_BONES << " bones, drawn in bind pose" << std::endl;
+        else
+            processSkin(mesh, skin, bones);
+    }
     // process materials
     aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
@@ -96,7 +124,47 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
     std::vector<Texture> specularMaps = loadMaterialTextures(material, scene, aiTextureType_SPECULAR, "specular");
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
-    return Mesh(vertices, indices, textures, shader);
+    return Mesh::pool().create(vertices, indices, textures, shader, skin, bones);
+}
+
+void Model::processSkin(aiMesh *mesh, std::vector<SkinVertex>& skin, std::vector<Mesh::Bone>& bones)
+{
+    skin.assign(mesh->mNumVertices, SkinVertex());
+    for(unsigned int b = 0; b < mesh->mNumBones; b++)
+    {
+        const aiBone* bone = mesh->mBones[b];
+        std::string name = bone->mName.C_Str();
+        int joint = 0;
+        while (joint < (int)joints.size() && joints[joint] != name)
+            joint++;
+        if (joint == (int)joints.size())
+            joints.push_back(name);
+        bones.push_back({name, joint, toGlm(bone->mOffsetMatrix)});
+
+        // keep the 4 strongest weights, replacing the weakest one
+        for(unsigned int w = 0; w < bone->mNumWeights; w++)
+        {
+            SkinVertex& vertex = skin[bone->mWeights[w].mVertexId];
+            int weakest = 0;
+            for(int k = 1; k < 4; k++)
+                if (vertex.weights[k] < vertex.weights[weakest])
+                    weakest = k;
+            if (bone->mWeights[w].mWeight > vertex.weights[weakest])
+            {
+                vertex.joints[weakest] = (glm::uint8)b;
+                vertex.weights[weakest] = bone->mWeights[w].mWeight;
+            }
+        }
+    }
+    // unskinned vertices follow the first bone
+    for (auto& vertex : skin)
+    {
+        float total = vertex.weights.x + vertex.weights.y + vertex.weights.z + vertex.weights.w;
+        if (total > 0.0f)
+            vertex.weights /= total;
+        else
+            vertex.weights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    }
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, const aiScene *scene, aiTextureType type, std::string typeName)
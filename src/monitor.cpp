@@ -0,0 +1,132 @@
+#include "monitor.h"
+
+#include <algorithm>
+#include <iostream>
+
+int MonitorSystem::addMonitor(const glm::vec3& position, const glm::vec3& target, int width, int height,
+                              float refreshRate, float FOVdeg)
+{
+    Monitor monitor{Camera(width, height, position, FOVdeg, 0.1f, 100.0f), 1.0f / refreshRate};
+    monitor.camera.updateMatrix(FOVdeg, 0.1f, 100.0f, target);
+
+    glGenTextures(1, &monitor.texture);
+    glBindTexture(GL_TEXTURE_2D, monitor.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &monitor.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, monitor.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &monitor.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, monitor.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, monitor.texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, monitor.depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Error: monitor framebuffer is incomplete" << std::endl;
+    }
+
+    // Black until the first refresh
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    monitors_.push_back(monitor);
+    return (int)monitors_.size() - 1;
+}
+
+Texture MonitorSystem::texture(int monitor) const
+{
+    Texture texture;
+    texture.ID = monitors_[monitor].texture;
+    texture.type = "diffuse";
+    texture.unit = 0;
+    return texture;
+}
+
+void MonitorSystem::render(Node& root, const Camera& viewer, double time, PortalSystem* portals,
+                           OcclusionCuller* occlusion)
+{
+    // Which screens are seen is decided first, from the viewer's state, before any monitor
+    // overwrites the portal and occlusion results with its own view
+    Frustum frustum(viewer.cameraMatrix);
+    std::vector<Monitor*> due;
+    visibleMonitors = 0;
+    for (auto& monitor : monitors_)
+    {
+        glm::vec3 boundsMin, boundsMax;
+        if (!monitor.screen || monitor.screen->culled() || !monitor.screen->bounds(boundsMin, boundsMax) ||
+            !frustum.visible(boundsMin, boundsMax) || (occlusion && !occlusion->visible(boundsMin, boundsMax)))
+        {
+            continue;
+        }
+        visibleMonitors++;
+        if (time - monitor.lastRefresh >= monitor.refreshInterval)
+        {
+            due.push_back(&monitor);
+        }
+    }
+
+    std::sort(due.begin(), due.end(), [&](const Monitor* a, const Monitor* b) {
+        return time - a->lastRefresh - a->refreshInterval > time - b->lastRefresh - b->refreshInterval;
+    });
+    if ((int)due.size() > maxRefreshesPerFrame)
+    {
+        due.resize(maxRefreshesPerFrame);
+    }
+    refreshes = (int)due.size();
+    if (due.empty())
+    {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    for (Monitor* monitor : due)
+    {
+        if (portals)
+        {
+            portals->update(monitor->camera.cameraMatrix, monitor->camera.Position);
+        }
+        if (occlusion)
+        {
+            occlusion->render(monitor->camera.cameraMatrix);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, monitor->fbo);
+        glViewport(0, 0, monitor->camera.width, monitor->camera.height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // A screen can't show its own picture while it is being drawn
+        bool screenCulled = monitor->screen->culled();
+        monitor->screen->setCulled(true);
+        root.draw(monitor->camera, occlusion);
+        monitor->screen->setCulled(screenCulled);
+
+        monitor->lastRefresh = time;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void MonitorSystem::Delete()
+{
+    for (auto& monitor : monitors_)
+    {
+        glDeleteFramebuffers(1, &monitor.fbo);
+        glDeleteRenderbuffers(1, &monitor.depth);
+        glDeleteTextures(1, &monitor.texture);
+    }
+    monitors_.clear();
+}
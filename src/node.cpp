@@ -2,43 +2,283 @@
 #include "mesh.h"
 #include <iostream>
 
-Node::Node(const glm::mat4 &transform) : transform_(transform)
+Node::Node(const glm::mat4 &transform) : transform_(transforms().create(transform))
 {
-    children_ = std::vector<Node *>();
 }
 
-void Node::add(Node *node)
+Pool<Node>& Node::pool()
 {
-    children_.push_back(node);
+    static Pool<Node> nodes(MAX_NODES);
+    return nodes;
 }
 
-void Node::add(Mesh *mesh)
+TransformSystem& Node::transforms()
 {
-    children_mesh_.push_back(mesh);
+    static TransformSystem system(MAX_NODES);
+    return system;
 }
 
-void Node::draw(Camera& camera, const glm::mat4& parentTransform)
+NodeHandle Node::create(const glm::mat4 &transform)
 {
-    glm::mat4 modelMatrix = parentTransform * transform_;
+    NodeHandle handle = pool().create(transform);
+    if (!handle)
+    {
+        std::cerr << "Error: out of scene nodes, MAX_NODES is " << MAX_NODES << std::endl;
+        return handle;
+    }
+    handle->self_ = handle;
+    return handle;
+}
+
+void Node::destroy(NodeHandle handle)
+{
+    Node *node = handle.get();
+    if (!node)
+    {
+        return;
+    }
+    while (node->firstChild_)
+    {
+        destroy(node->firstChild_);
+    }
+    node->detach();
+    transforms().destroy(node->transform_);
+    pool().destroy(handle);
+}
+
+void Node::detach()
+{
+    Node *parent = parent_.get();
+    if (!parent)
+    {
+        return;
+    }
+    Node *before = previousSibling_.get();
+    Node *after = nextSibling_.get();
+    (before ? before->nextSibling_ : parent->firstChild_) = nextSibling_;
+    (after ? after->previousSibling_ : parent->lastChild_) = previousSibling_;
+    previousSibling_ = nextSibling_ = NodeHandle();
+    parent_ = NodeHandle();
+    transforms().setParent(transform_, -1);
+    invalidateBounds(parent->self_);
+}
+
+void Node::add(NodeHandle handle)
+{
+    Node *node = handle.get();
+    if (!node)
+    {
+        std::cerr << "Error: adding a destroyed node" << std::endl;
+        return;
+    }
+    node->detach();
+    Node *last = lastChild_.get();
+    (last ? last->nextSibling_ : firstChild_) = handle;
+    node->previousSibling_ = lastChild_;
+    lastChild_ = handle;
+    node->parent_ = self_;
+    transforms().setParent(node->transform_, transform_);
+    node->invalidate();
+}
+
+void Node::add(MeshHandle mesh)
+{
+    if (!mesh)
+    {
+        std::cerr << "Error: adding a destroyed mesh" << std::endl;
+        return;
+    }
+    if (meshCount_ == MAX_MESHES_PER_NODE)
+    {
+        std::cerr << "Error: a node draws at most " << MAX_MESHES_PER_NODE << " meshes, put the others on child nodes" << std::endl;
+        return;
+    }
+    meshes_[meshCount_++] = mesh;
+    invalidate();
+}
+
+void Node::invalidate()
+{
+    transformDirty_ = true;
+    invalidateBounds(parent_);
+}
+
+void Node::invalidateBounds(NodeHandle handle)
+{
+    // Stops at the first node already waiting for a refit, the ones above it are too
+    for (Node *node = handle.get(); node && !node->boundsDirty_; node = node->parent_.get())
+    {
+        node->boundsDirty_ = true;
+    }
+}
+
+void Node::updateBounds()
+{
+    transforms().update();
+    refit(false);
+}
+
+void Node::refit(bool force)
+{
+    force = force || transformDirty_;
+    if (force)
+    {
+        const glm::mat4& worldMatrix = world();
+        scale_ = glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::max(glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))));
+
+        // Box of the transformed box: the world extent sums the absolute matrix columns
+        hasOwnBounds_ = false;
+        for (int i = 0; i < meshCount_; i++)
+        {
+            Mesh* mesh = meshes_[i].get();
+            if (!mesh)
+            {
+                continue;
+            }
+            glm::vec3 center = glm::vec3(worldMatrix * glm::vec4((mesh->boundsMin + mesh->boundsMax) * 0.5f, 1.0f));
+            glm::vec3 local = (mesh->boundsMax - mesh->boundsMin) * 0.5f;
+            glm::vec3 extent = glm::abs(glm::vec3(worldMatrix[0])) * local.x + glm::abs(glm::vec3(worldMatrix[1])) * local.y +
+                               glm::abs(glm::vec3(worldMatrix[2])) * local.z;
+            ownMin_ = hasOwnBounds_ ? glm::min(ownMin_, center - extent) : center - extent;
+            ownMax_ = hasOwnBounds_ ? glm::max(ownMax_, center + extent) : center + extent;
+            hasOwnBounds_ = true;
+        }
+    }
+    else if (!boundsDirty_)
+    {
+        return;
+    }
+
+    hasSubtreeBounds_ = hasOwnBounds_;
+    subtreeMin_ = ownMin_;
+    subtreeMax_ = ownMax_;
+    for (Node* child = firstChild_.get(); child; child = child->nextSibling_.get())
+    {
+        child->refit(force);
+        if (child->hasSubtreeBounds_)
+        {
+            subtreeMin_ = hasSubtreeBounds_ ? glm::min(subtreeMin_, child->subtreeMin_) : child->subtreeMin_;
+            subtreeMax_ = hasSubtreeBounds_ ? glm::max(subtreeMax_, child->subtreeMax_) : child->subtreeMax_;
+            hasSubtreeBounds_ = true;
+        }
+    }
+
+    transformDirty_ = false;
+    boundsDirty_ = false;
+}
+
+bool Node::bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+    boundsMin = subtreeMin_;
+    boundsMax = subtreeMax_;
+    return hasSubtreeBounds_;
+}
+
+void Node::draw(Camera& camera, OcclusionCuller* occlusion)
+{
+    static DrawList list;
+    list.build(*this, camera.cameraMatrix, occlusion);
+    list.submit(camera);
+}
+
+bool Node::cull(const Frustum& frustum, OcclusionCuller* occlusion, bool& inside, std::vector<DrawList::Item>& items) const
+{
+    if (culled_ || !hasSubtreeBounds_)
+    {
+        return false;
+    }
+    // Once a subtree is fully inside, nothing below it needs testing
+    if (!inside && !frustum.visible(subtreeMin_, subtreeMax_, &inside))
+    {
+        return false;
+    }
+    if (occlusion && hasOwnBounds_ && !occlusion->visible(ownMin_, ownMax_))
+    {
+        return true;
+    }
 
-    for (auto* mesh : children_mesh_)
+    const glm::mat4& worldMatrix = world();
+    for (int i = 0; i < meshCount_; i++)
     {
-        mesh->shader.Activate();
-        glUniformMatrix4fv(glGetUniformLocation(mesh->shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        Mesh* mesh = meshes_[i].get();
+        // Imported models keep many meshes on one node, their spheres sort them out
+        if (!mesh || (!inside && meshCount_ > 1 &&
+            !frustum.visible(glm::vec3(worldMatrix * glm::vec4(mesh->boundsCenter, 1.0f)), mesh->boundsRadius * scale_)))
+        {
+            continue;
+        }
+        items.push_back({DrawList::key(*mesh), mesh, worldMatrix});
+    }
+    return true;
+}
 
-        mesh->Draw(camera);
+void Node::collectVisible(const Frustum& frustum, OcclusionCuller* occlusion, bool inside, std::vector<DrawList::Item>& items) const
+{
+    if (!cull(frustum, occlusion, inside, items))
+    {
+        return;
     }
+    for (const Node* child = firstChild_.get(); child; child = child->nextSibling_.get())
+    {
+        child->collectVisible(frustum, occlusion, inside, items);
+    }
+}
+
+void Node::addOccluders(OcclusionCuller& occlusion) const
+{
+    transforms().update();
+    collectOccluders(occlusion);
+}
 
-    for (auto* child : children_)
+void Node::collectOccluders(OcclusionCuller& occlusion) const
+{
+    if (occluder_)
     {
-        child->draw(camera, modelMatrix);
+        const glm::mat4& modelMatrix = world();
+        for (int i = 0; i < meshCount_; i++)
+        {
+            Mesh* mesh = meshes_[i].get();
+            if (!mesh)
+            {
+                continue;
+            }
+            std::vector<glm::vec3> positions;
+            for (const auto& vertex : mesh->vertices)
+            {
+                positions.push_back(glm::vec3(modelMatrix * glm::vec4(vertex.position, 1.0f)));
+            }
+            occlusion.addOccluder(positions, mesh->indices);
+        }
     }
+
+    for (Node* child = firstChild_.get(); child; child = child->nextSibling_.get())
+    {
+        child->collectOccluders(occlusion);
+    }
+}
+
+void Node::drawDepth(Shader& shader, bool dynamicCasters)
+{
+    transforms().update();
+    drawCasters(shader, dynamicCasters);
 }
 
-void Node::key_handler(int key) const
+void Node::drawCasters(Shader& shader, bool dynamicCasters)
 {
-    for (const auto &child : children_)
+    if (castShadows_ && dynamic_ == dynamicCasters && meshCount_ > 0)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(world()));
+        for (int i = 0; i < meshCount_; i++)
+        {
+            if (Mesh* mesh = meshes_[i].get())
+            {
+                mesh->DrawDepth(shader);
+            }
+        }
+    }
+
+    for (Node* child = firstChild_.get(); child; child = child->nextSibling_.get())
     {
-        child->key_handler(key);
+        child->drawCasters(shader, dynamicCasters);
     }
 }
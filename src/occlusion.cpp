@@ -0,0 +1,382 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "jobSystem.h"
+#include "simd.h"
+
+static const int tileWidth = 16;
+static const int tileHeight = 16;
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : width_((std::max(width, 1) + tileWidth - 1) / tileWidth * tileWidth), height_(std::max(height, 1))
+{
+    tilesX_ = width_ / tileWidth;
+    tilesY_ = (height_ + tileHeight - 1) / tileHeight;
+    bins_.resize((size_t)tilesX_ * tilesY_);
+    tileFarthest_.assign(bins_.size(), 0.0f);
+    depth_.assign((size_t)width_ * height_, 0.0f);
+}
+
+void OcclusionCuller::addOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+    struct Face
+    {
+        unsigned int corners[3];
+        glm::vec3 normal;
+        bool merged = false;
+    };
+
+    std::vector<Face> faces;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        Face face;
+        for (int k = 0; k < 3; k++)
+        {
+            face.corners[k] = indices[i + k];
+        }
+        glm::vec3 normal = glm::cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]);
+        // Degenerate triangles (unused vertex slots) occlude nothing
+        if (glm::length(normal) < 1e-8f)
+        {
+            continue;
+        }
+        face.normal = glm::normalize(normal);
+        faces.push_back(face);
+    }
+
+    // Triangles by edge, to find the other half of each quad
+    std::map<std::pair<unsigned int, unsigned int>, std::vector<size_t>> edges;
+    for (size_t f = 0; f < faces.size(); f++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            edges[std::minmax(faces[f].corners[k], faces[f].corners[(k + 1) % 3])].push_back(f);
+        }
+    }
+
+    for (size_t f = 0; f < faces.size(); f++)
+    {
+        if (faces[f].merged)
+        {
+            continue;
+        }
+        faces[f].merged = true;
+
+        Occluder occluder;
+        occluder.count = 3;
+        for (int k = 0; k < 3; k++)
+        {
+            occluder.corners[k] = positions[faces[f].corners[k]];
+        }
+
+        for (int k = 0; k < 3 && occluder.count == 3; k++)
+        {
+            unsigned int p = faces[f].corners[k], q = faces[f].corners[(k + 1) % 3];
+            for (size_t other : edges[std::minmax(p, q)])
+            {
+                const Face& neighbour = faces[other];
+                if (neighbour.merged || std::abs(glm::dot(neighbour.normal, faces[f].normal)) < 0.999f)
+                {
+                    continue;
+                }
+
+                // Quad p, (neighbour's third corner), q, (our third corner) in our winding
+                unsigned int apex = neighbour.corners[0] ^ neighbour.corners[1] ^ neighbour.corners[2] ^ p ^ q;
+                glm::vec3 quad[4] = {positions[p], positions[apex], positions[q], positions[faces[f].corners[(k + 2) % 3]]};
+                bool convex = true;
+                for (int c = 0; c < 4 && convex; c++)
+                {
+                    glm::vec3 turn = glm::cross(quad[(c + 1) % 4] - quad[c], quad[(c + 2) % 4] - quad[(c + 1) % 4]);
+                    convex = glm::dot(turn, faces[f].normal) > 0.0f;
+                }
+                if (convex)
+                {
+                    faces[other].merged = true;
+                    std::copy(quad, quad + 4, occluder.corners);
+                    occluder.count = 4;
+                    break;
+                }
+            }
+        }
+        occluders_.push_back(occluder);
+    }
+}
+
+void OcclusionCuller::render(const glm::mat4& viewProjection)
+{
+    viewProjection_ = viewProjection;
+    tested = 0;
+    culled = 0;
+
+    polygons_.clear();
+    for (const Occluder& occluder : occluders_)
+    {
+        glm::vec4 clip[4];
+        for (int k = 0; k < occluder.count; k++)
+        {
+            clip[k] = viewProjection * glm::vec4(occluder.corners[k], 1.0f);
+        }
+
+        // Clip against the near plane (z = -w), which adds at most one corner
+        glm::vec4 polygon[5];
+        int count = 0;
+        for (int k = 0; k < occluder.count; k++)
+        {
+            const glm::vec4& p = clip[k];
+            const glm::vec4& q = clip[(k + 1) % occluder.count];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+            {
+                polygon[count++] = p;
+            }
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+            {
+                polygon[count++] = p + (q - p) * (dp / (dp - dq));
+            }
+        }
+        if (count >= 3)
+        {
+            setup(polygon, count);
+        }
+    }
+
+    // Bin by tile
+    size_t binned = 0;
+    for (auto& bin : bins_)
+    {
+        bin.clear();
+    }
+    for (unsigned int p = 0; p < polygons_.size(); p++)
+    {
+        const glm::ivec4& bounds = polygons_[p].bounds;
+        for (int ty = bounds.y / tileHeight; ty <= bounds.w / tileHeight; ty++)
+        {
+            for (int tx = bounds.x / tileWidth; tx <= bounds.z / tileWidth; tx++)
+            {
+                bins_[(size_t)ty * tilesX_ + tx].push_back(p);
+                binned++;
+            }
+        }
+    }
+
+    // Tiles own disjoint pixels, so they rasterize independently
+    int tileCount = (int)bins_.size();
+    JobSystem& jobs = JobSystem::shared();
+    if (!jobs.worthSplitting(binned, parallelThreshold))
+    {
+        for (int tile = 0; tile < tileCount; tile++)
+        {
+            rasterizeTile(tile);
+        }
+        return;
+    }
+
+    // A job per tile, the busy ones around the occluders get spread by stealing
+    jobs.parallelFor(tileCount, 1, [this](int begin, int end) {
+        for (int tile = begin; tile < end; tile++)
+        {
+            rasterizeTile(tile);
+        }
+    });
+}
+
+void OcclusionCuller::setup(const glm::vec4* clip, int count)
+{
+    // Screen position in pixels and 1/w
+    glm::vec3 screen[5];
+    glm::vec2 boundsMin(1e30f), boundsMax(-1e30f);
+    for (int k = 0; k < count; k++)
+    {
+        float invW = 1.0f / clip[k].w;
+        screen[k] = glm::vec3((clip[k].x * invW * 0.5f + 0.5f) * width_, (clip[k].y * invW * 0.5f + 0.5f) * height_, invW);
+        boundsMin = glm::min(boundsMin, glm::vec2(screen[k]));
+        boundsMax = glm::max(boundsMax, glm::vec2(screen[k]));
+    }
+
+    Polygon polygon;
+    polygon.bounds = glm::ivec4(std::max((int)std::floor(boundsMin.x), 0), std::max((int)std::floor(boundsMin.y), 0),
+                                std::min((int)std::ceil(boundsMax.x), width_ - 1), std::min((int)std::ceil(boundsMax.y), height_ - 1));
+    if (polygon.bounds.x > polygon.bounds.z || polygon.bounds.y > polygon.bounds.w)
+    {
+        return;
+    }
+
+    float area = 0.0f;
+    int widest = 1;
+    float widestArea = 0.0f;
+    for (int k = 1; k + 1 < count; k++)
+    {
+        float fan = (screen[k].x - screen[0].x) * (screen[k + 1].y - screen[0].y) -
+                    (screen[k + 1].x - screen[0].x) * (screen[k].y - screen[0].y);
+        area += fan;
+        if (std::abs(fan) > std::abs(widestArea))
+        {
+            widestArea = fan;
+            widest = k;
+        }
+    }
+    if (std::abs(area) < 1e-6f)
+    {
+        return;
+    }
+
+    // 1/w plane from the widest fan triangle, lowered to the farthest value it reaches inside the pixel
+    const glm::vec3& a = screen[0];
+    const glm::vec3& b = screen[widest];
+    const glm::vec3& c = screen[widest + 1];
+    float dx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / widestArea;
+    float dy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / widestArea;
+    polygon.depth = glm::vec3(dx, dy, a.z - dx * a.x - dy * a.y - 0.5f * (std::abs(dx) + std::abs(dy)));
+
+    // Occluders count from both sides, clockwise ones are walked backwards
+    if (area < 0.0f)
+    {
+        std::reverse(screen, screen + count);
+    }
+
+    // Edge functions, positive inside. Shifting by half the pixel's extent along the normal keeps
+    // only pixels the polygon covers entirely.
+    for (int e = 0; e < 5; e++)
+    {
+        if (e >= count)
+        {
+            polygon.edges[e] = glm::vec3(0.0f, 0.0f, 1.0f);
+            continue;
+        }
+        const glm::vec3& p = screen[e];
+        const glm::vec3& q = screen[(e + 1) % count];
+        float A = p.y - q.y, B = q.x - p.x;
+        polygon.edges[e] = glm::vec3(A, B, -(A * p.x + B * p.y) - 0.5f * (std::abs(A) + std::abs(B)));
+    }
+
+    polygons_.push_back(polygon);
+}
+
+void OcclusionCuller::rasterizeTile(int tile)
+{
+    int tileX = (tile % tilesX_) * tileWidth, tileY = (tile / tilesX_) * tileHeight;
+    int tileRight = tileX + tileWidth - 1, tileTop = std::min(tileY + tileHeight, height_) - 1;
+
+    for (int y = tileY; y <= tileTop; y++)
+    {
+        std::fill_n(&depth_[(size_t)y * width_ + tileX], tileWidth, 0.0f);
+    }
+
+    const Float4 laneOffset(0.5f, 1.5f, 2.5f, 3.5f);
+    const Float4 zero(0.0f);
+    for (unsigned int index : bins_[tile])
+    {
+        const Polygon& polygon = polygons_[index];
+        int x0 = std::max(polygon.bounds.x, tileX) & ~3, x1 = std::min(polygon.bounds.z, tileRight);
+        int y0 = std::max(polygon.bounds.y, tileY), y1 = std::min(polygon.bounds.w, tileTop);
+
+        Float4 edgeX[5], edgeRow[5];
+        for (int e = 0; e < 5; e++)
+        {
+            edgeX[e] = Float4(polygon.edges[e].x);
+        }
+        const Float4 zx(polygon.depth.x);
+
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = (float)y + 0.5f;
+            for (int e = 0; e < 5; e++)
+            {
+                edgeRow[e] = Float4(polygon.edges[e].y * py + polygon.edges[e].z);
+            }
+            Float4 rowZ(polygon.depth.y * py + polygon.depth.z);
+            float* row = &depth_[(size_t)y * width_];
+            for (int x = x0; x <= x1; x += 4)
+            {
+                Float4 px = Float4((float)x) + laneOffset;
+                Float4 inside = (edgeX[0] * px + edgeRow[0] >= zero) & (edgeX[1] * px + edgeRow[1] >= zero) &
+                                (edgeX[2] * px + edgeRow[2] >= zero) & (edgeX[3] * px + edgeRow[3] >= zero) &
+                                (edgeX[4] * px + edgeRow[4] >= zero);
+                Float4 z = zx * px + rowZ;
+                Float4 current = Float4::load(row + x);
+                Float4 write = inside & (z > current);
+                if (movemask(write))
+                {
+                    select(write, z, current).store(row + x);
+                }
+            }
+        }
+    }
+
+    float farthest = depth_[(size_t)tileY * width_ + tileX];
+    for (int y = tileY; y <= tileTop; y++)
+    {
+        const float* row = &depth_[(size_t)y * width_ + tileX];
+        farthest = std::min(farthest, *std::min_element(row, row + tileWidth));
+    }
+    tileFarthest_[tile] = farthest;
+}
+
+bool OcclusionCuller::visible(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    tested++;
+
+    glm::vec2 screenMin(1e30f), screenMax(-1e30f);
+    float nearest = 0.0f;
+    for (int k = 0; k < 8; k++)
+    {
+        glm::vec3 corner((k & 1) ? boundsMax.x : boundsMin.x, (k & 2) ? boundsMax.y : boundsMin.y, (k & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = viewProjection_ * glm::vec4(corner, 1.0f);
+        // Reaches behind the camera, the projection can't bound it
+        if (clip.w <= 1e-5f)
+        {
+            return true;
+        }
+        float invW = 1.0f / clip.w;
+        glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * width_, (clip.y * invW * 0.5f + 0.5f) * height_);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearest = std::max(nearest, invW);
+    }
+
+    // Every pixel the rectangle touches
+    int x0 = std::max((int)std::floor(screenMin.x), 0), x1 = std::min((int)std::ceil(screenMax.x) - 1, width_ - 1);
+    int y0 = std::max((int)std::floor(screenMin.y), 0), y1 = std::min((int)std::ceil(screenMax.y) - 1, height_ - 1);
+    x1 = std::max(x1, std::min((int)std::floor(screenMin.x), width_ - 1));
+    y1 = std::max(y1, std::min((int)std::floor(screenMin.y), height_ - 1));
+    if (x0 > x1 || y0 > y1)
+    {
+        culled++;
+        return false;
+    }
+
+    const Float4 laneOffset(0.0f, 1.0f, 2.0f, 3.0f);
+    const Float4 boxDepth(nearest), left((float)x0), right((float)x1);
+    for (int ty = y0 / tileHeight; ty <= y1 / tileHeight; ty++)
+    {
+        for (int tx = x0 / tileWidth; tx <= x1 / tileWidth; tx++)
+        {
+            int tile = ty * tilesX_ + tx;
+            if (tileFarthest_[tile] > nearest)
+            {
+                continue;
+            }
+
+            int rowStart = std::max(x0, tx * tileWidth) & ~3, rowEnd = std::min(x1, tx * tileWidth + tileWidth - 1);
+            for (int y = std::max(y0, ty * tileHeight); y <= std::min(y1, ty * tileHeight + tileHeight - 1); y++)
+            {
+                const float* row = &depth_[(size_t)y * width_];
+                for (int x = rowStart; x <= rowEnd; x += 4)
+                {
+                    Float4 px = Float4((float)x) + laneOffset;
+                    Float4 open = (px >= left) & (px <= right) & (Float4::load(row + x) <= boxDepth);
+                    if (movemask(open))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    culled++;
+    return false;
+}
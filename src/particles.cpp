@@ -0,0 +1,310 @@
+#include "particles.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "frustum.h"
+#include "jobSystem.h"
+#include "simd.h"
+
+static float random01(uint32_t& state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+static float randomSigned(uint32_t& state)
+{
+    return random01(state) * 2.0f - 1.0f;
+}
+
+ParticleSystem::ParticleSystem(int maxInstances)
+    : maxInstances_(maxInstances), shader_("./shaders/particle.vert", "./shaders/particle.frag")
+{
+    instances_.resize(maxInstances_);
+
+    // The quad corners come from gl_VertexID, only the instances have attributes
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &instanceBuffer_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances_ * sizeof(Instance), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, positionSize));
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), (void*)offsetof(Instance, color));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int ParticleSystem::addEmitter(const Emitter& emitter)
+{
+    EmitterState state;
+    state.settings = emitter;
+    size_t capacity = (emitter.budget + 3) & ~3;
+    for (auto* array : {&state.px, &state.py, &state.pz, &state.vx, &state.vy, &state.vz, &state.age, &state.life})
+    {
+        array->assign(capacity, 0.0f);
+    }
+    state.random = 0x9E3779B9u * (uint32_t)(emitters_.size() + 1);
+    state.boundsMin = emitter.position - emitter.spawnExtent;
+    state.boundsMax = emitter.position + emitter.spawnExtent;
+    emitters_.push_back(state);
+    return (int)emitters_.size() - 1;
+}
+
+template <typename Task>
+void ParticleSystem::parallel(int count, Task task)
+{
+    JobSystem& jobs = JobSystem::shared();
+    if (!jobs.worthSplitting(count, parallelThreshold))
+    {
+        task(0, count, 0);
+        return;
+    }
+
+    // Whole SIMD groups per range, a few ranges per thread so stealing evens them out. A thread
+    // runs its ranges one after the other, so its index names the worker.
+    int grain = (jobs.balancedGrain(count) + 3) & ~3;
+    jobs.parallelFor(count, grain, [&task](int begin, int end) { task(begin, end, std::max(0, JobSystem::threadIndex())); });
+}
+
+void ParticleSystem::spawn(EmitterState& state, float dt)
+{
+    const Emitter& e = state.settings;
+    state.spawnDebt += e.rate * dt;
+    int wanted = (int)state.spawnDebt;
+    state.spawnDebt -= wanted;
+
+    int spawned = std::min(wanted, e.budget - state.count);
+    for (int k = 0; k < spawned; k++)
+    {
+        int i = state.count++;
+        uint32_t& r = state.random;
+        state.px[i] = e.position.x + randomSigned(r) * e.spawnExtent.x;
+        state.py[i] = e.position.y + randomSigned(r) * e.spawnExtent.y;
+        state.pz[i] = e.position.z + randomSigned(r) * e.spawnExtent.z;
+        state.vx[i] = e.velocity.x + randomSigned(r) * e.velocityJitter.x;
+        state.vy[i] = e.velocity.y + randomSigned(r) * e.velocityJitter.y;
+        state.vz[i] = e.velocity.z + randomSigned(r) * e.velocityJitter.z;
+        state.age[i] = 0.0f;
+        state.life[i] = std::max(e.lifetime + randomSigned(r) * e.lifetimeJitter, 0.01f);
+    }
+}
+
+void ParticleSystem::simulate(EmitterState& state, int begin, int end, float dt, glm::vec3& boundsMin,
+                              glm::vec3& boundsMax)
+{
+    const Emitter& e = state.settings;
+    Float4 step(dt), damping(std::max(1.0f - e.drag * dt, 0.0f));
+    Float4 gx(e.gravity.x * dt), gy(e.gravity.y * dt), gz(e.gravity.z * dt);
+    Float4 minX(1e30f), minY(1e30f), minZ(1e30f), maxX(-1e30f), maxY(-1e30f), maxZ(-1e30f);
+
+    // Whole groups of 4, the padding past count is updated too but never read back
+    for (int i = begin; i < end; i += 4)
+    {
+        Float4 vx = Float4::load(&state.vx[i]) * damping + gx;
+        Float4 vy = Float4::load(&state.vy[i]) * damping + gy;
+        Float4 vz = Float4::load(&state.vz[i]) * damping + gz;
+        Float4 px = Float4::load(&state.px[i]) + vx * step;
+        Float4 py = Float4::load(&state.py[i]) + vy * step;
+        Float4 pz = Float4::load(&state.pz[i]) + vz * step;
+        vx.store(&state.vx[i]);
+        vy.store(&state.vy[i]);
+        vz.store(&state.vz[i]);
+        px.store(&state.px[i]);
+        py.store(&state.py[i]);
+        pz.store(&state.pz[i]);
+        (Float4::load(&state.age[i]) + step).store(&state.age[i]);
+
+        if (i + 4 <= state.count)
+        {
+            minX = min(minX, px);
+            minY = min(minY, py);
+            minZ = min(minZ, pz);
+            maxX = max(maxX, px);
+            maxY = max(maxY, py);
+            maxZ = max(maxZ, pz);
+        }
+        else
+        {
+            for (int k = i; k < state.count; k++)
+            {
+                glm::vec3 p(state.px[k], state.py[k], state.pz[k]);
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+        }
+    }
+
+    for (int k = 0; k < 4; k++)
+    {
+        boundsMin = glm::min(boundsMin, glm::vec3(minX[k], minY[k], minZ[k]));
+        boundsMax = glm::max(boundsMax, glm::vec3(maxX[k], maxY[k], maxZ[k]));
+    }
+}
+
+void ParticleSystem::fill(const EmitterState& state, int begin, int end, Instance* out) const
+{
+    const Emitter& e = state.settings;
+    Float4 sizeStart(e.sizeStart), sizeRange(e.sizeEnd - e.sizeStart);
+    Float4 colorStart[4], colorRange[4];
+    for (int c = 0; c < 4; c++)
+    {
+        colorStart[c] = Float4(e.colorStart[c]);
+        colorRange[c] = Float4(e.colorEnd[c] - e.colorStart[c]);
+    }
+    Float4 zero(0.0f), one(1.0f), byteScale(255.0f);
+
+    for (int i = begin; i < end; i += 4)
+    {
+        Float4 t = min(max(Float4::load(&state.age[i]) / Float4::load(&state.life[i]), zero), one);
+        float size[4], rgba[4][4];
+        (sizeStart + sizeRange * t).store(size);
+        Float4 alpha = colorStart[3] + colorRange[3] * t;
+        for (int c = 0; c < 3; c++)
+        {
+            // Premultiplied, so additive and blended particles share one blend mode
+            ((colorStart[c] + colorRange[c] * t) * alpha * byteScale).store(rgba[c]);
+        }
+        (e.additive ? zero : alpha * byteScale).store(rgba[3]);
+
+        for (int k = 0; k < 4 && i + k < end; k++)
+        {
+            Instance& instance = out[i + k - begin];
+            instance.positionSize = glm::vec4(state.px[i + k], state.py[i + k], state.pz[i + k], size[k]);
+            instance.color = (uint32_t)(rgba[0][k] + 0.5f) | ((uint32_t)(rgba[1][k] + 0.5f) << 8) |
+                             ((uint32_t)(rgba[2][k] + 0.5f) << 16) | ((uint32_t)(rgba[3][k] + 0.5f) << 24);
+        }
+    }
+}
+
+void ParticleSystem::update(float dt, const Camera& camera, const PortalSystem* portals)
+{
+    Frustum frustum(camera.cameraMatrix);
+    alive = 0;
+    drawn = 0;
+    visibleEmitters = 0;
+
+    for (auto& state : emitters_)
+    {
+        // Dead particles are replaced by the last ones, which keeps the arrays packed
+        for (int i = 0; i < state.count;)
+        {
+            if (state.age[i] >= state.life[i])
+            {
+                int last = --state.count;
+                for (auto* array : {&state.px, &state.py, &state.pz, &state.vx, &state.vy, &state.vz, &state.age, &state.life})
+                {
+                    (*array)[i] = (*array)[last];
+                }
+            }
+            else
+            {
+                i++;
+            }
+        }
+        spawn(state, dt);
+        alive += state.count;
+
+        std::vector<glm::vec3> workerMin(JobSystem::shared().threadCount(), glm::vec3(1e30f));
+        std::vector<glm::vec3> workerMax(workerMin.size(), glm::vec3(-1e30f));
+        parallel(state.count, [&](int begin, int end, int worker) {
+            simulate(state, begin, end, dt, workerMin[worker], workerMax[worker]);
+        });
+        state.boundsMin = glm::vec3(1e30f);
+        state.boundsMax = glm::vec3(-1e30f);
+        for (size_t w = 0; w < workerMin.size(); w++)
+        {
+            state.boundsMin = glm::min(state.boundsMin, workerMin[w]);
+            state.boundsMax = glm::max(state.boundsMax, workerMax[w]);
+        }
+
+        // Culled by room, then by the box of the particles grown by their size
+        const Emitter& e = state.settings;
+        if (state.count == 0 || (portals && e.cell >= 0 && !portals->cellVisible(e.cell)))
+        {
+            continue;
+        }
+        float grow = std::max(e.sizeStart, e.sizeEnd);
+        if (!frustum.visible(state.boundsMin - grow, state.boundsMax + grow))
+        {
+            continue;
+        }
+
+        int count = std::min(state.count, maxInstances_ - drawn);
+        Instance* out = instances_.data() + drawn;
+        parallel(count, [&](int begin, int end, int) { fill(state, begin, end, out + begin); });
+        drawn += count;
+        visibleEmitters++;
+    }
+}
+
+void ParticleSystem::draw(const Camera& camera, float nearPlane, float farPlane)
+{
+    if (drawn == 0)
+    {
+        return;
+    }
+
+    // Copy of the scene depth for the soft fade, the default framebuffer can't be sampled
+    glActiveTexture(GL_TEXTURE0);
+    if (depthSize_ != glm::ivec2(camera.width, camera.height))
+    {
+        if (depthTexture_ == 0)
+        {
+            glGenTextures(1, &depthTexture_);
+        }
+        depthSize_ = glm::ivec2(camera.width, camera.height);
+        glBindTexture(GL_TEXTURE_2D, depthTexture_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, depthSize_.x, depthSize_.y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, depthTexture_);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, depthSize_.x, depthSize_.y);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances_ * sizeof(Instance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, drawn * sizeof(Instance), instances_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader_.Activate();
+    glUniformMatrix4fv(glGetUniformLocation(shader_.ID, "camMatrix"), 1, GL_FALSE, glm::value_ptr(camera.cameraMatrix));
+    glm::vec3 right(camera.view[0][0], camera.view[1][0], camera.view[2][0]);
+    glm::vec3 up(camera.view[0][1], camera.view[1][1], camera.view[2][1]);
+    glUniform3fv(glGetUniformLocation(shader_.ID, "cameraRight"), 1, &right.x);
+    glUniform3fv(glGetUniformLocation(shader_.ID, "cameraUp"), 1, &up.x);
+    glUniform1i(glGetUniformLocation(shader_.ID, "sceneDepth"), 0);
+    glUniform2f(glGetUniformLocation(shader_.ID, "depthRange"), nearPlane, farPlane);
+    glUniform1f(glGetUniformLocation(shader_.ID, "softDistance"), softDistance);
+
+    // Depth tested against the scene but not written, premultiplied alpha blending
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(vao_);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, drawn);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+}
+
+void ParticleSystem::Delete()
+{
+    glDeleteBuffers(1, &instanceBuffer_);
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteTextures(1, &depthTexture_);
+    shader_.Delete();
+}
@@ -0,0 +1,216 @@
+#include "portal.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Closer than this to a portal the camera looks straight through it, the near plane would
+// otherwise clip the doorway away while standing in it
+static const float portalMargin = 0.25f;
+
+int PortalSystem::addCell(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    Cell cell;
+    cell.boundsMin = boundsMin;
+    cell.boundsMax = boundsMax;
+    cells_.push_back(cell);
+    return (int)cells_.size() - 1;
+}
+
+void PortalSystem::addPortal(int cellA, int cellB, const glm::vec3* corners, int count)
+{
+    Portal portal;
+    portal.cells[0] = cellA;
+    portal.cells[1] = cellB;
+    portal.corners.assign(corners, corners + count);
+    portal.normal = glm::normalize(glm::cross(corners[1] - corners[0], corners[count - 1] - corners[0]));
+    portal.boundsMin = portal.boundsMax = corners[0];
+    for (int k = 1; k < count; k++)
+    {
+        portal.boundsMin = glm::min(portal.boundsMin, corners[k]);
+        portal.boundsMax = glm::max(portal.boundsMax, corners[k]);
+    }
+
+    portals_.push_back(portal);
+    cells_[cellA].portals.push_back((int)portals_.size() - 1);
+    cells_[cellB].portals.push_back((int)portals_.size() - 1);
+}
+
+void PortalSystem::addNode(int cell, NodeHandle node)
+{
+    if (!node)
+    {
+        return;
+    }
+    cells_[cell].nodes.push_back(node);
+    node->setCulled(!cells_[cell].visible);
+}
+
+int PortalSystem::findCell(const glm::vec3& position)
+{
+    auto inside = [&](int cell) {
+        return glm::all(glm::greaterThanEqual(position, cells_[cell].boundsMin)) &&
+               glm::all(glm::lessThanEqual(position, cells_[cell].boundsMax));
+    };
+
+    // The camera rarely goes further than a neighbour of the cell it was in
+    if (lastCell_ >= 0)
+    {
+        if (inside(lastCell_))
+        {
+            return lastCell_;
+        }
+        for (int index : cells_[lastCell_].portals)
+        {
+            for (int cell : portals_[index].cells)
+            {
+                if (inside(cell))
+                {
+                    return lastCell_ = cell;
+                }
+            }
+        }
+    }
+
+    for (int cell = 0; cell < (int)cells_.size(); cell++)
+    {
+        if (inside(cell))
+        {
+            return lastCell_ = cell;
+        }
+    }
+    return -1;
+}
+
+void PortalSystem::update(const glm::mat4& viewProjection, const glm::vec3& eye)
+{
+    viewProjection_ = viewProjection;
+    eye_ = eye;
+    portalsTested = 0;
+
+    // Only last frame's cells need resetting
+    for (int cell : shown_)
+    {
+        cells_[cell].visible = false;
+        auto& nodes = cells_[cell].nodes;
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [](NodeHandle node) { return !node; }), nodes.end());
+        for (NodeHandle node : nodes)
+        {
+            node->setCulled(true);
+        }
+    }
+    shown_.clear();
+
+    int start = findCell(eye);
+    if (start < 0)
+    {
+        for (int cell = 0; cell < (int)cells_.size(); cell++)
+        {
+            show(cell);
+        }
+    }
+    else
+    {
+        visit(start, Rect{glm::vec2(-1.0f), glm::vec2(1.0f)});
+    }
+    visibleCells = (int)shown_.size();
+}
+
+void PortalSystem::show(int cell)
+{
+    if (cells_[cell].visible)
+    {
+        return;
+    }
+    cells_[cell].visible = true;
+    shown_.push_back(cell);
+    for (NodeHandle node : cells_[cell].nodes)
+    {
+        if (Node* target = node.get())
+        {
+            target->setCulled(false);
+        }
+    }
+}
+
+void PortalSystem::visit(int index, const Rect& rect)
+{
+    Cell& cell = cells_[index];
+    if (cell.visible)
+    {
+        // Already seen through a rectangle that contains this one, nothing new behind it
+        if (glm::all(glm::lessThanEqual(cell.rect.min, rect.min)) && glm::all(glm::greaterThanEqual(cell.rect.max, rect.max)))
+        {
+            return;
+        }
+        cell.rect.min = glm::min(cell.rect.min, rect.min);
+        cell.rect.max = glm::max(cell.rect.max, rect.max);
+    }
+    else
+    {
+        show(index);
+        cell.rect = rect;
+    }
+
+    cell.onPath = true;
+    for (int portalIndex : cell.portals)
+    {
+        const Portal& portal = portals_[portalIndex];
+        int next = portal.cells[0] == index ? portal.cells[1] : portal.cells[0];
+        if (cells_[next].onPath)
+        {
+            continue;
+        }
+
+        portalsTested++;
+        Rect narrowed;
+        if (!project(portal, narrowed))
+        {
+            continue;
+        }
+        narrowed.min = glm::max(narrowed.min, rect.min);
+        narrowed.max = glm::min(narrowed.max, rect.max);
+        if (narrowed.min.x < narrowed.max.x && narrowed.min.y < narrowed.max.y)
+        {
+            visit(next, narrowed);
+        }
+    }
+    cell.onPath = false;
+}
+
+bool PortalSystem::project(const Portal& portal, Rect& rect) const
+{
+    // Standing in the doorway
+    if (std::abs(glm::dot(eye_ - portal.corners[0], portal.normal)) < portalMargin &&
+        glm::all(glm::greaterThanEqual(eye_, portal.boundsMin - portalMargin)) &&
+        glm::all(glm::lessThanEqual(eye_, portal.boundsMax + portalMargin)))
+    {
+        rect = Rect{glm::vec2(-1.0f), glm::vec2(1.0f)};
+        return true;
+    }
+
+    // Clip against the near plane (z = -w) and bound what is left
+    size_t count = portal.corners.size();
+    rect = Rect{glm::vec2(1e30f), glm::vec2(-1e30f)};
+    bool any = false;
+    auto add = [&](const glm::vec4& p) {
+        glm::vec2 ndc = glm::vec2(p) / p.w;
+        rect.min = glm::min(rect.min, ndc);
+        rect.max = glm::max(rect.max, ndc);
+        any = true;
+    };
+    for (size_t k = 0; k < count; k++)
+    {
+        glm::vec4 p = viewProjection_ * glm::vec4(portal.corners[k], 1.0f);
+        glm::vec4 q = viewProjection_ * glm::vec4(portal.corners[(k + 1) % count], 1.0f);
+        float dp = p.z + p.w, dq = q.z + q.w;
+        if (dp >= 0.0f)
+        {
+            add(p);
+        }
+        if ((dp >= 0.0f) != (dq >= 0.0f))
+        {
+            add(p + (q - p) * (dp / (dp - dq)));
+        }
+    }
+    return any;
+}
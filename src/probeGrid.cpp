@@ -0,0 +1,125 @@
+#include "probeGrid.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char probeMagic[4] = {'M', 'C', 'P', 'V'};
+static const uint32_t probeVersion = 1;
+
+void ProbeGrid::layout(const StaticRoom* staticRooms, size_t count, float spacing, float margin)
+{
+    rooms.clear();
+    atlasSize = glm::ivec3(0, 1, 1);
+
+    for (size_t r = 0; r < count; r++)
+    {
+        Room room;
+        room.name = staticRooms[r].name;
+        room.boundsMin = staticRooms[r].boundsMin + margin;
+        room.boundsMax = glm::max(staticRooms[r].boundsMax - margin, room.boundsMin);
+        room.size = glm::ivec3(glm::ceil((room.boundsMax - room.boundsMin) / spacing)) + 1;
+        room.offset = glm::ivec3(atlasSize.x, 0, 0);
+
+        atlasSize.x += room.size.x;
+        atlasSize.y = std::max(atlasSize.y, room.size.y);
+        atlasSize.z = std::max(atlasSize.z, room.size.z);
+        rooms.push_back(room);
+    }
+
+    for (auto& channel : coefficients)
+    {
+        channel.assign((size_t)atlasSize.x * atlasSize.y * atlasSize.z, glm::vec4(0.0f));
+    }
+}
+
+size_t ProbeGrid::index(const glm::ivec3& atlasCoord) const
+{
+    return ((size_t)atlasCoord.z * atlasSize.y + atlasCoord.y) * atlasSize.x + atlasCoord.x;
+}
+
+glm::vec3 ProbeGrid::position(const Room& room, const glm::ivec3& probe) const
+{
+    glm::vec3 steps = glm::max(glm::vec3(room.size - 1), glm::vec3(1.0f));
+    return room.boundsMin + (room.boundsMax - room.boundsMin) * glm::vec3(probe) / steps;
+}
+
+bool ProbeGrid::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "Error: Failed to write probe grid: " << path << std::endl;
+        return false;
+    }
+
+    auto write32 = [&](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    out.write(probeMagic, sizeof(probeMagic));
+    write32(probeVersion);
+    out.write(reinterpret_cast<const char*>(&atlasSize), sizeof(atlasSize));
+    write32(rooms.size());
+    for (const auto& room : rooms)
+    {
+        write32(room.name.size());
+        out.write(room.name.data(), room.name.size());
+        out.write(reinterpret_cast<const char*>(&room.boundsMin), sizeof(room.boundsMin));
+        out.write(reinterpret_cast<const char*>(&room.boundsMax), sizeof(room.boundsMax));
+        out.write(reinterpret_cast<const char*>(&room.size), sizeof(room.size));
+        out.write(reinterpret_cast<const char*>(&room.offset), sizeof(room.offset));
+    }
+    for (const auto& channel : coefficients)
+    {
+        out.write(reinterpret_cast<const char*>(channel.data()), channel.size() * sizeof(glm::vec4));
+    }
+    return (bool)out;
+}
+
+bool ProbeGrid::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    auto read32 = [&]() {
+        uint32_t value = 0;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, probeMagic, sizeof(magic)) != 0 || read32() != probeVersion)
+    {
+        std::cerr << "Error: " << path << " is not a probe grid file" << std::endl;
+        return false;
+    }
+
+    in.read(reinterpret_cast<char*>(&atlasSize), sizeof(atlasSize));
+    rooms.resize(read32());
+    for (auto& room : rooms)
+    {
+        room.name.resize(read32());
+        in.read(&room.name[0], room.name.size());
+        in.read(reinterpret_cast<char*>(&room.boundsMin), sizeof(room.boundsMin));
+        in.read(reinterpret_cast<char*>(&room.boundsMax), sizeof(room.boundsMax));
+        in.read(reinterpret_cast<char*>(&room.size), sizeof(room.size));
+        in.read(reinterpret_cast<char*>(&room.offset), sizeof(room.offset));
+    }
+    for (auto& channel : coefficients)
+    {
+        channel.resize((size_t)atlasSize.x * atlasSize.y * atlasSize.z);
+        in.read(reinterpret_cast<char*>(channel.data()), channel.size() * sizeof(glm::vec4));
+    }
+
+    if (!in)
+    {
+        std::cerr << "Error: truncated probe grid file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
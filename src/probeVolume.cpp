@@ -0,0 +1,63 @@
+#include "probeVolume.h"
+
+#include <iostream>
+#include <string>
+#include <glm/gtc/type_ptr.hpp>
+
+ProbeVolume::ProbeVolume(const ProbeGrid& grid) : rooms_(grid.rooms), atlasSize_(grid.atlasSize)
+{
+    if (rooms_.empty())
+    {
+        return;
+    }
+
+    if (rooms_.size() > MAX_PROBE_ROOMS)
+    {
+        std::cerr << "Error: too many probe rooms, only the first " << MAX_PROBE_ROOMS << " are used" << std::endl;
+        rooms_.resize(MAX_PROBE_ROOMS);
+    }
+
+    // Red, green and blue coefficient grids one after the other along z
+    std::vector<glm::vec4> texels;
+    for (const auto& channel : grid.coefficients)
+    {
+        texels.insert(texels.end(), channel.begin(), channel.end());
+    }
+
+    glGenTextures(1, &ID);
+    glBindTexture(GL_TEXTURE_3D, ID);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, atlasSize_.x, atlasSize_.y, atlasSize_.z * 3, 0, GL_RGBA, GL_FLOAT,
+                 texels.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void ProbeVolume::apply(Shader& shader, GLuint unit)
+{
+    shader.Activate();
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_3D, ID);
+    glUniform1i(glGetUniformLocation(shader.ID, "probeVolume"), unit);
+    glUniform1i(glGetUniformLocation(shader.ID, "probeRoomCount"), ID ? (GLint)rooms_.size() : 0);
+    glUniform3f(glGetUniformLocation(shader.ID, "probeAtlasSize"), (float)atlasSize_.x, (float)atlasSize_.y, (float)atlasSize_.z);
+
+    for (size_t i = 0; i < rooms_.size(); i++)
+    {
+        std::string index = "[" + std::to_string(i) + "]";
+        glm::vec3 size(rooms_[i].size), offset(rooms_[i].offset);
+        glUniform3fv(glGetUniformLocation(shader.ID, ("probeRoomMin" + index).c_str()), 1, glm::value_ptr(rooms_[i].boundsMin));
+        glUniform3fv(glGetUniformLocation(shader.ID, ("probeRoomMax" + index).c_str()), 1, glm::value_ptr(rooms_[i].boundsMax));
+        glUniform3fv(glGetUniformLocation(shader.ID, ("probeRoomSize" + index).c_str()), 1, glm::value_ptr(size));
+        glUniform3fv(glGetUniformLocation(shader.ID, ("probeRoomOffset" + index).c_str()), 1, glm::value_ptr(offset));
+    }
+}
+
+void ProbeVolume::Delete()
+{
+    glDeleteTextures(1, &ID);
+}
@@ -0,0 +1,352 @@
+#include "raytracer.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Rays shorter than this are treated as self intersections
+static const float rayEpsilon = 1e-4f;
+static const int leafSize = 4;
+static const int binCount = 8;
+
+void RayPacket::set(int lane, const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+{
+    ox[lane] = origin.x;
+    oy[lane] = origin.y;
+    oz[lane] = origin.z;
+    dx[lane] = direction.x;
+    dy[lane] = direction.y;
+    dz[lane] = direction.z;
+    tMax[lane] = maxDistance;
+    active |= 1 << lane;
+}
+
+void RayTracer::addMesh(const std::vector<glm::vec3>& positions, const unsigned int* indices, size_t indexCount, int surface)
+{
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const glm::vec3& a = positions[indices[i]];
+        const glm::vec3& b = positions[indices[i + 1]];
+        const glm::vec3& c = positions[indices[i + 2]];
+
+        RayTriangle triangle;
+        triangle.v0 = a;
+        triangle.edge1 = b - a;
+        triangle.edge2 = c - a;
+        glm::vec3 normal = glm::cross(triangle.edge1, triangle.edge2);
+        float area = glm::length(normal);
+        if (area < 1e-8f)
+        {
+            continue;
+        }
+        triangle.normal = normal / area;
+        triangle.surface = surface;
+        triangles.push_back(triangle);
+    }
+}
+
+static void triangleBounds(const RayTriangle& triangle, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    glm::vec3 b = triangle.v0 + triangle.edge1;
+    glm::vec3 c = triangle.v0 + triangle.edge2;
+    boundsMin = glm::min(triangle.v0, glm::min(b, c));
+    boundsMax = glm::max(triangle.v0, glm::max(b, c));
+}
+
+static float halfArea(const glm::vec3& extent)
+{
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+void RayTracer::build()
+{
+    nodes_.clear();
+    nodes_.reserve(triangles.size() * 2 + 1);
+
+    std::vector<glm::vec3> centroids(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        centroids[i] = triangles[i].v0 + (triangles[i].edge1 + triangles[i].edge2) / 3.0f;
+    }
+
+    BVHNode root;
+    root.first = 0;
+    root.count = (int)triangles.size();
+    root.axis = 0;
+    nodes_.push_back(root);
+    subdivide(0, centroids);
+}
+
+void RayTracer::subdivide(int node, std::vector<glm::vec3>& centroids)
+{
+    int first = nodes_[node].first;
+    int count = nodes_[node].count;
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    for (int i = first; i < first + count; i++)
+    {
+        glm::vec3 triMin, triMax;
+        triangleBounds(triangles[i], triMin, triMax);
+        boundsMin = glm::min(boundsMin, triMin);
+        boundsMax = glm::max(boundsMax, triMax);
+        centroidMin = glm::min(centroidMin, centroids[i]);
+        centroidMax = glm::max(centroidMax, centroids[i]);
+    }
+    nodes_[node].boundsMin = boundsMin;
+    nodes_[node].boundsMax = boundsMax;
+
+    if (count <= leafSize)
+    {
+        return;
+    }
+
+    // Binned SAH over the three axes
+    float bestCost = count * halfArea(boundsMax - boundsMin);
+    int bestAxis = -1;
+    float bestSplit = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        glm::vec3 binMin[binCount], binMax[binCount];
+        int binTriangles[binCount] = {};
+        for (int b = 0; b < binCount; b++)
+        {
+            binMin[b] = glm::vec3(FLT_MAX);
+            binMax[b] = glm::vec3(-FLT_MAX);
+        }
+        float scale = binCount / extent;
+        for (int i = first; i < first + count; i++)
+        {
+            int b = std::min(binCount - 1, (int)((centroids[i][axis] - centroidMin[axis]) * scale));
+            glm::vec3 triMin, triMax;
+            triangleBounds(triangles[i], triMin, triMax);
+            binMin[b] = glm::min(binMin[b], triMin);
+            binMax[b] = glm::max(binMax[b], triMax);
+            binTriangles[b]++;
+        }
+
+        for (int split = 1; split < binCount; split++)
+        {
+            glm::vec3 leftMin(FLT_MAX), leftMax(-FLT_MAX), rightMin(FLT_MAX), rightMax(-FLT_MAX);
+            int leftCount = 0, rightCount = 0;
+            for (int b = 0; b < split; b++)
+            {
+                leftMin = glm::min(leftMin, binMin[b]);
+                leftMax = glm::max(leftMax, binMax[b]);
+                leftCount += binTriangles[b];
+            }
+            for (int b = split; b < binCount; b++)
+            {
+                rightMin = glm::min(rightMin, binMin[b]);
+                rightMax = glm::max(rightMax, binMax[b]);
+                rightCount += binTriangles[b];
+            }
+            if (leftCount == 0 || rightCount == 0)
+            {
+                continue;
+            }
+
+            float cost = leftCount * halfArea(leftMax - leftMin) + rightCount * halfArea(rightMax - rightMin);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = centroidMin[axis] + split / scale;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+    {
+        return;
+    }
+
+    int i = first;
+    int j = first + count - 1;
+    while (i <= j)
+    {
+        if (centroids[i][bestAxis] < bestSplit)
+        {
+            i++;
+        }
+        else
+        {
+            std::swap(triangles[i], triangles[j]);
+            std::swap(centroids[i], centroids[j]);
+            j--;
+        }
+    }
+
+    int leftCount = i - first;
+    if (leftCount == 0 || leftCount == count)
+    {
+        return;
+    }
+
+    int left = (int)nodes_.size();
+    BVHNode child;
+    child.axis = 0;
+    child.first = first;
+    child.count = leftCount;
+    nodes_.push_back(child);
+    child.first = i;
+    child.count = count - leftCount;
+    nodes_.push_back(child);
+
+    nodes_[node].first = left;
+    nodes_[node].count = 0;
+    nodes_[node].axis = bestAxis;
+
+    subdivide(left, centroids);
+    subdivide(left + 1, centroids);
+}
+
+// Avoids 0 * inf in the slab test for axis-aligned rays
+static Float4 safeInverse(const float* d)
+{
+    Float4 dir = Float4::load(d);
+    Float4 tiny(1e-20f);
+    Float4 magnitude = max(dir, Float4(0.0f) - dir);
+    Float4 sign = select(dir < Float4(0.0f), Float4(-1.0f), Float4(1.0f));
+    return Float4(1.0f) / select(magnitude < tiny, sign * tiny, dir);
+}
+
+template <bool AnyHit>
+int RayTracer::traverse(const RayPacket& packet, PacketHit* hit) const
+{
+    if (nodes_.empty() || packet.active == 0)
+    {
+        return 0;
+    }
+
+    const Float4 ox = Float4::load(packet.ox), oy = Float4::load(packet.oy), oz = Float4::load(packet.oz);
+    const Float4 dx = Float4::load(packet.dx), dy = Float4::load(packet.dy), dz = Float4::load(packet.dz);
+    const Float4 ix = safeInverse(packet.dx), iy = safeInverse(packet.dy), iz = safeInverse(packet.dz);
+    const Float4 zero(0.0f), one(1.0f), epsilon(rayEpsilon);
+
+    const Float4 activeMask = Float4(packet.active & 1 ? 1.0f : 0.0f, packet.active & 2 ? 1.0f : 0.0f,
+                                     packet.active & 4 ? 1.0f : 0.0f, packet.active & 8 ? 1.0f : 0.0f) > zero;
+
+    Float4 tBest = Float4::load(packet.tMax);
+    Float4 bestU(0.0f), bestV(0.0f);
+    int active = packet.active;
+    int occluded = 0;
+
+    // Front-to-back order for the children is picked from the direction of the first active ray
+    int lead = 0;
+    while (!(active & (1 << lead))) lead++;
+    const float leadDir[3] = {packet.dx[lead], packet.dy[lead], packet.dz[lead]};
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const BVHNode& node = nodes_[stack[--stackSize]];
+
+        Float4 t0 = (Float4(node.boundsMin.x) - ox) * ix, t1 = (Float4(node.boundsMax.x) - ox) * ix;
+        Float4 tEnter = min(t0, t1), tExit = max(t0, t1);
+        t0 = (Float4(node.boundsMin.y) - oy) * iy;
+        t1 = (Float4(node.boundsMax.y) - oy) * iy;
+        tEnter = max(tEnter, min(t0, t1));
+        tExit = min(tExit, max(t0, t1));
+        t0 = (Float4(node.boundsMin.z) - oz) * iz;
+        t1 = (Float4(node.boundsMax.z) - oz) * iz;
+        tEnter = max(max(tEnter, min(t0, t1)), zero);
+        tExit = min(min(tExit, max(t0, t1)), tBest);
+
+        if ((movemask(tEnter <= tExit) & active) == 0)
+        {
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            bool leftFirst = leadDir[node.axis] >= 0.0f;
+            stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+            stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++)
+        {
+            // Moller-Trumbore against all four rays at once
+            const RayTriangle& tri = triangles[i];
+            Float4 e1x(tri.edge1.x), e1y(tri.edge1.y), e1z(tri.edge1.z);
+            Float4 e2x(tri.edge2.x), e2y(tri.edge2.y), e2z(tri.edge2.z);
+
+            Float4 px = dy * e2z - dz * e2y;
+            Float4 py = dz * e2x - dx * e2z;
+            Float4 pz = dx * e2y - dy * e2x;
+            Float4 det = e1x * px + e1y * py + e1z * pz;
+            Float4 invDet = one / det;
+
+            Float4 tx = ox - Float4(tri.v0.x), ty = oy - Float4(tri.v0.y), tz = oz - Float4(tri.v0.z);
+            Float4 u = (tx * px + ty * py + tz * pz) * invDet;
+
+            Float4 qx = ty * e1z - tz * e1y;
+            Float4 qy = tz * e1x - tx * e1z;
+            Float4 qz = tx * e1y - ty * e1x;
+            Float4 v = (dx * qx + dy * qy + dz * qz) * invDet;
+            Float4 t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+            Float4 mask = (det * det > Float4(1e-12f)) & (u >= zero) & (v >= zero) & (u + v <= one) &
+                          (t > epsilon) & (t < tBest) & activeMask;
+            int lanes = movemask(mask) & active;
+            if (lanes == 0)
+            {
+                continue;
+            }
+
+            if (AnyHit)
+            {
+                occluded |= lanes;
+                active &= ~lanes;
+                if (active == 0)
+                {
+                    return occluded;
+                }
+                continue;
+            }
+
+            tBest = select(mask, t, tBest);
+            bestU = select(mask, u, bestU);
+            bestV = select(mask, v, bestV);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (lanes & (1 << lane))
+                {
+                    hit->triangle[lane] = i;
+                }
+            }
+        }
+    }
+
+    if (!AnyHit)
+    {
+        tBest.store(hit->t);
+        bestU.store(hit->u);
+        bestV.store(hit->v);
+    }
+    return occluded;
+}
+
+void RayTracer::intersect(const RayPacket& packet, PacketHit& hit) const
+{
+    for (int lane = 0; lane < 4; lane++)
+    {
+        hit.triangle[lane] = -1;
+    }
+    traverse<false>(packet, &hit);
+}
+
+int RayTracer::occluded(const RayPacket& packet) const
+{
+    return traverse<true>(packet, nullptr);
+}
@@ -0,0 +1,250 @@
+#include "shadow.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+static GLuint createDepthAtlas(int size, GLuint& fbo)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Error: shadow atlas framebuffer is incomplete" << std::endl;
+    }
+
+    // Everything starts fully lit
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return texture;
+}
+
+ShadowSystem::ShadowSystem(int atlasSize, int minResolution, int maxResolution)
+    : atlasSize(atlasSize), minResolution(minResolution), maxResolution(maxResolution),
+      depthShader_("./shaders/shadow.vert", "./shaders/shadow.frag")
+{
+    staticTexture_ = createDepthAtlas(atlasSize, staticFBO_);
+    shadowTexture_ = createDepthAtlas(atlasSize, shadowFBO_);
+}
+
+int ShadowSystem::addLight(const glm::vec3& position, float radius)
+{
+    if (lights_.size() >= MAX_SHADOW_LIGHTS)
+    {
+        std::cerr << "Error: too many shadow casting lights" << std::endl;
+        return -1;
+    }
+
+    ShadowLight light;
+    light.position = position;
+    light.radius = radius;
+    lights_.push_back(light);
+    return (int)lights_.size() - 1;
+}
+
+void ShadowSystem::setLightPosition(int light, const glm::vec3& position)
+{
+    lights_[light].position = position;
+}
+
+void ShadowSystem::allocate(const Camera& camera)
+{
+    // Face resolution from the on-screen size of the light's range: lights covering more pixels get more texels
+    std::vector<int> wanted(lights_.size());
+    float pixelsPerUnit = camera.projection[1][1] * camera.height * 0.5f;
+    for (size_t i = 0; i < lights_.size(); i++)
+    {
+        float dist = glm::length(lights_[i].position - camera.Position);
+        float radius = lights_[i].radius;
+
+        int resolution = maxResolution;
+        if (dist > radius)
+        {
+            float projectedRadius = radius / std::sqrt(dist * dist - radius * radius) * pixelsPerUnit;
+            resolution = minResolution;
+            while (resolution < projectedRadius && resolution < maxResolution)
+            {
+                resolution *= 2;
+            }
+        }
+        wanted[i] = resolution;
+    }
+
+    // Shelf-pack the 3x2 face blocks, biggest first, halving everyone until the set fits
+    std::vector<size_t> order(lights_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return wanted[a] > wanted[b]; });
+
+    for (;;)
+    {
+        int x = 0, y = 0, shelfHeight = 0;
+        bool fits = true;
+        for (size_t i : order)
+        {
+            int blockWidth = 3 * wanted[i];
+            int blockHeight = 2 * wanted[i];
+            if (x + blockWidth > atlasSize)
+            {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            if (y + blockHeight > atlasSize)
+            {
+                fits = false;
+                break;
+            }
+            lights_[i].offset = glm::ivec2(x, y);
+            lights_[i].resolution = wanted[i];
+            x += blockWidth;
+            shelfHeight = std::max(shelfHeight, blockHeight);
+        }
+
+        if (fits)
+        {
+            break;
+        }
+        for (int& resolution : wanted)
+        {
+            resolution = std::max(resolution / 2, 1);
+        }
+    }
+}
+
+void ShadowSystem::renderFaces(ShadowLight& light, Node& root, bool dynamicCasters)
+{
+    glUniform3f(glGetUniformLocation(depthShader_.ID, "lightPos"), light.position.x, light.position.y, light.position.z);
+    glUniform1f(glGetUniformLocation(depthShader_.ID, "farPlane"), light.radius);
+
+    for (int face = 0; face < 6; face++)
+    {
+        glViewport(light.offset.x + (face % 3) * light.resolution, light.offset.y + (face / 3) * light.resolution,
+                   light.resolution, light.resolution);
+        glUniformMatrix4fv(glGetUniformLocation(depthShader_.ID, "shadowMatrix"), 1, GL_FALSE,
+                           glm::value_ptr(light.faceMatrices[face]));
+        root.drawDepth(depthShader_, dynamicCasters);
+    }
+}
+
+void ShadowSystem::render(Node& root, const Camera& camera)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    allocate(camera);
+
+    // Cube face orientations, in the order +X, -X, +Y, -Y, +Z, -Z
+    static const glm::vec3 directions[6] = {
+        glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+        glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+    };
+    static const glm::vec3 ups[6] = {
+        glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+        glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+    };
+    for (auto& light : lights_)
+    {
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, light.radius);
+        for (int face = 0; face < 6; face++)
+        {
+            light.faceMatrices[face] = projection * glm::lookAt(light.position, light.position + directions[face], ups[face]);
+        }
+    }
+
+    depthShader_.Activate();
+
+    // Static casters are only re-rendered when the light moved or its atlas block changed
+    staticRefreshes = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, staticFBO_);
+    for (auto& light : lights_)
+    {
+        bool moved = glm::length(light.position - light.cachedPosition) > moveTolerance;
+        if (light.cacheValid && !moved && light.offset == light.cachedOffset && light.resolution == light.cachedResolution)
+        {
+            continue;
+        }
+
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(light.offset.x, light.offset.y, 3 * light.resolution, 2 * light.resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+
+        renderFaces(light, root, false);
+
+        light.cacheValid = true;
+        light.cachedPosition = light.position;
+        light.cachedOffset = light.offset;
+        light.cachedResolution = light.resolution;
+        staticRefreshes++;
+    }
+
+    // Start each light's block from its cached static map, then draw the dynamic casters on top
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadowFBO_);
+    for (auto& light : lights_)
+    {
+        int x0 = light.offset.x, y0 = light.offset.y;
+        int x1 = x0 + 3 * light.resolution, y1 = y0 + 2 * light.resolution;
+        glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO_);
+    for (auto& light : lights_)
+    {
+        renderFaces(light, root, true);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ShadowSystem::apply(Shader& shader, GLuint unit)
+{
+    shader.Activate();
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, shadowTexture_);
+    glUniform1i(glGetUniformLocation(shader.ID, "shadowAtlas"), unit);
+    glUniform1f(glGetUniformLocation(shader.ID, "shadowTexelSize"), 1.0f / atlasSize);
+    glUniform1i(glGetUniformLocation(shader.ID, "shadowLightCount"), (GLint)lights_.size());
+
+    for (size_t i = 0; i < lights_.size(); i++)
+    {
+        const ShadowLight& light = lights_[i];
+        std::string index = "[" + std::to_string(i) + "]";
+
+        // Block origin and face size in atlas UV units, range of the light in w
+        glm::vec4 region(light.offset.x / (float)atlasSize, light.offset.y / (float)atlasSize,
+                         light.resolution / (float)atlasSize, light.radius);
+        glUniform4fv(glGetUniformLocation(shader.ID, ("shadowRegions" + index).c_str()), 1, glm::value_ptr(region));
+        glUniform3fv(glGetUniformLocation(shader.ID, ("shadowLightPos" + index).c_str()), 1, glm::value_ptr(light.position));
+
+        std::string matrices = "shadowMatrices[" + std::to_string(i * 6) + "]";
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, matrices.c_str()), 6, GL_FALSE,
+                           glm::value_ptr(light.faceMatrices[0]));
+    }
+}
+
+void ShadowSystem::Delete()
+{
+    glDeleteFramebuffers(1, &staticFBO_);
+    glDeleteFramebuffers(1, &shadowFBO_);
+    glDeleteTextures(1, &staticTexture_);
+    glDeleteTextures(1, &shadowTexture_);
+    depthShader_.Delete();
+}
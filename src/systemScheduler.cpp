@@ -0,0 +1,74 @@
+#include "systemScheduler.h"
+
+#include <algorithm>
+
+#include "jobSystem.h"
+
+static bool conflict(const SystemScheduler::System& a, const SystemScheduler::System& b)
+{
+    return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+}
+
+void SystemScheduler::add(const System& system)
+{
+    systems_.push_back(system);
+    stagesDirty_ = true;
+}
+
+void SystemScheduler::buildStages()
+{
+    // A system goes right after the last stage holding a system it conflicts with
+    stages_.clear();
+    std::vector<int> stageOf(systems_.size());
+    for (size_t i = 0; i < systems_.size(); i++)
+    {
+        int stage = 0;
+        for (size_t j = 0; j < i; j++)
+        {
+            if (conflict(systems_[i], systems_[j]))
+            {
+                stage = std::max(stage, stageOf[j] + 1);
+            }
+        }
+        stageOf[i] = stage;
+        if (stage == (int)stages_.size())
+        {
+            stages_.emplace_back();
+        }
+        stages_[stage].push_back((int)i);
+    }
+    stagesDirty_ = false;
+}
+
+void SystemScheduler::run(World& world, float dt)
+{
+    if (stagesDirty_)
+    {
+        buildStages();
+    }
+
+    JobSystem& jobs = JobSystem::shared();
+    std::vector<int> local;
+    for (const std::vector<int>& stage : stages_)
+    {
+        local.clear();
+        JobSystem::Counter counter;
+        for (int index : stage)
+        {
+            if (systems_[index].mainThread || jobs.threadCount() < 2)
+            {
+                local.push_back(index);
+            }
+            else
+            {
+                jobs.run([this, index, &world, dt]() { systems_[index].run(world, dt); }, &counter);
+            }
+        }
+        // This thread helps with the stage's jobs once its own systems are done
+        for (int index : local)
+        {
+            systems_[index].run(world, dt);
+        }
+        jobs.wait(counter);
+    }
+}
@@ -0,0 +1,291 @@
+#include "transformSystem.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "jobSystem.h"
+
+static glm::mat4 compose(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    glm::mat4 m = glm::mat4_cast(rotation);
+    m[0] *= scale.x;
+    m[1] *= scale.y;
+    m[2] *= scale.z;
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+TransformSystem::TransformSystem(int capacity)
+{
+    for (auto* ids : {&slots_, &parents_, &firstChildren_, &lastChildren_, &nextSiblings_, &previousSiblings_,
+                      &freeIds_, &ids_, &parentSlots_, &subtreeSizes_, &order_, &stack_})
+    {
+        ids->reserve(capacity);
+    }
+    translations_.reserve(capacity);
+    rotations_.reserve(capacity);
+    scales_.reserve(capacity);
+    world_.reserve(capacity);
+    scratchTranslations_.reserve(capacity);
+    scratchRotations_.reserve(capacity);
+    scratchScales_.reserve(capacity);
+    dirty_.reserve(capacity);
+    merged_.reserve(capacity);
+    pieces_.reserve(capacity);
+}
+
+int TransformSystem::create(const glm::mat4& local)
+{
+    int id;
+    if (!freeIds_.empty())
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    }
+    else
+    {
+        id = (int)slots_.size();
+        slots_.push_back(-1);
+        parents_.push_back(-1);
+        firstChildren_.push_back(-1);
+        lastChildren_.push_back(-1);
+        nextSiblings_.push_back(-1);
+        previousSiblings_.push_back(-1);
+    }
+
+    // A new root at the end keeps the depth first order
+    int slot = (int)ids_.size();
+    slots_[id] = slot;
+    ids_.push_back(id);
+    parentSlots_.push_back(-1);
+    subtreeSizes_.push_back(1);
+    translations_.emplace_back(0.0f);
+    rotations_.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+    scales_.emplace_back(1.0f);
+    world_.emplace_back(1.0f);
+    setLocal(id, local);
+    return id;
+}
+
+void TransformSystem::destroy(int id)
+{
+    if (firstChildren_[id] >= 0)
+    {
+        std::cerr << "Error: destroying a transform that still has children" << std::endl;
+        return;
+    }
+    setParent(id, -1);
+    ids_[slots_[id]] = -1;
+    slots_[id] = -1;
+    freeIds_.push_back(id);
+    orderDirty_ = true;
+}
+
+void TransformSystem::setParent(int id, int parent)
+{
+    int previous = parents_[id];
+    if (previous == parent)
+    {
+        return;
+    }
+    if (previous >= 0)
+    {
+        int before = previousSiblings_[id], after = nextSiblings_[id];
+        (before >= 0 ? nextSiblings_[before] : firstChildren_[previous]) = after;
+        (after >= 0 ? previousSiblings_[after] : lastChildren_[previous]) = before;
+        previousSiblings_[id] = nextSiblings_[id] = -1;
+    }
+    if (parent >= 0)
+    {
+        int last = lastChildren_[parent];
+        (last >= 0 ? nextSiblings_[last] : firstChildren_[parent]) = id;
+        previousSiblings_[id] = last;
+        lastChildren_[parent] = id;
+    }
+    parents_[id] = parent;
+    orderDirty_ = true;
+}
+
+void TransformSystem::setLocal(int id, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    int slot = slots_[id];
+    translations_[slot] = translation;
+    rotations_[slot] = rotation;
+    scales_[slot] = scale;
+    // The slots only describe subtrees again after reorder(), which updates everything
+    if (!orderDirty_)
+    {
+        dirty_.push_back({slot, slot + subtreeSizes_[slot]});
+    }
+}
+
+void TransformSystem::setLocal(int id, const glm::mat4& local)
+{
+    glm::mat3 basis(local);
+    glm::vec3 scale(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+    // Mirrored matrices keep a proper rotation, the flip goes to the scale
+    if (glm::determinant(basis) < 0.0f)
+    {
+        scale.x = -scale.x;
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        basis[c] = scale[c] != 0.0f ? basis[c] / scale[c] : glm::vec3(0.0f);
+    }
+    setLocal(id, glm::vec3(local[3]), glm::normalize(glm::quat_cast(basis)), scale);
+}
+
+glm::mat4 TransformSystem::local(int id) const
+{
+    int slot = slots_[id];
+    return compose(translations_[slot], rotations_[slot], scales_[slot]);
+}
+
+void TransformSystem::reorder()
+{
+    // Depth first from every root, children in the order they were added
+    order_.clear();
+    for (int root = 0; root < (int)parents_.size(); root++)
+    {
+        if (slots_[root] < 0 || parents_[root] >= 0)
+        {
+            continue;
+        }
+        stack_.push_back(root);
+        while (!stack_.empty())
+        {
+            int id = stack_.back();
+            stack_.pop_back();
+            order_.push_back(id);
+            for (int child = lastChildren_[id]; child >= 0; child = previousSiblings_[child])
+            {
+                stack_.push_back(child);
+            }
+        }
+    }
+
+    // Destroyed transforms are dropped, the arrays only shrink
+    size_t count = order_.size();
+    scratchTranslations_.resize(count);
+    scratchRotations_.resize(count);
+    scratchScales_.resize(count);
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        int from = slots_[order_[slot]];
+        scratchTranslations_[slot] = translations_[from];
+        scratchRotations_[slot] = rotations_[from];
+        scratchScales_[slot] = scales_[from];
+    }
+    translations_.swap(scratchTranslations_);
+    rotations_.swap(scratchRotations_);
+    scales_.swap(scratchScales_);
+    ids_ = order_;
+    parentSlots_.resize(count);
+    subtreeSizes_.resize(count);
+    world_.resize(count);
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        slots_[ids_[slot]] = (int)slot;
+    }
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        int parent = parents_[ids_[slot]];
+        parentSlots_[slot] = parent < 0 ? -1 : slots_[parent];
+    }
+
+    // Children come after their parent, so a backward pass sums the subtrees
+    std::fill(subtreeSizes_.begin(), subtreeSizes_.end(), 1);
+    for (size_t slot = count; slot-- > 0;)
+    {
+        if (parentSlots_[slot] >= 0)
+        {
+            subtreeSizes_[parentSlots_[slot]] += subtreeSizes_[slot];
+        }
+    }
+
+    orderDirty_ = false;
+    dirty_.assign(1, {0, (int)count});
+}
+
+void TransformSystem::update()
+{
+    if (orderDirty_)
+    {
+        reorder();
+    }
+
+    // Every range is a run of whole subtrees, the nested ones are dropped so every slot is
+    // computed once
+    std::sort(dirty_.begin(), dirty_.end());
+    merged_.clear();
+    updated = 0;
+    int done = 0;
+    for (auto [first, last] : dirty_)
+    {
+        if (first < done)
+        {
+            continue;
+        }
+        merged_.push_back({first, last});
+        updated += last - first;
+        done = last;
+    }
+    dirty_.clear();
+
+    JobSystem& jobs = JobSystem::shared();
+    if (jobs.threadCount() < 2 || (size_t)updated < parallelThreshold)
+    {
+        for (auto [first, last] : merged_)
+        {
+            compute(first, last);
+        }
+        return;
+    }
+
+    // Subtrees are independent once their root is computed, large ones are opened up to a few
+    // pieces per thread
+    int grain = std::max(256, updated / ((int)jobs.threadCount() * 4));
+    pieces_.clear();
+    for (auto [first, last] : merged_)
+    {
+        split(first, last, grain);
+    }
+    jobs.parallelFor((int)pieces_.size(), 1, [this](int begin, int end) {
+        for (int k = begin; k < end; k++)
+        {
+            compute(pieces_[k].first, pieces_[k].second);
+        }
+    });
+}
+
+void TransformSystem::split(int first, int last, int grain)
+{
+    for (int slot = first; slot < last; slot += subtreeSizes_[slot])
+    {
+        int end = slot + subtreeSizes_[slot];
+        if (end - slot > grain)
+        {
+            compute(slot, slot + 1);
+            split(slot + 1, end, grain);
+        }
+        // Small sibling subtrees share a piece
+        else if (!pieces_.empty() && pieces_.back().second == slot && end - pieces_.back().first <= grain)
+        {
+            pieces_.back().second = end;
+        }
+        else
+        {
+            pieces_.push_back({slot, end});
+        }
+    }
+}
+
+void TransformSystem::compute(int first, int last)
+{
+    for (int slot = first; slot < last; slot++)
+    {
+        glm::mat4 m = compose(translations_[slot], rotations_[slot], scales_[slot]);
+        int parent = parentSlots_[slot];
+        world_[slot] = parent < 0 ? m : world_[parent] * m;
+    }
+}
@@ -0,0 +1,248 @@
+#include "world.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+World::World()
+{
+    // The archetype of entities created without components
+    findArchetype(ComponentMask());
+}
+
+std::vector<World::ComponentInfo>& World::components()
+{
+    static std::vector<ComponentInfo> registry;
+    return registry;
+}
+
+int World::registerComponent(size_t size, size_t alignment)
+{
+    std::vector<ComponentInfo>& registry = components();
+    if ((int)registry.size() == MAX_COMPONENTS)
+    {
+        std::cerr << "Error: more than " << MAX_COMPONENTS << " component types" << std::endl;
+        std::abort();
+    }
+    registry.push_back({size, alignment});
+    return (int)registry.size() - 1;
+}
+
+int World::findArchetype(const ComponentMask& mask)
+{
+    auto found = archetypeIndex_.find(mask.to_ullong());
+    if (found != archetypeIndex_.end())
+    {
+        return found->second;
+    }
+
+    Archetype archetype;
+    archetype.mask = mask;
+    size_t rowSize = sizeof(Entity);
+    for (int c = 0; c < MAX_COMPONENTS; c++)
+    {
+        archetype.offsets[c] = -1;
+        archetype.addEdges[c] = -1;
+        archetype.removeEdges[c] = -1;
+        if (mask.test(c))
+        {
+            archetype.components.push_back(c);
+            rowSize += components()[c].size;
+        }
+    }
+
+    // Arrays are laid out one after the other, each aligned for its type, so the rows share
+    // the chunk less the worst case padding
+    size_t padding = archetype.components.size() * alignof(std::max_align_t);
+    archetype.rowCapacity = (int)((CHUNK_BYTES - std::min<size_t>(padding, CHUNK_BYTES)) / rowSize);
+    size_t offset = sizeof(Entity) * archetype.rowCapacity;
+    for (int c : archetype.components)
+    {
+        const ComponentInfo& info = components()[c];
+        offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+        archetype.offsets[c] = (int)offset;
+        offset += info.size * archetype.rowCapacity;
+    }
+    if (archetype.rowCapacity < 1)
+    {
+        std::cerr << "Error: the components of an entity don't fit in a chunk" << std::endl;
+        std::abort();
+    }
+
+    int index = (int)archetypes_.size();
+    archetypes_.push_back(std::move(archetype));
+    archetypeIndex_[mask.to_ullong()] = index;
+    for (Query& query : queries_)
+    {
+        if ((mask & query.all) == query.all && (mask & query.none).none())
+        {
+            query.archetypes.push_back(index);
+        }
+    }
+    return index;
+}
+
+int World::edge(int archetype, int component, bool add)
+{
+    int cached = add ? archetypes_[archetype].addEdges[component] : archetypes_[archetype].removeEdges[component];
+    if (cached >= 0)
+    {
+        return cached;
+    }
+    ComponentMask mask = archetypes_[archetype].mask;
+    mask.set(component, add);
+    int target = findArchetype(mask);
+    (add ? archetypes_[archetype].addEdges[component] : archetypes_[archetype].removeEdges[component]) = target;
+    return target;
+}
+
+Entity World::allocateEntity(int archetype)
+{
+    uint32_t index;
+    if (!freeEntities_.empty())
+    {
+        index = freeEntities_.back();
+        freeEntities_.pop_back();
+    }
+    else
+    {
+        if (records_.size() > Entity::INDEX_MASK)
+        {
+            std::cerr << "Error: out of entities" << std::endl;
+            return Entity();
+        }
+        index = (uint32_t)records_.size();
+        records_.emplace_back();
+    }
+
+    Record& record = records_[index];
+    record.generation = (record.generation + 1) & (~0u >> Entity::INDEX_BITS);
+    Entity entity(index, record.generation);
+    allocateRow(entity, archetype);
+    liveEntities_++;
+    return entity;
+}
+
+void World::allocateRow(Entity entity, int index)
+{
+    Archetype& archetype = archetypes_[index];
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.rowCapacity)
+    {
+        Chunk chunk;
+        if (!spareChunks_.empty())
+        {
+            chunk.data = std::move(spareChunks_.back());
+            spareChunks_.pop_back();
+        }
+        else
+        {
+            chunk.data.reset(new unsigned char[CHUNK_BYTES]);
+        }
+        archetype.chunks.push_back(std::move(chunk));
+    }
+
+    Chunk& chunk = archetype.chunks.back();
+    Record& record = records_[entity.index()];
+    record.archetype = index;
+    record.chunk = (int)archetype.chunks.size() - 1;
+    record.row = chunk.count++;
+    reinterpret_cast<Entity*>(chunk.data.get())[record.row] = entity;
+}
+
+void World::removeRow(int index, int chunkIndex, int row)
+{
+    Archetype& archetype = archetypes_[index];
+    Chunk& chunk = archetype.chunks[chunkIndex];
+    Chunk& last = archetype.chunks.back();
+    int lastRow = last.count - 1;
+    if (&chunk != &last || row != lastRow)
+    {
+        Entity moved = reinterpret_cast<Entity*>(last.data.get())[lastRow];
+        reinterpret_cast<Entity*>(chunk.data.get())[row] = moved;
+        for (int c : archetype.components)
+        {
+            size_t size = components()[c].size;
+            std::memcpy(chunk.data.get() + archetype.offsets[c] + row * size,
+                        last.data.get() + archetype.offsets[c] + lastRow * size, size);
+        }
+        records_[moved.index()].chunk = chunkIndex;
+        records_[moved.index()].row = row;
+    }
+    if (--last.count == 0)
+    {
+        spareChunks_.push_back(std::move(last.data));
+        archetype.chunks.pop_back();
+    }
+}
+
+void World::move(Entity entity, int target)
+{
+    Record from = records_[entity.index()];
+    allocateRow(entity, target);
+    const Record& to = records_[entity.index()];
+
+    // Components of both archetypes carry over, the new one is written by the caller
+    const Archetype& source = archetypes_[from.archetype];
+    const Archetype& destination = archetypes_[target];
+    const unsigned char* sourceData = source.chunks[from.chunk].data.get();
+    unsigned char* destinationData = destination.chunks[to.chunk].data.get();
+    for (int c : source.components)
+    {
+        if (destination.offsets[c] >= 0)
+        {
+            size_t size = components()[c].size;
+            std::memcpy(destinationData + destination.offsets[c] + to.row * size,
+                        sourceData + source.offsets[c] + from.row * size, size);
+        }
+    }
+    removeRow(from.archetype, from.chunk, from.row);
+}
+
+void World::destroy(Entity entity)
+{
+    if (!alive(entity))
+    {
+        return;
+    }
+    Record& record = records_[entity.index()];
+    removeRow(record.archetype, record.chunk, record.row);
+    record.archetype = -1;
+    record.generation = (record.generation + 1) & (~0u >> Entity::INDEX_BITS);
+    freeEntities_.push_back(entity.index());
+    liveEntities_--;
+}
+
+bool World::alive(Entity entity) const
+{
+    return entity.index() < records_.size() && (entity.generation() & 1) &&
+           records_[entity.index()].generation == entity.generation();
+}
+
+int World::query(const ComponentMask& all, const ComponentMask& none)
+{
+    Query query;
+    query.all = all;
+    query.none = none;
+    for (size_t index = 0; index < archetypes_.size(); index++)
+    {
+        const ComponentMask& mask = archetypes_[index].mask;
+        if ((mask & all) == all && (mask & none).none())
+        {
+            query.archetypes.push_back((int)index);
+        }
+    }
+    queries_.push_back(query);
+    return (int)queries_.size() - 1;
+}
+
+int World::count(int query) const
+{
+    int total = 0;
+    for (int index : queries_[query].archetypes)
+    {
+        for (const Chunk& chunk : archetypes_[index].chunks)
+        {
+            total += chunk.count;
+        }
+    }
+    return total;
+}